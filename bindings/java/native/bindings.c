@@ -33,6 +33,18 @@
 #include "bindings.h"
 #include "digest.h"
 
+/**
+ * Throw a Java exception of the given class.
+ *
+ * @param env the JNI environment
+ * @param class_name the name of the exception class
+ */
+static void throw_exception(JNIEnv *env, const char* class_name) {
+	jclass cls = (*env)->FindClass(env, class_name);
+	if (cls)
+		(*env)->ThrowNew(env, cls, NULL);
+}
+
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_library_init
@@ -56,10 +68,10 @@ JNIEXPORT jint JNICALL Java_org_sf_rhash_Bindings_rhash_1count
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_msg
- * Signature: (I[BII)J
+ * Signature: (J[BII)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1msg
-(JNIEnv *env, jclass clz, jint hash_id, jbyteArray buf, jint ofs, jint len) {
+(JNIEnv *env, jclass clz, jlong hash_id, jbyteArray buf, jint ofs, jint len) {
 	// reading data
 	void* msg = malloc(len);
 	(*env)->GetByteArrayRegion(env, buf, ofs, len, msg);
@@ -93,10 +105,10 @@ JNIEXPORT jbyteArray JNICALL Java_org_sf_rhash_Bindings_rhash_1print_1bytes
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_print_magnet
- * Signature: (JLjava/lang/String;I)Ljava/lang/String;
+ * Signature: (JLjava/lang/String;J)Ljava/lang/String;
  */
 JNIEXPORT jstring JNICALL Java_org_sf_rhash_Bindings_rhash_1print_1magnet
-(JNIEnv *env, jclass clz, jlong context, jstring filepath, jint flags) {
+(JNIEnv *env, jclass clz, jlong context, jstring filepath, jlong flags) {
 	const char* fpath = (filepath != NULL) ?
 			(*env)->GetStringUTFChars(env, filepath, NULL) : NULL;
 	size_t len = rhash_print_magnet(NULL, fpath, TO_RHASH(context), flags, RHPR_FILESIZE);
@@ -113,30 +125,30 @@ JNIEXPORT jstring JNICALL Java_org_sf_rhash_Bindings_rhash_1print_1magnet
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_is_base32
- * Signature: (I)Z
+ * Signature: (J)Z
  */
 JNIEXPORT jboolean JNICALL Java_org_sf_rhash_Bindings_rhash_1is_1base32
-(JNIEnv *env, jclass clz, jint hash_id) {
+(JNIEnv *env, jclass clz, jlong hash_id) {
 	return rhash_is_base32(hash_id);
 }
 
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_get_digest_size
- * Signature: (I)I
+ * Signature: (J)I
  */
 JNIEXPORT jint JNICALL Java_org_sf_rhash_Bindings_rhash_1get_1digest_1size
-(JNIEnv *env, jclass clz, jint hash_id) {
+(JNIEnv *env, jclass clz, jlong hash_id) {
 	return rhash_get_digest_size(hash_id);
 }
 
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_init
- * Signature: (I)J
+ * Signature: (J)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1init
-(JNIEnv *env, jclass clz, jint hash_flags) {
+(JNIEnv *env, jclass clz, jlong hash_flags) {
 	rhash ctx = rhash_init(hash_flags);
 	rhash_set_autofinal(ctx, 0);
 	return TO_JLONG(ctx);
@@ -155,6 +167,57 @@ JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1update
 	free(msg);
 }
 
+/*
+ * Class:     org_sf_rhash_Bindings
+ * Method:    rhash_updatev
+ * Signature: (J[[B)V
+ */
+JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1updatev
+(JNIEnv *env, jclass clz, jlong context, jobjectArray chunks) {
+	jsize count = (*env)->GetArrayLength(env, chunks);
+	rhash_iovec* iov;
+	jbyteArray* arrays;
+	jsize i, pinned;
+	int is_pinned;
+
+	/* references to all chunks are kept, while the chunks are pinned */
+	if ((*env)->PushLocalFrame(env, count + 1) < 0)
+		return; /* OutOfMemoryError is thrown */
+	iov = (rhash_iovec*)malloc(sizeof(rhash_iovec) * (count + 1));
+	arrays = (jbyteArray*)malloc(sizeof(jbyteArray) * (count + 1));
+	if (!iov || !arrays) {
+		throw_exception(env, "java/lang/OutOfMemoryError");
+		goto exit;
+	}
+	for (i = 0; i < count; i++) {
+		arrays[i] = (jbyteArray)(*env)->GetObjectArrayElement(env, chunks, i);
+		if (!arrays[i]) {
+			throw_exception(env, "java/lang/NullPointerException");
+			goto exit;
+		}
+		iov[i].iov_len = (size_t)(*env)->GetArrayLength(env, arrays[i]);
+	}
+	/* no JNI functions can be called, while the arrays are pinned */
+	for (pinned = 0; pinned < count; pinned++) {
+		iov[pinned].iov_base = (*env)->GetPrimitiveArrayCritical(env, arrays[pinned], NULL);
+		if (!iov[pinned].iov_base)
+			break;
+	}
+	is_pinned = (pinned == count);
+	if (is_pinned)
+		rhash_updatev(TO_RHASH(context), iov, (int)count);
+	while (pinned > 0) {
+		pinned--;
+		(*env)->ReleasePrimitiveArrayCritical(env, arrays[pinned], (void*)iov[pinned].iov_base, JNI_ABORT);
+	}
+	if (!is_pinned && !(*env)->ExceptionCheck(env))
+		throw_exception(env, "java/lang/OutOfMemoryError");
+exit:
+	free(arrays);
+	free(iov);
+	(*env)->PopLocalFrame(env, NULL);
+}
+
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_final
@@ -178,10 +241,10 @@ JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1reset
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_print
- * Signature: (JI)J
+ * Signature: (JJ)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1print
-(JNIEnv *env, jclass clz, jlong context, jint hash_id) {
+(JNIEnv *env, jclass clz, jlong context, jlong hash_id) {
 	Digest obj = malloc(sizeof(DigestStruct));
 	obj->hash_len  = rhash_get_digest_size(hash_id);
 	obj->hash_data = calloc(obj->hash_len, sizeof(unsigned char));
@@ -26,10 +26,10 @@ JNIEXPORT jint JNICALL Java_org_sf_rhash_Bindings_rhash_1count
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_msg
- * Signature: (I[BII)J
+ * Signature: (J[BII)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1msg
-  (JNIEnv *, jclass, jint, jbyteArray, jint, jint);
+  (JNIEnv *, jclass, jlong, jbyteArray, jint, jint);
 
 /*
  * Class:     org_sf_rhash_Bindings
@@ -42,34 +42,34 @@ JNIEXPORT jbyteArray JNICALL Java_org_sf_rhash_Bindings_rhash_1print_1bytes
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_print_magnet
- * Signature: (JLjava/lang/String;I)Ljava/lang/String;
+ * Signature: (JLjava/lang/String;J)Ljava/lang/String;
  */
 JNIEXPORT jstring JNICALL Java_org_sf_rhash_Bindings_rhash_1print_1magnet
-  (JNIEnv *, jclass, jlong, jstring, jint);
+  (JNIEnv *, jclass, jlong, jstring, jlong);
 
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_is_base32
- * Signature: (I)Z
+ * Signature: (J)Z
  */
 JNIEXPORT jboolean JNICALL Java_org_sf_rhash_Bindings_rhash_1is_1base32
-  (JNIEnv *, jclass, jint);
+  (JNIEnv *, jclass, jlong);
 
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_get_digest_size
- * Signature: (I)I
+ * Signature: (J)I
  */
 JNIEXPORT jint JNICALL Java_org_sf_rhash_Bindings_rhash_1get_1digest_1size
-  (JNIEnv *, jclass, jint);
+  (JNIEnv *, jclass, jlong);
 
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_init
- * Signature: (I)J
+ * Signature: (J)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1init
-  (JNIEnv *, jclass, jint);
+  (JNIEnv *, jclass, jlong);
 
 /*
  * Class:     org_sf_rhash_Bindings
@@ -79,6 +79,14 @@ JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1init
 JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1update
   (JNIEnv *, jclass, jlong, jbyteArray, jint, jint);
 
+/*
+ * Class:     org_sf_rhash_Bindings
+ * Method:    rhash_updatev
+ * Signature: (J[[B)V
+ */
+JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1updatev
+  (JNIEnv *, jclass, jlong, jobjectArray);
+
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_final
@@ -98,10 +106,10 @@ JNIEXPORT void JNICALL Java_org_sf_rhash_Bindings_rhash_1reset
 /*
  * Class:     org_sf_rhash_Bindings
  * Method:    rhash_print
- * Signature: (JI)J
+ * Signature: (JJ)J
  */
 JNIEXPORT jlong JNICALL Java_org_sf_rhash_Bindings_rhash_1print
-  (JNIEnv *, jclass, jlong, jint);
+  (JNIEnv *, jclass, jlong, jlong);
 
 /*
  * Class:     org_sf_rhash_Bindings
@@ -44,7 +44,7 @@ final class Bindings {
 	 * @param  len      data length
 	 * @return  pointer to the native digest object
 	 */
-	static native long rhash_msg(int hash_id, byte[] data, int ofs, int len);
+	static native long rhash_msg(long hash_id, byte[] data, int ofs, int len);
 	
 	/**
 	 * Prints text representation of a given digest.
@@ -63,7 +63,7 @@ final class Bindings {
 	 * @param  flags     mask of hash_id values
 	 * @return  magnet string
 	 */
-	static native String rhash_print_magnet(long rhash, String filename, int flags);
+	static native String rhash_print_magnet(long rhash, String filename, long flags);
 
 	/**
 	 * Tests whether given default hash algorithm output is base32.
@@ -71,21 +71,21 @@ final class Bindings {
 	 * @return <code>true</code> if default output for hash algorithm is base32,
 	 *         <code>false</code> otherwise
 	 */
-	static native boolean rhash_is_base32(int hash_id);
+	static native boolean rhash_is_base32(long hash_id);
 
 	/**
 	 * Returns size of binary message digest.
 	 * @param hash_id  id of hash function
 	 * @return  size of message digest
 	 */
-	static native int rhash_get_digest_size(int hash_id);
+	static native int rhash_get_digest_size(long hash_id);
 
 	/**
 	 * Creates new hash context.
 	 * @param  flags  mask of hash_id values
 	 * @return  pointer to the native hash context
 	 */
-	static native long rhash_init(int flags);
+	static native long rhash_init(long flags);
 
 	/**
 	 * Updates hash context with given data.
@@ -96,6 +96,13 @@ final class Bindings {
 	 */
 	static native void rhash_update(long rhash, byte[] data, int ofs, int len);
 
+	/**
+	 * Updates hash context with several data chunks.
+	 * @param rhash   pointer to native hash context
+	 * @param chunks  data chunks to process
+	 */
+	static native void rhash_updatev(long rhash, byte[][] chunks);
+
 	/**
 	 * Finalizes hash context.
 	 * @param rhash  pointer to native hash context
@@ -114,7 +121,7 @@ final class Bindings {
 	 * @param  hash_id  id of hashing algorithm
 	 * @return  pointer to native digest
 	 */
-	static native long rhash_print(long rhash, int hash_id);
+	static native long rhash_print(long rhash, long hash_id);
 
 	/**
 	 * Frees hash context.
@@ -27,69 +27,75 @@ public enum HashType {
 	/** CRC32 checksum. */
 	CRC32(1),
 	/** MD4 hash. */
-	MD4(1 << 1),
+	MD4(1L << 1),
 	/** MD5 hash. */
-	MD5(1 << 2),
+	MD5(1L << 2),
 	/** SHA-1 hash. */
-	SHA1(1 << 3),
+	SHA1(1L << 3),
 	/** Tiger hash. */
-	TIGER(1 << 4),
+	TIGER(1L << 4),
 	/** Tiger tree hash */
-	TTH(1 << 5),
+	TTH(1L << 5),
 	/** BitTorrent info hash. */
-	BTIH(1 << 6),
+	BTIH(1L << 6),
 	/** EDonkey 2000 hash. */
-	ED2K(1 << 7),
+	ED2K(1L << 7),
 	/** eMule AICH. */
-	AICH(1 << 8),
+	AICH(1L << 8),
 	/** Whirlpool hash. */
-	WHIRLPOOL(1 << 9),
+	WHIRLPOOL(1L << 9),
 	/** RIPEMD-160 hash. */
-	RIPEMD160(1 << 10),
+	RIPEMD160(1L << 10),
 	/** GOST R 34.11-94. */
-	GOST94(1 << 11),
-	GOST94_CRYPTOPRO(1 << 12),
+	GOST94(1L << 11),
+	GOST94_CRYPTOPRO(1L << 12),
 	/** HAS-160 hash. */
-	HAS160(1 << 13),
+	HAS160(1L << 13),
 	/** GOST R 34.11-2012 - 256 bit. */
-	GOST12_256(1 << 14),
+	GOST12_256(1L << 14),
 	/** GOST R 34.11-2012 - 512 bit. */
-	GOST12_512(1 << 15),
+	GOST12_512(1L << 15),
 	/** SHA-224 hash. */
-	SHA224(1 << 16),
+	SHA224(1L << 16),
 	/** SHA-256 hash. */
-	SHA256(1 << 17),
+	SHA256(1L << 17),
 	/** SHA-384 hash. */
-	SHA384(1 << 18),
+	SHA384(1L << 18),
 	/** SHA-512 hash. */
-	SHA512(1 << 19),
+	SHA512(1L << 19),
 	/** EDON-R 256. */
-	EDONR256(1 << 20),
+	EDONR256(1L << 20),
 	/** EDON-R 512. */
-	EDONR512(1 << 21),
+	EDONR512(1L << 21),
 	/** SHA3-224 hash. */
-	SHA3_224(1 << 22),
+	SHA3_224(1L << 22),
 	/** SHA3-256 hash. */
-	SHA3_256(1 << 23),
+	SHA3_256(1L << 23),
 	/** SHA3-384 hash. */
-	SHA3_384(1 << 24),
+	SHA3_384(1L << 24),
 	/** SHA3-512 hash. */
-	SHA3_512(1 << 25),
+	SHA3_512(1L << 25),
 	/** CRC32C checksum. */
-	CRC32C(1 << 26),
+	CRC32C(1L << 26),
 	/** Snefru-128 hash. */
-	SNEFRU128(1 << 27),
+	SNEFRU128(1L << 27),
 	/** Snefru-256 hash. */
-	SNEFRU256(1 << 28);
+	SNEFRU256(1L << 28),
+	/** BLAKE2s hash. */
+	BLAKE2S(1L << 29),
+	/** BLAKE2b hash. */
+	BLAKE2B(1L << 30),
+	/** BLAKE3 hash. */
+	BLAKE3(1L << 31);
 
 	/** hash_id for the native API */
-	private int hashId;
+	private long hashId;
 
 	/**
 	 * Construct HashType for specified native hash_id
 	 * @param hashId hash identifier for native API
 	 */
-	private HashType(int hashId) {
+	private HashType(long hashId) {
 		this.hashId = hashId;
 	}
 
@@ -97,7 +103,7 @@ public enum HashType {
 	 * Returns hash_id for the native API.
 	 * @return hash identifier
 	 */
-	int hashId() {
+	long hashId() {
 		return hashId;
 	}
 
@@ -108,7 +114,7 @@ public enum HashType {
 	 * @return  <code>HashType</code> object or <code>null</code>
 	 *   if no <code>HashType</code> for given mask exists
 	 */
-	static HashType forHashFlags(int flags) {
+	static HashType forHashFlags(long flags) {
 		if (flags == 0) return null;
 		int lowest = 0;
 		while ((flags % 2) == 0) {
@@ -116,7 +122,7 @@ public enum HashType {
 			lowest++;
 		}
 		for (HashType t : HashType.values()) {
-			if (t.hashId == (1 << lowest)) return t;
+			if (t.hashId == (1L << lowest)) return t;
 		}
 		return null;
 	}
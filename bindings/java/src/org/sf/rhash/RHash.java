@@ -178,7 +178,7 @@ public final class RHash {
 	private boolean finished = false;
 
 	/** Mask of hash_id values. */
-	private final int hash_flags;
+	private final long hash_flags;
 
 	/** Pointer to the native hash context. */
 	private final long context_ptr;
@@ -199,7 +199,7 @@ public final class RHash {
 		if (types.length == 0) {
 			throw new IllegalArgumentException(ERR_NOHASH);
 		}
-		int flags = 0;
+		long flags = 0;
 		HashType def = types[0];
 		for (HashType t : types) {
 			flags |= t.hashId();
@@ -223,7 +223,7 @@ public final class RHash {
 		if (types.isEmpty()) {
 			throw new IllegalArgumentException(ERR_NOHASH);
 		}
-		int flags = 0;
+		long flags = 0;
 		HashType def = null;
 		for (HashType t : types) {
 			flags |= t.hashId();
@@ -280,6 +280,33 @@ public final class RHash {
 		return update(data, 0, data.length);
 	}
 
+	/**
+	 * Updates this <code>RHash</code> with several data chunks at once.
+	 * This method has the same effect as calling
+	 * <pre>update(chunk)</pre> for every chunk, but is faster
+	 * for many small chunks.
+	 *
+	 * @param  chunks  data chunks to be hashed
+	 * @return  this object
+	 * @throws NullPointerException
+	 *   if <code>chunks</code> or any of its elements is <code>null</code>
+	 * @throws IllegalStateException
+	 *   if <code>finish()</code> was called and there were no
+	 *   subsequent calls of <code>reset()</code>
+	 */
+	public synchronized RHash updateMany(byte[][] chunks) {
+		if (finished) {
+			throw new IllegalStateException(ERR_FINISHED);
+		}
+		for (byte[] chunk : chunks) {
+			if (chunk == null) {
+				throw new NullPointerException();
+			}
+		}
+		Bindings.rhash_updatev(context_ptr, chunks);
+		return this;
+	}
+
 	/**
 	 * Updates this <code>RHash</code> with new data chunk.
 	 * String is encoded into a sequence of bytes using the
@@ -415,7 +442,7 @@ public final class RHash {
 		if (!finished) {
 			throw new IllegalStateException(ERR_UNFINISHED);
 		}
-		int flags = 0;
+		long flags = 0;
 		for (HashType t : types) {
 			flags |= t.hashId();
 		}
@@ -52,6 +52,14 @@ public class RHashTest {
 		assertEquals("d41d8cd98f00b204e9800998ecf8427e", r.getDigest(MD5).toString()); // MD5 of ""
 	}
 
+	@Test
+	public void testUpdateMany() {
+		RHash r = new RHash(MD5);
+		byte[][] chunks = { "message".getBytes(), new byte[0], " digest".getBytes() };
+		r.updateMany(chunks).finish();
+		assertEquals("f96b697d7cb7938d525a2f31aaf161d0", r.getDigest(MD5).toString());
+	}
+
 	@Test
 	public void testMagnet() {
 		RHash r = new RHash(MD5, TTH);
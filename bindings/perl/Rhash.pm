@@ -17,7 +17,8 @@ our %EXPORT_TAGS = (
 		RHASH_SHA224 RHASH_SHA256 RHASH_SHA384 RHASH_SHA512
 		RHASH_SHA3_224 RHASH_SHA3_256 RHASH_SHA3_384 RHASH_SHA3_512
 		RHASH_HAS160 RHASH_EDONR256 RHASH_EDONR512
-		RHASH_SNEFRU128 RHASH_SNEFRU256 RHASH_ALL)]
+		RHASH_SNEFRU128 RHASH_SNEFRU256
+		RHASH_BLAKE2S RHASH_BLAKE2B RHASH_BLAKE3 RHASH_ALL)]
 );
 
 Exporter::export_tags( );
@@ -59,7 +60,10 @@ use constant RHASH_SHA3_512  => 0x2000000;
 use constant RHASH_CRC32C    => 0x4000000;
 use constant RHASH_SNEFRU128 => 0x8000000;
 use constant RHASH_SNEFRU256 => 0x10000000;
-use constant RHASH_ALL       => 0x1FFFFFFF;
+use constant RHASH_BLAKE2S   => 0x20000000;
+use constant RHASH_BLAKE2B   => 0x40000000;
+use constant RHASH_BLAKE3    => 0x80000000;
+use constant RHASH_ALL       => 0xFFFFFFFF;
 
 ##############################################################################
 # Rhash class methods
@@ -92,6 +96,13 @@ sub update($$)
 	return $self;
 }
 
+sub update_many($@)
+{
+	my $self = shift;
+	rhash_updatev($self->{context}, @_);
+	return $self;
+}
+
 sub update_fd($$;$$)
 {
 	my ($self, $fd, $start, $size) = @_;
@@ -306,7 +317,10 @@ The $hash_id parameter can be union (via bitwise OR) of any of the following bit
   RHASH_EDONR256,
   RHASH_EDONR512,
   RHASH_SNEFRU128,
-  RHASH_SNEFRU256
+  RHASH_SNEFRU256,
+  RHASH_BLAKE2S,
+  RHASH_BLAKE2B,
+  RHASH_BLAKE3
 
 Also the RHASH_ALL bit mask is the union of all listed bit-flags.
 So the object created via Crypt::Rhash->new(RHASH_ALL) calculates all
@@ -324,6 +338,12 @@ It returns the $rhash object itself allowing the following construction:
 
   $rhash = Crypt::Rhash->new(RHASH_MD5)->update( $chunk1 )->update( $chunk2 );
 
+=item $rhash->update_many( @chunks )
+
+Calculates hashes of several message chunks at once.
+The result is the same as of calling the update method for every chunk,
+but is faster for many small chunks.
+
 =item $rhash->update_file( $file_path, $start, $size )
 
 =item $rhash->update_fd( $fd, $start, $size )
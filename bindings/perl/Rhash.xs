@@ -109,6 +109,24 @@ rhash_update(ctx, message)
 	OUTPUT:
 		RETVAL
 
+int
+rhash_updatev(ctx, ...)
+		rhash_context * ctx
+	PREINIT:
+		rhash_iovec* iov;
+		STRLEN length;
+		int i;
+	CODE:
+		Newx(iov, items, rhash_iovec);
+		for (i = 1; i < items; i++) {
+			iov[i - 1].iov_base = SvPV(ST(i), length);
+			iov[i - 1].iov_len = length;
+		}
+		RETVAL = rhash_updatev(ctx, iov, items - 1);
+		Safefree(iov);
+	OUTPUT:
+		RETVAL
+
 int
 rhash_final(ctx)
 		rhash_context * ctx
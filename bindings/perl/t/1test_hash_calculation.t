@@ -1,4 +1,4 @@
-use Test::More tests => 22;
+use Test::More tests => 24;
 BEGIN { use_ok('Crypt::Rhash') };
 
 #########################
@@ -23,6 +23,10 @@ is( $r->hashed_length(), length($msg));
 is( $r->hash_id(), (RHASH_MD5 | RHASH_TTH));
 $r = undef; # destruct the Rhash object
 
+$r = new Crypt::Rhash(RHASH_MD5);
+ok( $r->update_many("message", "", " digest") );
+is( $r->hash(), "f96b697d7cb7938d525a2f31aaf161d0");
+
 #########################
 # test hashing a file
 
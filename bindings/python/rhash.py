@@ -28,7 +28,7 @@ Here  hash_id  is one of the constants CRC32, CRC32C, MD4, MD5,
 SHA1, TIGER, TTH, BTIH, ED2K, AICH,  WHIRLPOOL, RIPEMD160,
 GOST94, GOST94_CRYPTOPRO, GOST12_256, GOST12_512, HAS160,
 SHA224, SHA256, SHA384, SHA512, SHA3_224, SHA3_256, SHA3_384, SHA3_512,
-EDONR256, EDONR512, SNEFRU128, SNEFRU256.
+EDONR256, EDONR512, SNEFRU128, SNEFRU256, BLAKE2S, BLAKE2B, BLAKE3.
 The first  two functions  will  return the  default text representation
 of the message digest they compute.  The latter will return the
 magnet link  for the  file. In this function  you can OR-combine
@@ -53,6 +53,7 @@ EBE6C6E6
 In this example RHash object is first created for  a  set  of
 hashing algorithms. Then, data for hashing is given in chunks
 with   methods   update(message)  and  update_file(filename).
+Several message chunks can be hashed at once by update_many(messages).
 Finally, call finish() to end up all remaining calculations.
 
 To  receive  text represenation of the message digest use one
@@ -74,11 +75,13 @@ __all__ = [
     'GOST94_CRYPTOPRO', 'GOST12_256', 'GOST12_512', 'HAS160',
     'SHA224', 'SHA256', 'SHA384', 'SHA512', 'EDONR256', 'EDONR512',
     'SHA3_224', 'SHA3_256', 'SHA3_384', 'SHA3_512', 'SNEFRU128', 'SNEFRU256',
+    'BLAKE2S', 'BLAKE2B', 'BLAKE3',
     'RHash', 'hash_for_msg', 'hash_for_file', 'magnet_for_file']
 
 import sys
 from ctypes import (
-    CDLL, c_char_p, c_int, c_size_t, c_uint, c_void_p, create_string_buffer)
+    CDLL, POINTER, Structure, c_char_p, c_int, c_size_t, c_uint, c_void_p,
+    create_string_buffer)
 
 # initialization
 if sys.platform == 'win32':
@@ -94,12 +97,17 @@ else:
 LIBRHASH = CDLL(LIBNAME)
 LIBRHASH.rhash_library_init()
 
+class _IoVec(Structure):
+    """a message buffer passed to rhash_updatev()"""
+    _fields_ = [('iov_base', c_char_p), ('iov_len', c_size_t)]
+
 # function prototypes
 LIBRHASH.rhash_init.argtypes = [c_uint]
 LIBRHASH.rhash_init.restype = c_void_p
 LIBRHASH.rhash_free.argtypes = [c_void_p]
 LIBRHASH.rhash_reset.argtypes = [c_void_p]
 LIBRHASH.rhash_update.argtypes = [c_void_p, c_char_p, c_size_t]
+LIBRHASH.rhash_updatev.argtypes = [c_void_p, POINTER(_IoVec), c_int]
 LIBRHASH.rhash_final.argtypes = [c_void_p, c_char_p]
 LIBRHASH.rhash_print.argtypes = [c_char_p, c_void_p, c_uint, c_int]
 LIBRHASH.rhash_print.restype = c_size_t
@@ -161,7 +169,10 @@ SHA3_512 = 0x2000000
 CRC32C   = 0x4000000
 SNEFRU128 = 0x08000000
 SNEFRU256 = 0x10000000
-ALL = SNEFRU256*2 - 1
+BLAKE2S  = 0x20000000
+BLAKE2B  = 0x40000000
+BLAKE3   = 0x80000000
+ALL = BLAKE3*2 - 1
 
 
 #rhash_print values
@@ -199,6 +210,16 @@ class RHash(object):
         LIBRHASH.rhash_update(self._ctx, data, len(data))
         return self
 
+    def update_many(self, messages):
+        """update this object with several data chunks at once"""
+        chunks = [_msg_to_bytes(message) for message in messages]
+        iov = (_IoVec * len(chunks))()
+        for i, data in enumerate(chunks):
+            iov[i].iov_base = data
+            iov[i].iov_len = len(data)
+        LIBRHASH.rhash_updatev(self._ctx, iov, len(chunks))
+        return self
+
     def __lshift__(self, message):
         return self.update(message)
 
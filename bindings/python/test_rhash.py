@@ -95,6 +95,15 @@ class TestRHash(unittest.TestCase):
         self.assertEqual(
             '697f2d856172cb8309d6b8b97dac4de344b549d4dee61edfb4962d8698b7fa803f4f93ff24393586e28b5b957ac3d1d369420ce53332712f997bd336d09ab02a',
             ctx.hash(rhash.SHA3_512))
+        self.assertEqual(
+            '4a0d129873403037c2cd9b9048203687f6233fb6738956e0349bd4320fec3e90',
+            ctx.hash(rhash.BLAKE2S))
+        self.assertEqual(
+            '333fcb4ee1aa7c115355ec66ceac917c8bfd815bf7587d325aec1864edd24e34d5abe2c6b1b5ee3face62fed78dbef802f2a85cb91d455a8f5249d330853cb3c',
+            ctx.hash(rhash.BLAKE2B))
+        self.assertEqual(
+            '17762fddd969a453925d65717ac3eea21320b66b54342fde15128d6caf21215f',
+            ctx.hash(rhash.BLAKE3))
         # test reset
         self.assertEqual(
             'd41d8cd98f00b204e9800998ecf8427e',
@@ -107,6 +116,13 @@ class TestRHash(unittest.TestCase):
         self.assertEqual('EBE6C6E6', ctx.HEX(rhash.CRC32))
         self.assertEqual('6cd3556deb0da54bca060b4c39479839', ctx.hex(rhash.MD5))
 
+    def test_update_many(self):
+        """Test the update_many() method"""
+        ctx = rhash.RHash(rhash.CRC32 | rhash.MD5)
+        ctx.update_many(['Hello', ', ', '', 'world!']).finish()
+        self.assertEqual('EBE6C6E6', ctx.HEX(rhash.CRC32))
+        self.assertEqual('6cd3556deb0da54bca060b4c39479839', ctx.hex(rhash.MD5))
+
     def test_shift_operator(self):
         """Test the << operator"""
         ctx = rhash.RHash(rhash.MD5)
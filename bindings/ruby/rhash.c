@@ -44,6 +44,38 @@ static VALUE rh_update(VALUE self, VALUE msg) {
 	return self;
 }
 
+/**
+ * call-seq:
+ *   rhash.update_many(array) -> RHash
+ *
+ * Updates this <code>RHash</code> with several data chunks at once.
+ */
+static VALUE rh_update_many(VALUE self, VALUE msgs) {
+	rhash ctx;
+	rhash_iovec* iov;
+	VALUE strings;
+	long i, count;
+	Data_Get_Struct(self, struct rhash_context, ctx);
+
+	msgs = rb_Array(msgs);
+	count = RARRAY_LEN(msgs);
+	strings = rb_ary_new2(count); /* keep converted strings from GC */
+	iov = ALLOC_N(rhash_iovec, count);
+	for (i = 0; i < count; i++) {
+		VALUE msg = rb_ary_entry(msgs, i);
+		if (TYPE(msg) != T_STRING) {
+			msg = rb_obj_as_string(msg); /* convert to string */
+		}
+		rb_ary_push(strings, msg);
+		iov[i].iov_base = RSTRING_PTR(msg);
+		iov[i].iov_len = RSTRING_LEN(msg);
+	}
+	rhash_updatev(ctx, iov, (int)count);
+	xfree(iov);
+	RB_GC_GUARD(strings);
+	return self;
+}
+
 /* declaring non-static method to fix a warning on an unused function */
 VALUE rh_update_file(VALUE self, VALUE file);
 
@@ -93,7 +125,7 @@ static VALUE rh_print(VALUE self, VALUE type, int flags) {
 	char buf[130];
 	rhash ctx;
 	Data_Get_Struct(self, struct rhash_context, ctx);
-	len = rhash_print(buf, ctx, type == Qnil ? 0 : FIX2INT(type), flags);
+	len = rhash_print(buf, ctx, type == Qnil ? 0 : NUM2UINT(type), flags);
 	return rb_str_new(buf, len);
 }
 
@@ -215,7 +247,7 @@ static VALUE rh_to_s(int argc, VALUE* argv, VALUE self) {
  * base32 and false if it is hexadecimal.
  */
 static VALUE rh_is_base32(VALUE self, VALUE type) {
-	return rhash_is_base32(FIX2INT(type)) ? Qtrue : Qfalse;
+	return rhash_is_base32(NUM2UINT(type)) ? Qtrue : Qfalse;
 }
 
 static VALUE rh_init(int argc, VALUE *argv, VALUE self) {
@@ -234,7 +266,7 @@ VALUE rh_new(int argc, VALUE* argv, VALUE clz) {
 	VALUE newobj;
 	int flags = 0, i;
 	for (i=0; i<argc; i++) {
-		flags |= FIX2INT(argv[i]);
+		flags |= NUM2UINT(argv[i]);
 	}
 	if (!flags) flags = RHASH_ALL_HASHES;
 	ctx = rhash_init(flags);
@@ -287,6 +319,7 @@ void Init_rhash() {
 	rb_define_method(cRHash, "initialize", rh_init,  -1);
 	rb_define_method(cRHash, "update",     rh_update, 1);
 	rb_define_method(cRHash, "<<",         rh_update, 1);
+	rb_define_method(cRHash, "update_many", rh_update_many, 1);
 	rb_define_method(cRHash, "finish",     rh_finish, 0);
 	rb_define_method(cRHash, "reset",      rh_reset,  0);
 	rb_define_method(cRHash, "to_raw",     rh_to_raw, -1);
@@ -378,7 +411,13 @@ end");
 	rb_define_const(cRHash, "SNEFRU128", INT2FIX(RHASH_SNEFRU128));
 	/** Snefru-256 hash. */
 	rb_define_const(cRHash, "SNEFRU256", INT2FIX(RHASH_SNEFRU256));
+	/** BLAKE2s hash. */
+	rb_define_const(cRHash, "BLAKE2S",   INT2FIX(RHASH_BLAKE2S));
+	/** BLAKE2b hash. */
+	rb_define_const(cRHash, "BLAKE2B",   INT2FIX(RHASH_BLAKE2B));
+	/** BLAKE3 hash. */
+	rb_define_const(cRHash, "BLAKE3",    UINT2NUM(RHASH_BLAKE3));
 	/** Create RHash with this parameter to compute hashes for all available algorithms. */
-	rb_define_const(cRHash, "ALL",       INT2FIX(RHASH_ALL_HASHES));
+	rb_define_const(cRHash, "ALL",       UINT2NUM(RHASH_ALL_HASHES));
 }
 
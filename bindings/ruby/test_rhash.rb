@@ -63,6 +63,13 @@ class TestRHash < Test::Unit::TestCase
 	assert_equal("magnet:?xl=3&dn=file.txt&xt=urn:md5:900150983cd24fb0d6963f7d28e17f72&xt=urn:tree:tiger:asd4ujseh5m47pdyb46kbtsqtsgdklbhyxomuia", r.magnet("file.txt"))
     end
 
+    def test_update_many
+	r = RHash.new(RHash::CRC32, RHash::MD5)
+	r.update_many(["Hello", ", ", "", "world!"]).finish()
+	assert_equal("ebe6c6e6", r.to_s(RHash::CRC32))
+	assert_equal("6cd3556deb0da54bca060b4c39479839", r.to_s(RHash::MD5))
+    end
+
     def test_update_file
 	path = "ruby_test_input_123.txt"
 	File.open(path, 'wb') { |f| f.write("\0\1\2\n") }
@@ -0,0 +1,493 @@
+/* block_index.c - sidecar files storing hashes of blocks of a file */
+
+/* use 64-bit off_t, must be defined before any include file */
+#undef _LARGEFILE64_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include "platform.h" /* read() on unix */
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+# include <io.h>
+# define rsh_lseek(fd, offset, origin) _lseeki64(fd, offset, origin)
+#else
+# define rsh_lseek(fd, offset, origin) lseek(fd, (off_t)(offset), origin)
+#endif
+
+#include "block_index.h"
+#include "common_func.h"
+#include "file.h"
+#include "output.h"
+#include "parse_cmdline.h"
+#include "rhash_main.h"
+#include "librhash/rhash.h"
+
+#define BLOCK_INDEX_MAGIC "RHBLOCK1"
+#define BLOCK_INDEX_HEADER_SIZE 32
+/* the hash function used to hash file blocks */
+#define BLOCK_INDEX_HASH_ID RHASH_SHA1
+/* the number of blocks hashed together */
+#define BLOCKS_BATCH 8
+
+/* little-endian serialization of the index header */
+static void put_le32(unsigned char* p, unsigned value)
+{
+	p[0] = (unsigned char)value;
+	p[1] = (unsigned char)(value >> 8);
+	p[2] = (unsigned char)(value >> 16);
+	p[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned get_le32(const unsigned char* p)
+{
+	return p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+/**
+ * Initialize an empty block index.
+ *
+ * @param index the block index to initialize
+ */
+void block_index_init(block_index* index)
+{
+	memset(index, 0, sizeof(*index));
+	index->hash_id = BLOCK_INDEX_HASH_ID;
+	index->hash_size = (unsigned)rhash_get_digest_size(BLOCK_INDEX_HASH_ID);
+	index->block_size = BLOCK_INDEX_BLOCK_SIZE;
+}
+
+/**
+ * Free memory allocated by a block index.
+ *
+ * @param index the block index to clean up
+ */
+void block_index_cleanup(block_index* index)
+{
+	free(index->hashes);
+	free(index->tail);
+	index->hashes = index->tail = NULL;
+	index->count = index->allocated = index->tail_size = 0;
+}
+
+/**
+ * Calculate hashes of consecutive blocks of a file.
+ *
+ * @param index the block index to store hashes into
+ * @param data the blocks to hash
+ * @param size the size of data, it must be a multiple of the block size,
+ *             unless the data ends the file
+ * @param results the array to store hashes into
+ */
+static void hash_blocks(block_index* index, const unsigned char* data, size_t size, unsigned char* results)
+{
+	const void* messages[BLOCKS_BATCH];
+	size_t lengths[BLOCKS_BATCH];
+	unsigned char* hashes[BLOCKS_BATCH];
+	size_t count = 0;
+
+	while (size > 0) {
+		size_t length = (size < index->block_size ? size : index->block_size);
+		messages[count] = data;
+		lengths[count] = length;
+		hashes[count] = results + count * index->hash_size;
+		data += length;
+		size -= length;
+		if (++count == BLOCKS_BATCH || size == 0) {
+			rhash_msg_batch(index->hash_id, messages, lengths, hashes, count);
+			results += count * index->hash_size;
+			count = 0;
+		}
+	}
+}
+
+/**
+ * Hash consecutive blocks of a file and append their hashes to the index.
+ *
+ * @param index the block index
+ * @param data the blocks to hash
+ * @param size the size of data, it must be a multiple of the block size,
+ *             unless the data ends the file
+ */
+static void add_blocks(block_index* index, const unsigned char* data, size_t size)
+{
+	size_t count = (size + index->block_size - 1) / index->block_size;
+	if (index->count + count > index->allocated) {
+		index->allocated = (index->allocated < 64 ? 64 : index->allocated * 2);
+		if (index->allocated < index->count + count)
+			index->allocated = index->count + count;
+		index->hashes = (unsigned char*)rsh_realloc(index->hashes, index->allocated * index->hash_size);
+	}
+	hash_blocks(index, data, size, index->hashes + index->count * index->hash_size);
+	index->count += count;
+	index->file_size += size;
+}
+
+/**
+ * Add a part of a file to the index, hashing its complete blocks.
+ * The incomplete block at the end of the data is kept until it is
+ * completed by the next call or hashed by block_index_finish().
+ *
+ * @param index the block index
+ * @param data the next part of the file
+ * @param size the size of data
+ */
+void block_index_add(block_index* index, const unsigned char* data, size_t size)
+{
+	size_t whole;
+	if (index->tail_size > 0) {
+		size_t left = index->block_size - index->tail_size;
+		if (left > size)
+			left = size;
+		memcpy(index->tail + index->tail_size, data, left);
+		index->tail_size += left;
+		data += left;
+		size -= left;
+		if (index->tail_size < index->block_size)
+			return;
+		add_blocks(index, index->tail, index->tail_size);
+		index->tail_size = 0;
+	}
+	whole = size - size % index->block_size;
+	if (whole > 0)
+		add_blocks(index, data, whole);
+	if (size > whole) {
+		if (!index->tail)
+			index->tail = (unsigned char*)rsh_malloc(index->block_size);
+		memcpy(index->tail, data + whole, size - whole);
+		index->tail_size = size - whole;
+	}
+}
+
+/**
+ * Hash the last incomplete block of a file, after the whole file is added.
+ *
+ * @param index the block index
+ */
+void block_index_finish(block_index* index)
+{
+	if (index->tail_size > 0) {
+		add_blocks(index, index->tail, index->tail_size);
+		index->tail_size = 0;
+	}
+}
+
+/**
+ * Save a block index to the given file.
+ *
+ * @param index the block index to save
+ * @param file the file to write
+ * @return 0 on success, -1 on error with error code in errno
+ */
+int block_index_save(block_index* index, file_t* file)
+{
+	unsigned char header[BLOCK_INDEX_HEADER_SIZE];
+	size_t size = index->count * index->hash_size;
+	FILE* fd;
+	int res = -1;
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, BLOCK_INDEX_MAGIC, 8);
+	put_le32(header + 8, index->hash_id);
+	put_le32(header + 12, index->block_size);
+	put_le32(header + 16, (unsigned)index->file_size);
+	put_le32(header + 20, (unsigned)(index->file_size >> 32));
+	put_le32(header + 24, index->hash_size);
+
+	fd = file_fopen(file, FOpenWrite | FOpenBin);
+	if (!fd)
+		return -1;
+	if (fwrite(header, 1, sizeof(header), fd) == sizeof(header) &&
+			fwrite(index->hashes, 1, size, fd) == size)
+		res = 0;
+	if (fclose(fd) != 0)
+		res = -1;
+	return res;
+}
+
+/**
+ * Load a block index from the given file.
+ *
+ * @param index the block index to load into
+ * @param file the file to read
+ * @return 0 on success, -1 on error with error code in errno
+ */
+int block_index_load(block_index* index, file_t* file)
+{
+	unsigned char header[BLOCK_INDEX_HEADER_SIZE];
+	uint64_t count;
+	size_t size;
+	FILE* fd = file_fopen(file, FOpenRead | FOpenBin);
+	if (!fd)
+		return -1;
+
+	block_index_cleanup(index);
+	if (fread(header, 1, sizeof(header), fd) != sizeof(header) ||
+			memcmp(header, BLOCK_INDEX_MAGIC, 8) != 0)
+		goto invalid;
+	index->hash_id = get_le32(header + 8);
+	index->block_size = get_le32(header + 12);
+	index->file_size = get_le32(header + 16) | ((uint64_t)get_le32(header + 20) << 32);
+	index->hash_size = get_le32(header + 24);
+	if (index->block_size == 0 || index->hash_id == 0 || (index->hash_id & (index->hash_id - 1)) != 0 ||
+			(int)index->hash_size != rhash_get_digest_size(index->hash_id))
+		goto invalid;
+	count = (index->file_size + index->block_size - 1) / index->block_size;
+	if (count > ((size_t)-1) / index->hash_size)
+		goto invalid;
+	size = (size_t)count * index->hash_size;
+	index->hashes = (unsigned char*)rsh_malloc(size ? size : 1);
+	index->count = index->allocated = (size_t)count;
+	if (fread(index->hashes, 1, size, fd) != size)
+		goto invalid;
+	fclose(fd);
+	return 0;
+invalid:
+	fclose(fd);
+	block_index_cleanup(index);
+	errno = EINVAL;
+	return -1;
+}
+
+/**
+ * Check if the given path is the path of a block index.
+ *
+ * @param path the path to check
+ * @return 1 if the path has the block index suffix, 0 otherwise
+ */
+int is_block_index_path(const char* path)
+{
+	size_t length = strlen(path);
+	size_t suffix_length = sizeof(BLOCK_INDEX_SUFFIX) - 1;
+	return (length > suffix_length && strcmp(path + length - suffix_length, BLOCK_INDEX_SUFFIX) == 0);
+}
+
+/**
+ * A vector of corrupted byte ranges of a file.
+ */
+struct byte_ranges
+{
+	uint64_t* ranges; /* pairs of the first and the last byte of a range */
+	size_t count;
+	size_t allocated;
+};
+
+/**
+ * Add a corrupted block to the byte ranges, merging adjacent blocks.
+ *
+ * @param br the byte ranges
+ * @param start the first byte of the block
+ * @param end the last byte of the block
+ */
+static void add_byte_range(struct byte_ranges* br, uint64_t start, uint64_t end)
+{
+	if (br->count > 0 && br->ranges[br->count * 2 - 1] + 1 == start) {
+		br->ranges[br->count * 2 - 1] = end;
+		return;
+	}
+	if (br->count >= br->allocated) {
+		br->allocated = (br->allocated ? br->allocated * 2 : 16);
+		br->ranges = (uint64_t*)rsh_realloc(br->ranges, br->allocated * 2 * sizeof(uint64_t));
+	}
+	br->ranges[br->count * 2] = start;
+	br->ranges[br->count * 2 + 1] = end;
+	br->count++;
+}
+
+/**
+ * Read a buffer from a file, until it is full or the file ends.
+ *
+ * @param fd the file descriptor
+ * @param buffer the buffer to read into
+ * @param size the size of the buffer
+ * @return the number of bytes read, or -1 on error
+ */
+static long read_full(int fd, unsigned char* buffer, size_t size)
+{
+	size_t length = 0;
+	while (length < size) {
+		int res = (int)read(fd, buffer + length, (unsigned)(size - length));
+		if (res < 0)
+			return -1;
+		if (res == 0)
+			break;
+		length += res;
+	}
+	return (long)length;
+}
+
+/**
+ * Resume building the block index of a file, which hashing is resumed from
+ * a checkpoint. The index saved together with the checkpoint is loaded,
+ * and the incomplete block before the checkpoint is read from the file.
+ * On success the file is positioned at the checkpoint offset.
+ *
+ * @param index the block index to resume
+ * @param file the hashed file
+ * @param fd the descriptor of the opened file
+ * @param offset the hashed size of the file at the checkpoint
+ * @return 0 on success, -1 if the saved index can't be resumed
+ */
+int block_index_resume(block_index* index, file_t* file, int fd, uint64_t offset)
+{
+	file_t index_file;
+	size_t tail_size;
+	int res;
+
+	file_path_append(&index_file, file, BLOCK_INDEX_SUFFIX);
+	res = block_index_load(index, &index_file);
+	file_cleanup(&index_file);
+	if (res == 0 && (index->hash_id != BLOCK_INDEX_HASH_ID || index->block_size != BLOCK_INDEX_BLOCK_SIZE ||
+			index->file_size % index->block_size != 0 || index->file_size > offset ||
+			offset - index->file_size >= index->block_size))
+		res = -1;
+	if (res == 0) {
+		tail_size = (size_t)(offset - index->file_size);
+		index->tail = (unsigned char*)rsh_malloc(index->block_size);
+		if (rsh_lseek(fd, index->file_size, SEEK_SET) < 0 ||
+				read_full(fd, index->tail, tail_size) != (long)tail_size)
+			res = -1;
+		index->tail_size = tail_size;
+	}
+	if (res < 0) {
+		block_index_cleanup(index);
+		block_index_init(index);
+	}
+	return res;
+}
+
+/**
+ * Verify the blocks of a file, in the byte range specified by the --range
+ * option, against the block index of the file. Print corrupted byte ranges.
+ * With the --fail-fast option the verification stops at the first corrupted block.
+ *
+ * @param file the file to verify
+ * @param print_path the path to print
+ * @param is_root non-zero if the file is specified by the command line,
+ *                then a missing block index is reported as an error
+ * @return 0 on success, -1 on input/output error or if the range is outside
+ *         of the file, -2 if the file is corrupted
+ */
+int check_file_blocks(file_t* file, const char* print_path, int is_root)
+{
+	block_index index;
+	file_t index_file;
+	struct byte_ranges bad;
+	unsigned char hashes[BLOCKS_BATCH * 64];
+	unsigned char* buffer = NULL;
+	uint64_t end, size;
+	size_t block, last_block, i;
+	int wrong_size = 0;
+	int fd = -1;
+	int res = 0;
+
+	block_index_init(&index);
+	file_path_append(&index_file, file, BLOCK_INDEX_SUFFIX);
+	if (block_index_load(&index, &index_file) < 0) {
+		if (errno == ENOENT && !is_root) {
+			/* skip a file without index, found by recursive search */
+			file_cleanup(&index_file);
+			return 0;
+		}
+		log_file_t_error(&index_file);
+		file_cleanup(&index_file);
+		rhash_data.processed++;
+		return -1;
+	}
+	file_cleanup(&index_file);
+	memset(&bad, 0, sizeof(bad));
+	assert(index.hash_size * BLOCKS_BATCH <= sizeof(hashes));
+
+	rsh_fprintf(rhash_data.out, "%-51s ", print_path);
+	fflush(rhash_data.out);
+
+	/* only the blocks present both in the file and in its index can be verified */
+	if (file->size != index.file_size)
+		wrong_size = 1;
+	size = (file->size < index.file_size ? file->size : index.file_size);
+	end = (opt.block_range_end && opt.block_range_end < size ? opt.block_range_end : size);
+	block = (size_t)(opt.block_range_start / index.block_size);
+	last_block = (size_t)((end + index.block_size - 1) / index.block_size);
+
+	/* a range starting past the verified size has no blocks to verify */
+	if (opt.block_range_start > 0 && opt.block_range_start >= size)
+		res = -3;
+	else if (block < last_block) {
+		fd = file_open(file, FOpenRead | FOpenBin);
+		if (fd < 0 || rsh_lseek(fd, (uint64_t)block * index.block_size, SEEK_SET) < 0)
+			res = -1;
+		else
+			buffer = (unsigned char*)rsh_malloc(index.block_size * BLOCKS_BATCH);
+	}
+	while (res == 0 && block < last_block && !rhash_data.interrupted) {
+		size_t count = last_block - block;
+		long length;
+		if (count > BLOCKS_BATCH) count = BLOCKS_BATCH;
+		length = read_full(fd, buffer, count * index.block_size);
+		if (length < 0) {
+			res = -1;
+			break;
+		}
+		/* the file can be shorter, than the indexed one */
+		if ((uint64_t)length > size - (uint64_t)block * index.block_size)
+			length = (long)(size - (uint64_t)block * index.block_size);
+		count = ((size_t)length + index.block_size - 1) / index.block_size;
+		if (count == 0)
+			break;
+		hash_blocks(&index, buffer, (size_t)length, hashes);
+		for (i = 0; i < count; i++) {
+			uint64_t offset = (uint64_t)(block + i) * index.block_size;
+			uint64_t block_end = offset + index.block_size;
+			if (block_end > size) block_end = size;
+			/* the last block of a truncated or extended file is always corrupted */
+			if (memcmp(hashes + i * index.hash_size, index.hashes + (block + i) * index.hash_size, index.hash_size) != 0 ||
+					(wrong_size && block_end == size)) {
+				add_byte_range(&bad, offset, block_end - 1);
+				if (opt.flags & OPT_FAIL_FAST)
+					break;
+			}
+		}
+		block += count;
+		if (bad.count > 0 && (opt.flags & OPT_FAIL_FAST))
+			break;
+	}
+	if (fd >= 0)
+		close(fd);
+	free(buffer);
+
+	if (res == -3) {
+		rsh_fprintf(rhash_data.out, _("ERR\n  range is outside of the file\n"));
+		res = -1;
+	} else if (res < 0) {
+		rsh_fprintf(rhash_data.out, "%s\n", strerror(errno));
+	} else if (bad.count == 0 && !wrong_size) {
+		if (!(opt.flags & OPT_SKIP_OK))
+			rsh_fprintf(rhash_data.out, _("OK \n"));
+		else
+			rsh_fprintf(rhash_data.out, "\r%-51s   \r", "");
+		rhash_data.ok++;
+	} else {
+		char start_str[24], end_str[24];
+		rsh_fprintf(rhash_data.out, _("ERR\n"));
+		if (wrong_size) {
+			sprintI64(start_str, file->size, 0);
+			sprintI64(end_str, index.file_size, 0);
+			rsh_fprintf(rhash_data.out, _("  file size is %s, indexed size is %s\n"), start_str, end_str);
+		}
+		for (i = 0; i < bad.count; i++) {
+			sprintI64(start_str, bad.ranges[i * 2], 0);
+			sprintI64(end_str, bad.ranges[i * 2 + 1], 0);
+			rsh_fprintf(rhash_data.out, _("  corrupted bytes %s-%s\n"), start_str, end_str);
+		}
+		res = -2;
+	}
+	fflush(rhash_data.out);
+	rhash_data.processed++;
+	free(bad.ranges);
+	block_index_cleanup(&index);
+	return res;
+}
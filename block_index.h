@@ -0,0 +1,51 @@
+/* block_index.h - sidecar files storing hashes of blocks of a file */
+#ifndef BLOCK_INDEX_H
+#define BLOCK_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the suffix appended to a file path to get the path of its block index */
+#define BLOCK_INDEX_SUFFIX ".rhi"
+/* the size of a file block, hashed separately */
+#define BLOCK_INDEX_BLOCK_SIZE (1024 * 1024)
+/* the size of a read buffer, holding several blocks to hash them together */
+#define BLOCK_INDEX_READ_SIZE (8 * BLOCK_INDEX_BLOCK_SIZE)
+
+struct file_t;
+
+/**
+ * Hashes of consecutive blocks of a file.
+ */
+typedef struct block_index
+{
+	unsigned hash_id;      /* the hash function used to hash blocks */
+	unsigned hash_size;    /* the size of a block hash in bytes */
+	unsigned block_size;   /* the size of a file block */
+	uint64_t file_size;    /* the size of the indexed file */
+	size_t count;          /* the number of hashed blocks */
+	size_t allocated;      /* the number of blocks allocated in the hashes array */
+	unsigned char* hashes; /* hashes of blocks */
+	unsigned char* tail;   /* the incomplete block, not hashed yet */
+	size_t tail_size;      /* the size of the incomplete block */
+} block_index;
+
+void block_index_init(block_index* index);
+void block_index_cleanup(block_index* index);
+void block_index_add(block_index* index, const unsigned char* data, size_t size);
+void block_index_finish(block_index* index);
+int block_index_resume(block_index* index, struct file_t* file, int fd, uint64_t offset);
+int block_index_save(block_index* index, struct file_t* file);
+int block_index_load(block_index* index, struct file_t* file);
+int is_block_index_path(const char* path);
+int check_file_blocks(struct file_t* file, const char* print_path, int is_root);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* BLOCK_INDEX_H */
@@ -1,5 +1,11 @@
 /* calc_sums.c - crc calculating and printing functions */
 
+/* use 64-bit off_t, must be defined before any include file */
+#undef _LARGEFILE64_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
 #include "platform.h" /* unlink() on unix */
 #include <stdio.h>
 #include <string.h>
@@ -12,15 +18,54 @@
 #endif
 
 #include "calc_sums.h"
+#include "block_index.h"
 #include "common_func.h"
 #include "hash_print.h"
 #include "output.h"
 #include "parse_cmdline.h"
 #include "rhash_main.h"
+#include "torrent_update.h"
 #include "win_utils.h"
 #include "librhash/rhash.h"
 #include "librhash/rhash_torrent.h"
 
+#ifdef _WIN32
+# define rsh_lseek(fd, offset, origin) _lseeki64(fd, offset, origin)
+#else
+# define rsh_lseek(fd, offset, origin) lseek(fd, (off_t)(offset), origin)
+#endif
+
+/* hash sums, which split a file between threads of a context */
+#define SPLIT_HASHES (RHASH_TTH | RHASH_BTIH | RHASH_ED2K | RHASH_AICH | RHASH_BLAKE3)
+/* the minimal size of a file to be hashed by all threads together */
+#define MIN_SPLIT_FILE_SIZE (64 * 1024 * 1024)
+/* the size of a block read for every thread of a context */
+#define THREAD_IO_BLOCK_SIZE (8 * 1024 * 1024)
+/* the maximal size of a block read from a file */
+#define MAX_IO_BLOCK_SIZE (64 * 1024 * 1024)
+/* the number of hashed bytes between saved checkpoints */
+#define CHECKPOINT_INTERVAL (256 * 1024 * 1024)
+#define CHECKPOINT_MAGIC "RHASHCP1"
+
+/**
+ * Set the length of a torrent piece, specified by the command line.
+ *
+ * @param info the file data
+ */
+static void set_bt_piece_length(struct file_info *info)
+{
+	if (torrent_update_piece_length()) {
+		/* keep pieces aligned with the updated torrent */
+		rhash_torrent_set_piece_length(info->rctx, torrent_update_piece_length());
+	}
+	else if (opt.bt_piece_length) {
+		rhash_torrent_set_piece_length(info->rctx, opt.bt_piece_length);
+	}
+	else if (opt.bt_batch_file && rhash_data.batch_size) {
+		rhash_torrent_set_batch_size(info->rctx, rhash_data.batch_size);
+	}
+}
+
 /**
  * Initialize BTIH hash function. Unlike other algorithms BTIH
  * requires more data for correct computation.
@@ -34,8 +79,11 @@ static void init_btih_data(struct file_info *info)
 	rhash_torrent_add_file(info->rctx, file_info_get_utf8_print_path(info), info->size);
 	rhash_torrent_set_program_name(info->rctx, get_bt_program_name());
 
+	/* torrent files are streamed to disk, keeping memory usage bounded */
 	if (opt.flags & OPT_BT_PRIVATE) {
-		rhash_torrent_set_options(info->rctx, RHASH_TORRENT_OPT_PRIVATE);
+		rhash_torrent_set_options(info->rctx, RHASH_TORRENT_OPT_PRIVATE | RHASH_TORRENT_OPT_STREAM);
+	} else {
+		rhash_torrent_set_options(info->rctx, RHASH_TORRENT_OPT_STREAM);
 	}
 
 	if (opt.bt_announce) {
@@ -45,12 +93,36 @@ static void init_btih_data(struct file_info *info)
 		}
 	}
 
-	if (opt.bt_piece_length) {
-		rhash_torrent_set_piece_length(info->rctx, opt.bt_piece_length);
-	}
-	else if (opt.bt_batch_file && rhash_data.batch_size) {
-		rhash_torrent_set_batch_size(info->rctx, rhash_data.batch_size);
+	set_bt_piece_length(info);
+}
+
+/**
+ * Apply the command line options to a new RHash context.
+ *
+ * @param rctx the context
+ * @param sums_flags the hash sums calculated by the context
+ */
+static void set_rhash_context_options(rhash rctx, unsigned sums_flags)
+{
+	size_t io_block_size = 0;
+	if (opt.flags & OPT_DIRECT_IO)
+		rhash_set_direct_io(rctx, 1);
+	/* files hashed one by one can still split their hash sums between threads,
+	 * rhash_reinit() re-distributes the threads for the hash sums of a verified file */
+	if (opt.threads > 1) {
+		rhash_set_threads(rctx, opt.threads);
+		/* read several pieces or chunks at once to hash them in parallel */
+		if (sums_flags & SPLIT_HASHES) {
+			io_block_size = (opt.threads < MAX_IO_BLOCK_SIZE / THREAD_IO_BLOCK_SIZE ?
+				opt.threads * THREAD_IO_BLOCK_SIZE : MAX_IO_BLOCK_SIZE);
+		}
 	}
+	/* read several blocks of the block index at once to hash them together */
+	if ((opt.flags & OPT_BLOCK_INDEX) && !(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED)) &&
+			io_block_size < BLOCK_INDEX_READ_SIZE)
+		io_block_size = BLOCK_INDEX_READ_SIZE;
+	if (io_block_size)
+		rhash_set_io_block_size(rctx, io_block_size);
 }
 
 /**
@@ -62,15 +134,21 @@ static void re_init_rhash_context(struct file_info *info)
 {
 	if (rhash_data.rctx != 0) {
 		if (opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED)) {
-			/* a set of hash sums can change from file to file */
-			rhash_free(rhash_data.rctx);
-			rhash_data.rctx = 0;
+			/* a set of hash sums can change from file to file, reuse the context memory */
+			rhash rctx = rhash_reinit(rhash_data.rctx, info->sums_flags);
+			if (rctx == 0)
+				rhash_free(rhash_data.rctx);
+			else
+				set_rhash_context_options(rctx, info->sums_flags); /* the read size depends on hash sums */
+			info->rctx = rhash_data.rctx = rctx;
 		} else {
 			info->rctx = rhash_data.rctx;
 
 			if (opt.bt_batch_file) {
 				/* add another file to the torrent batch */
 				rhash_torrent_add_file(info->rctx, file_info_get_utf8_print_path(info), info->size);
+				/* adding a file before hashing any piece resets the piece length */
+				set_bt_piece_length(info);
 				return;
 			} else {
 				rhash_reset(rhash_data.rctx);
@@ -81,6 +159,7 @@ static void re_init_rhash_context(struct file_info *info)
 	if (rhash_data.rctx == 0) {
 		rhash_data.rctx = rhash_init(info->sums_flags);
 		info->rctx = rhash_data.rctx;
+		set_rhash_context_options(rhash_data.rctx, info->sums_flags);
 	}
 
 	if (info->sums_flags & RHASH_BTIH) {
@@ -89,6 +168,227 @@ static void re_init_rhash_context(struct file_info *info)
 	}
 }
 
+/**
+ * The header of a checkpoint file. It is followed by the path of the hashed
+ * file and by the rhash context, exported by rhash_export().
+ */
+struct checkpoint_header
+{
+	char magic[8];
+	uint64_t file_size;
+	uint64_t mtime;
+	unsigned path_length;
+	unsigned context_size;
+};
+
+/* the state of the checkpoint of the currently hashed file */
+static struct {
+	uint64_t offset; /* the hashed size at the last saved checkpoint */
+	int is_saved;    /* non-zero if the checkpoint of the file exists */
+	block_index* index; /* the block index saved with the checkpoint, can be NULL */
+} checkpoint;
+
+/**
+ * Get the modification time of a file, to detect changes of a file
+ * between saving its checkpoint and resuming its hashing.
+ *
+ * @param file the file
+ * @return the modification time, or 0 if unknown
+ */
+static uint64_t get_file_mtime(file_t* file)
+{
+	return (file->stats ? (uint64_t)file->stats->st_mtime : 0);
+}
+
+/**
+ * Save the block index of a file, having the path of the file
+ * with the BLOCK_INDEX_SUFFIX appended.
+ *
+ * @param file the indexed file
+ * @param index the block index to save
+ * @return 0 on success, -1 on fail
+ */
+static int save_block_index(file_t* file, block_index* index)
+{
+	file_t index_file;
+	int res;
+	file_path_append(&index_file, file, BLOCK_INDEX_SUFFIX);
+	res = block_index_save(index, &index_file);
+	if (res < 0)
+		log_file_t_error(&index_file);
+	file_cleanup(&index_file);
+	return res;
+}
+
+/**
+ * Save the state of hashing a file to the checkpoint file.
+ * The file is written under a temporary name and then renamed,
+ * so the previous checkpoint survives a failure or a crash.
+ * The block index of the file is saved before the checkpoint, so
+ * the index covers the hashed part of the file up to the checkpoint.
+ *
+ * @param info the file data
+ */
+static void save_checkpoint(struct file_info* info)
+{
+	struct checkpoint_header header;
+	file_t file, new_file;
+	size_t path_length = strlen(info->full_path);
+	size_t size = rhash_export(info->rctx, NULL, 0);
+	char* data;
+	FILE* fd;
+	int res = -1;
+
+	if (checkpoint.index && save_block_index(info->file, checkpoint.index) < 0)
+		return;
+	file_tinit(&file, opt.checkpoint_file, FILE_OPT_DONT_FREE_PATH);
+	if (size == 0) {
+		log_file_t_error(&file);
+		file_cleanup(&file);
+		return;
+	}
+	data = (char*)rsh_malloc(size);
+	size = rhash_export(info->rctx, data, size);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.file_size = info->file->size;
+	header.mtime = get_file_mtime(info->file);
+	header.path_length = (unsigned)path_length;
+	header.context_size = (unsigned)size;
+
+	file_path_append(&new_file, &file, ".new");
+	fd = file_fopen(&new_file, FOpenWrite | FOpenBin);
+	if (fd) {
+		if (size && fwrite(&header, sizeof(header), 1, fd) == 1 &&
+				fwrite(info->full_path, 1, path_length, fd) == path_length &&
+				fwrite(data, 1, size, fd) == size)
+			res = 0;
+		if (fclose(fd) != 0)
+			res = -1;
+	}
+	if (res == 0)
+		res = file_rename(&new_file, &file);
+	if (res == 0) {
+		checkpoint.offset = info->rctx->msg_size;
+		checkpoint.is_saved = 1;
+	} else
+		log_file_t_error(&file);
+	free(data);
+	file_cleanup(&new_file);
+	file_cleanup(&file);
+}
+
+/**
+ * Resume hashing of a file from its checkpoint, if the checkpoint file
+ * contains the state of hashing the same unchanged file.
+ * On success the rhash context is replaced by the imported one,
+ * and the file is positioned at the hashed size.
+ * If a block index is built, then the index saved with the checkpoint
+ * is loaded, and the checkpoint is ignored if the index can't be resumed.
+ *
+ * @param info the file data
+ * @param fd the descriptor of the opened file
+ * @param index the block index to resume, can be NULL
+ */
+static void resume_from_checkpoint(struct file_info* info, int fd, block_index* index)
+{
+	struct checkpoint_header header;
+	size_t path_length = strlen(info->full_path);
+	rhash_context* rctx = NULL;
+	int is_resumed = 0;
+	file_t file;
+	FILE* in;
+
+	checkpoint.offset = 0;
+	checkpoint.is_saved = 0;
+	file_tinit(&file, opt.checkpoint_file, FILE_OPT_DONT_FREE_PATH);
+	in = file_fopen(&file, FOpenRead | FOpenBin);
+	file_cleanup(&file);
+	if (!in)
+		return; /* there is no saved checkpoint */
+
+	if (fread(&header, sizeof(header), 1, in) == 1 &&
+			memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) == 0 &&
+			header.file_size == info->file->size &&
+			header.mtime == get_file_mtime(info->file) &&
+			header.path_length == path_length && header.context_size > 0) {
+		size_t size = path_length + header.context_size;
+		char* data = (char*)rsh_malloc(size);
+		if (fread(data, 1, size, in) == size && memcmp(data, info->full_path, path_length) == 0)
+			rctx = rhash_import(data + path_length, header.context_size);
+		free(data);
+	}
+	fclose(in);
+	if (!rctx)
+		return;
+
+	if (rctx->hash_id == info->sums_flags && rctx->msg_size <= info->file->size) {
+		if (index)
+			is_resumed = (block_index_resume(index, info->file, fd, rctx->msg_size) == 0);
+		else
+			is_resumed = (rsh_lseek(fd, rctx->msg_size, SEEK_SET) >= 0);
+	}
+	if (!is_resumed) {
+		rhash_free(rctx);
+		/* the index is built from the start of the file */
+		if (index)
+			rsh_lseek(fd, 0, SEEK_SET);
+		return;
+	}
+	set_rhash_context_options(rctx, info->sums_flags);
+	rhash_free(rhash_data.rctx);
+	rhash_data.rctx = info->rctx = rctx;
+	checkpoint.offset = rctx->msg_size;
+	checkpoint.is_saved = 1;
+	if (opt.flags & OPT_VERBOSE)
+		log_msg(_("%s: resuming from the checkpoint\n"), file_cpath(info->file));
+}
+
+/**
+ * Remove the checkpoint of a file, which has been completely hashed.
+ */
+static void remove_checkpoint(void)
+{
+	file_t file;
+	if (!checkpoint.is_saved)
+		return;
+	file_tinit(&file, opt.checkpoint_file, FILE_OPT_DONT_FREE_PATH);
+	if (file_remove(&file) < 0)
+		log_file_t_error(&file);
+	file_cleanup(&file);
+	checkpoint.is_saved = 0;
+}
+
+/**
+ * Callback from librhash, called after hashing every block of a file.
+ * It updates percents and periodically saves the checkpoint.
+ *
+ * @param data the file data
+ * @param offset the number of hashed bytes
+ */
+static void checkpoint_callback(void* data, unsigned long long offset)
+{
+	struct file_info* info = (struct file_info*)data;
+	if (percents_output->update != 0)
+		percents_output->update(info, offset);
+	if (offset >= checkpoint.offset + CHECKPOINT_INTERVAL && !rhash_data.interrupted)
+		save_checkpoint(info);
+}
+
+/**
+ * Callback from librhash, called with every hashed block of a file.
+ * It adds the block to the block index of the file.
+ *
+ * @param data the block index
+ * @param block the hashed block
+ * @param size the size of the block
+ */
+static void add_to_block_index(void* data, const void* block, size_t size)
+{
+	block_index_add((block_index*)data, (const unsigned char*)block, size);
+}
+
 /**
  * Calculate hash sums simultaneously, according to the info->sums_flags.
  * Calculated hashes are stored in info->rctx.
@@ -98,12 +398,15 @@ static void re_init_rhash_context(struct file_info *info)
  */
 static int calc_sums(struct file_info *info)
 {
-	FILE* fd = 0;
+	block_index index;
+	int fd = -1;
+	int use_checkpoint;
+	int use_block_index;
 	int res;
 
 	assert(info->file);
 	if (FILE_ISSTDIN(info->file)) {
-		fd = stdin;
+		fd = 0;
 #ifdef _WIN32
 		/* using 0 instead of _fileno(stdin). _fileno() is undefined under 'gcc -ansi' */
 		if (setmode(0, _O_BINARY) < 0)
@@ -121,9 +424,9 @@ static int calc_sums(struct file_info *info)
 			return 0;
 
 		if (!FILE_ISDATA(info->file)) {
-			fd = file_fopen(info->file, FOpenRead | FOpenBin);
+			fd = file_open(info->file, FOpenRead | FOpenBin);
 			/* quietly skip files exclusively opened by another process */
-			if (!fd)
+			if (fd < 0)
 				return -1;
 		}
 	}
@@ -132,14 +435,53 @@ static int calc_sums(struct file_info *info)
 	/* store initial msg_size, for correct calculation of percents */
 	info->msg_offset = info->rctx->msg_size;
 
+	/* skip unchanged files, covered by the updated batch torrent */
+	if (opt.bt_batch_file && fd > 0 &&
+			torrent_update_skip_file(info->file, file_info_get_utf8_print_path(info), info->rctx)) {
+		info->size = 0;
+		close(fd);
+		return 0;
+	}
+
+	use_block_index = ((opt.flags & OPT_BLOCK_INDEX) && fd > 0 &&
+		!(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED)));
+	/* a checkpoint stores the state of hashing one regular file */
+	use_checkpoint = (opt.checkpoint_file && fd > 0 && !opt.bt_batch_file &&
+		!(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED)));
+	if (use_block_index)
+		block_index_init(&index);
+	if (use_checkpoint) {
+		resume_from_checkpoint(info, fd, (use_block_index ? &index : NULL));
+		checkpoint.index = (use_block_index ? &index : NULL);
+	}
+
 	/* read and hash file content */
 	if (FILE_ISDATA(info->file))
 		res = rhash_update(info->rctx, info->file->data, info->file->size);
 	else {
-		if (percents_output->update != 0) {
+		if (use_checkpoint) {
+			rhash_set_callback(info->rctx, checkpoint_callback, info);
+		} else if (percents_output->update != 0) {
 			rhash_set_callback(info->rctx, (rhash_callback_t)percents_output->update, info);
 		}
-		res = rhash_file_update(info->rctx, fd);
+		if (use_block_index)
+			rhash_set_block_callback(info->rctx, add_to_block_index, &index);
+		res = rhash_fd_update(info->rctx, fd);
+		rhash_set_block_callback(info->rctx, NULL, NULL);
+	}
+	if (use_checkpoint) {
+		if (rhash_is_canceled(info->rctx))
+			save_checkpoint(info); /* save the progress of interrupted hashing */
+		else if (res != -1)
+			remove_checkpoint();
+		checkpoint.index = NULL;
+	}
+	if (use_block_index) {
+		if (res != -1 && !rhash_is_canceled(info->rctx)) {
+			block_index_finish(&index);
+			save_block_index(info->file, &index);
+		}
+		block_index_cleanup(&index);
 	}
 	if (res != -1 && !opt.bt_batch_file)
 		rhash_final(info->rctx, 0); /* finalize hashing */
@@ -148,8 +490,8 @@ static int calc_sums(struct file_info *info)
 	info->size = info->rctx->msg_size - info->msg_offset;
 	rhash_data.total_size += info->size;
 
-	if (fd && !FILE_ISSTDIN(info->file))
-		fclose(fd);
+	if (fd > 0)
+		close(fd);
 	return res;
 }
 
@@ -180,9 +522,14 @@ static void file_info_set_print_path(struct file_info* info, const char* print_p
 	if (opt.path_separator) {
 		wrong_sep = (opt.path_separator == '/' ? '\\' : '/');
 		if ((p = (char*)strchr(print_path, wrong_sep)) != NULL) {
-			info->allocated_ptr = rsh_strdup(print_path);
-			info->print_path = info->allocated_ptr;
-			p = info->allocated_ptr + (p - print_path);
+			char* path;
+			if (info->arena) {
+				path = rsh_arena_strdup(info->arena, print_path);
+			} else {
+				path = info->allocated_ptr = rsh_strdup(print_path);
+			}
+			info->print_path = path;
+			p = path + (p - print_path);
 
 			/* replace wrong_sep in the print_path with separator defined by options */
 			for (; *p; p++) {
@@ -311,6 +658,19 @@ int rename_file_by_embeding_crc32(struct file_info *info)
 	return 0;
 }
 
+/**
+ * Callback to write a part of a torrent file content.
+ *
+ * @param data the stream to write to
+ * @param buffer the part of the content
+ * @param size the size of the part
+ * @return 0 on success, -1 on fail
+ */
+static int write_torrent_content(void* data, const void* buffer, size_t size)
+{
+	return (fwrite(buffer, 1, size, (FILE*)data) == size ? 0 : -1);
+}
+
 /**
  * Save torrent file to the given path.
  *
@@ -320,31 +680,48 @@ int rename_file_by_embeding_crc32(struct file_info *info)
  */
 int save_torrent_to(file_t* torrent_file, rhash_context* rctx)
 {
+	file_t new_file;
 	FILE* fd;
-	int res = 0;
+	int res = -1;
 
-	const rhash_str* text = rhash_torrent_generate_content(rctx);
-	if (!text) {
-		errno = ENOMEM;
+	/* fail before touching the existing torrent file */
+	if (rhash_torrent_check_content(rctx) < 0) {
+		errno = ENOMEM; /* failed to generate the torrent content */
 		log_file_t_error(torrent_file);
 		return -1;
 	}
-	
-	/* make backup copy of the existing torrent file */
-	file_move_to_bak(torrent_file);
 
-	/* write the torrent file */
-	fd = file_fopen(torrent_file, FOpenWrite | FOpenBin);
-	if (fd && text->length == fwrite(text->str, 1, text->length, fd) &&
+	/* stream the torrent content into a temporary file */
+	file_path_append(&new_file, torrent_file, ".new");
+	errno = 0;
+	fd = file_fopen(&new_file, FOpenWrite | FOpenBin);
+	if (!fd) {
+		log_file_t_error(&new_file);
+		file_cleanup(&new_file);
+		return -1;
+	}
+	if (rhash_torrent_write_content(rctx, write_torrent_content, fd) == 0 &&
 			!ferror(fd) && !fflush(fd))
-	{
-		log_msg(_("%s saved\n"), file_cpath(torrent_file));
+		res = 0;
+	if (fclose(fd) != 0)
+		res = -1;
+
+	if (res == 0) {
+		/* make backup copy of the existing torrent file, then replace it */
+		file_move_to_bak(torrent_file);
+		if (file_rename(&new_file, torrent_file) < 0) {
+			log_error(_("can't move %s to %s: %s\n"),
+				file_cpath(&new_file), file_cpath(torrent_file), strerror(errno));
+			res = -1;
+		} else
+			log_msg(_("%s saved\n"), file_cpath(torrent_file));
 	} else {
+		if (errno == 0)
+			errno = ENOMEM; /* failed to generate the torrent content */
 		log_file_t_error(torrent_file);
-		res = -1;
+		file_remove(&new_file);
 	}
-	if (fd)
-		fclose(fd);
+	file_cleanup(&new_file);
 	return res;
 }
 
@@ -362,6 +739,338 @@ static void save_torrent(struct file_info* info)
 	file_cleanup(&torrent_file);
 }
 
+/**
+ * Print hash sums of a file, which has been already processed.
+ *
+ * @param out a stream to print to
+ * @param info the file data with calculated hash sums
+ * @param res the result of hash calculation, 0 on success, -1 on fail
+ */
+static void print_file_sums(FILE* out, struct file_info* info, int res)
+{
+	finish_percents(info, res);
+
+	if (opt.flags & OPT_EMBED_CRC) {
+		/* rename the file */
+		rename_file_by_embeding_crc32(info);
+	}
+
+	if ((opt.mode & MODE_TORRENT) && !opt.bt_batch_file) {
+		save_torrent(info);
+	}
+
+	if ((opt.mode & MODE_UPDATE) && opt.fmt == FMT_SFV && (opt.flags & OPT_VERBOSE)) {
+		/* updating SFV file: the header line is printed to the file before hashing */
+		print_sfv_header_line(rhash_data.log, info->file, 0);
+		fflush(rhash_data.log);
+	}
+
+	if (rhash_data.print_list && res >= 0) {
+		if (!opt.bt_batch_file) {
+			print_line(out, rhash_data.print_list, info);
+
+			/* print calculated line to stderr or log-file if verbose */
+			if ((opt.mode & MODE_UPDATE) && (opt.flags & OPT_VERBOSE)) {
+				print_line(rhash_data.log, rhash_data.print_list, info);
+			}
+		}
+
+		if ((opt.flags & OPT_SPEED) && info->sums_flags) {
+			print_file_time_stats(info);
+		}
+	}
+}
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+
+/**
+ * A file queued to be hashed by a hashing thread.
+ */
+struct hash_job
+{
+	file_t file;
+	struct file_info info;
+	struct rhash_context* rctx; /* the context owned by the job slot */
+	int res;   /* the result of hashing, 0 on success, -1 on fail */
+	int error; /* errno value on fail */
+	int done;  /* non-zero if the file has been hashed */
+};
+
+/**
+ * The queue of files being hashed by threads.
+ * Files are hashed in parallel, but printed in the queueing order.
+ */
+static struct hash_queue_t
+{
+	pthread_mutex_t lock;
+	pthread_cond_t job_queued; /* signaled when a job is queued or on stop */
+	pthread_cond_t job_done;   /* signaled when a job is done */
+	pthread_t* threads;
+	unsigned threads_count;
+	struct hash_job* jobs; /* ring buffer of queued jobs */
+	unsigned capacity;     /* the size of the ring buffer */
+	unsigned queued;  /* the total number of queued jobs */
+	unsigned taken;   /* the number of jobs taken by threads */
+	unsigned printed; /* the number of printed jobs */
+	int stop;
+} hash_queue;
+
+/**
+ * Callback from librhash, stopping hashing of a file on program interruption.
+ *
+ * @param data the file data
+ * @param offset the number of hashed bytes
+ */
+static void check_interrupted(void* data, unsigned long long offset)
+{
+	(void)offset;
+	if (rhash_data.interrupted)
+		rhash_cancel(((struct file_info*)data)->rctx);
+}
+
+/**
+ * Calculate hash sums of a file in a hashing thread.
+ *
+ * @param job the job describing the file to hash
+ */
+static void run_hash_job(struct hash_job* job)
+{
+	struct file_info* info = &job->info;
+	timedelta_t timer;
+	int fd;
+
+	rsh_timer_start(&timer);
+	job->res = -1;
+	if (rhash_data.interrupted || (fd = file_open(&job->file, FOpenRead | FOpenBin)) < 0) {
+		job->error = errno;
+		return;
+	}
+	info->rctx = job->rctx;
+	rhash_reset(info->rctx);
+	if (info->sums_flags & RHASH_BTIH)
+		init_btih_data(info);
+	rhash_set_callback(info->rctx, check_interrupted, info);
+
+	job->res = rhash_fd_update(info->rctx, fd);
+	job->error = errno;
+	if (job->res != -1)
+		rhash_final(info->rctx, 0);
+	info->size = info->rctx->msg_size;
+	close(fd);
+	info->time = rsh_timer_stop(&timer);
+}
+
+/**
+ * The main loop of a hashing thread.
+ *
+ * @param arg unused
+ * @return NULL
+ */
+static void* hash_thread(void* arg)
+{
+	struct hash_queue_t* q = &hash_queue;
+	(void)arg;
+	pthread_mutex_lock(&q->lock);
+	for (;;) {
+		struct hash_job* job;
+		while (!q->stop && q->taken == q->queued)
+			pthread_cond_wait(&q->job_queued, &q->lock);
+		if (q->taken == q->queued)
+			break; /* stopped and no jobs left */
+		job = &q->jobs[q->taken++ % q->capacity];
+		pthread_mutex_unlock(&q->lock);
+
+		run_hash_job(job);
+
+		pthread_mutex_lock(&q->lock);
+		job->done = 1;
+		pthread_cond_broadcast(&q->job_done);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return NULL;
+}
+
+/**
+ * Print the oldest queued job, waiting for it to be hashed if needed.
+ * Must be called with the queue lock being held.
+ *
+ * @param wait non-zero to wait for the job to be done
+ * @return 1 if a job has been printed, 0 otherwise
+ */
+static int print_queued_job(int wait)
+{
+	struct hash_queue_t* q = &hash_queue;
+	struct hash_job* job;
+	if (q->printed == q->queued)
+		return 0;
+	job = &q->jobs[q->printed % q->capacity];
+	if (!job->done) {
+		if (!wait) return 0;
+		while (!job->done)
+			pthread_cond_wait(&q->job_done, &q->lock);
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	if (job->info.rctx)
+		rhash_data.total_size += job->info.size;
+	if (!rhash_data.interrupted) {
+		if (job->res < 0) {
+			/* print i/o error */
+			errno = job->error;
+			log_file_t_error(&job->file);
+			rhash_data.error_flag = 1;
+		}
+		print_file_sums(rhash_data.out, &job->info, job->res);
+	}
+	free(job->info.full_path);
+	file_info_destroy(&job->info);
+	file_cleanup(&job->file);
+
+	pthread_mutex_lock(&q->lock);
+	q->printed++;
+	return 1;
+}
+
+/**
+ * Queue a file to be hashed by a hashing thread. Hash sums of
+ * previously queued files are printed as soon as they are ready.
+ *
+ * @param file the file to hash
+ * @param print_path the path to print
+ */
+static void queue_file(file_t* file, const char* print_path)
+{
+	struct hash_queue_t* q = &hash_queue;
+	struct hash_job* job;
+
+	pthread_mutex_lock(&q->lock);
+	/* print ready files, waiting for a free slot if the queue is full */
+	while (print_queued_job(q->queued - q->printed == q->capacity));
+
+	job = &q->jobs[q->queued % q->capacity];
+	memset(&job->info, 0, sizeof(job->info));
+	file_init(&job->file, file->path, 0);
+	job->file.size = file->size;
+	job->file.mode = file->mode & ~FILE_OPT_DONT_FREE_PATH;
+	if (file->stats) {
+		job->file.stats = (struct stat*)rsh_malloc(sizeof(struct stat));
+		memcpy(job->file.stats, file->stats, sizeof(struct stat));
+	}
+	job->info.file = &job->file;
+	job->info.full_path = rsh_strdup(file->path);
+	/* print_path points into the file path, so it is relocated to the copy */
+	if (print_path >= file->path && print_path <= file->path + strlen(file->path))
+		file_info_set_print_path(&job->info, job->file.path + (print_path - file->path));
+	else
+		file_info_set_print_path(&job->info, print_path);
+	job->info.size = file->size;
+	job->info.sums_flags = opt.sum_flags;
+	job->done = 0;
+	q->queued++;
+	pthread_cond_signal(&q->job_queued);
+	pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Print hash sums of all queued files, waiting for them to be calculated.
+ */
+void flush_hash_queue(void)
+{
+	if (!hash_queue.threads_count)
+		return;
+	pthread_mutex_lock(&hash_queue.lock);
+	while (print_queued_job(1));
+	pthread_mutex_unlock(&hash_queue.lock);
+}
+
+/**
+ * Start threads to calculate hash sums of several files in parallel.
+ * Threads are not started, if the program options don't allow it.
+ *
+ * @param threads_count the number of threads to start
+ */
+void start_hash_threads(unsigned threads_count)
+{
+	struct hash_queue_t* q = &hash_queue;
+	unsigned i;
+
+	/* progress output, batch torrents, checkpoints and block indexes require sequential processing */
+	if (threads_count < 2 || !opt.sum_flags || opt.bt_batch_file || opt.checkpoint_file ||
+			(opt.flags & (OPT_PERCENTS | OPT_BLOCK_INDEX)) ||
+			(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED | MODE_UPDATE | MODE_CHECK_BLOCKS)))
+		return;
+
+	memset(q, 0, sizeof(*q));
+	q->capacity = threads_count * 2;
+	q->jobs = (struct hash_job*)rsh_calloc(q->capacity, sizeof(struct hash_job));
+	for (i = 0; i < q->capacity; i++) {
+		q->jobs[i].rctx = rhash_init(opt.sum_flags);
+		if (!q->jobs[i].rctx) {
+			log_error("%s\n", strerror(errno));
+			rsh_exit(2);
+		}
+		if (opt.flags & OPT_DIRECT_IO)
+			rhash_set_direct_io(q->jobs[i].rctx, 1);
+	}
+	q->threads = (pthread_t*)rsh_malloc(threads_count * sizeof(pthread_t));
+	pthread_mutex_init(&q->lock, NULL);
+	pthread_cond_init(&q->job_queued, NULL);
+	pthread_cond_init(&q->job_done, NULL);
+
+	for (i = 0; i < threads_count; i++) {
+		if (pthread_create(&q->threads[i], NULL, hash_thread, NULL) != 0)
+			break;
+		q->threads_count++;
+	}
+	if (q->threads_count == 0)
+		stop_hash_threads(); /* fall back to hashing in the main thread */
+}
+
+/**
+ * Print hash sums of all queued files and stop hashing threads.
+ */
+void stop_hash_threads(void)
+{
+	struct hash_queue_t* q = &hash_queue;
+	unsigned i;
+	if (!q->jobs)
+		return;
+	flush_hash_queue();
+
+	pthread_mutex_lock(&q->lock);
+	q->stop = 1;
+	pthread_cond_broadcast(&q->job_queued);
+	pthread_mutex_unlock(&q->lock);
+	for (i = 0; i < q->threads_count; i++)
+		pthread_join(q->threads[i], NULL);
+
+	for (i = 0; i < q->capacity; i++)
+		rhash_free(q->jobs[i].rctx);
+	pthread_cond_destroy(&q->job_done);
+	pthread_cond_destroy(&q->job_queued);
+	pthread_mutex_destroy(&q->lock);
+	free(q->threads);
+	free(q->jobs);
+	memset(q, 0, sizeof(*q));
+}
+#else /* USE_PTHREADS */
+
+/* without threads support files are always hashed in the main thread */
+void start_hash_threads(unsigned threads_count)
+{
+	(void)threads_count;
+}
+
+void flush_hash_queue(void)
+{
+}
+
+void stop_hash_threads(void)
+{
+}
+#endif /* USE_PTHREADS */
+
 /**
  * Calculate and print file hash sums using printf format.
  *
@@ -376,16 +1085,28 @@ int calculate_and_print_sums(FILE* out, file_t* file, const char *print_path)
 	timedelta_t timer;
 	int res = 0;
 
+	/* skip directories */
+	if (FILE_ISDIR(file))
+		return 0;
+
+#ifdef USE_PTHREADS
+	if (hash_queue.threads_count) {
+		/* a big file is hashed by all threads in the main one, if its hash sums can be split */
+		int is_split = ((opt.sum_flags & SPLIT_HASHES) != 0 && file->size >= MIN_SPLIT_FILE_SIZE);
+		if (out == rhash_data.out && !FILE_ISSPECIAL(file) && !is_split) {
+			queue_file(file, print_path);
+			return 0;
+		}
+		flush_hash_queue(); /* keep the order of printed files */
+	}
+#endif
+
 	memset(&info, 0, sizeof(info));
 	info.file = file;
 	info.full_path = rsh_strdup(file->path);
 	file_info_set_print_path(&info, print_path);
 	info.size = file->size; /* total size, in bytes */
 	info.sums_flags = opt.sum_flags;
-	
-	/* skip directories */
-	if (FILE_ISDIR(file))
-		return 0;
 
 	/* initialize percents output */
 	init_percents(&info);
@@ -405,40 +1126,8 @@ int calculate_and_print_sums(FILE* out, file_t* file, const char *print_path)
 	}
 
 	info.time = rsh_timer_stop(&timer);
-	finish_percents(&info, res);
+	print_file_sums(out, &info, res);
 
-	if (opt.flags & OPT_EMBED_CRC) {
-		/* rename the file */
-		rename_file_by_embeding_crc32(&info);
-	}
-
-	if ((opt.mode & MODE_TORRENT) && !opt.bt_batch_file) {
-		save_torrent(&info);
-	}
-
-	if ((opt.mode & MODE_UPDATE) && opt.fmt == FMT_SFV) {
-		/* updating SFV file: print SFV header line */
-		print_sfv_header_line(rhash_data.upd_fd, file, 0);
-		if (opt.flags & OPT_VERBOSE) {
-			print_sfv_header_line(rhash_data.log, file, 0);
-			fflush(rhash_data.log);
-		}
-	}
-
-	if (rhash_data.print_list && res >= 0) {
-		if (!opt.bt_batch_file) {
-			print_line(out, rhash_data.print_list, &info);
-
-			/* print calculated line to stderr or log-file if verbose */
-			if ((opt.mode & MODE_UPDATE) && (opt.flags & OPT_VERBOSE)) {
-				print_line(rhash_data.log, rhash_data.print_list, &info);
-			}
-		}
-
-		if ((opt.flags & OPT_SPEED) && info.sums_flags) {
-			print_file_time_stats(&info);
-		}
-	}
 	free(info.full_path);
 	file_info_destroy(&info);
 	return res;
@@ -508,6 +1197,7 @@ int check_hash_file(file_t* file, int chdir)
 	const char* hash_file_path = file->path;
 	int res = 0, line_num = 0;
 	double time;
+	rsh_arena arena;
 
 	/* process --check-embedded option */
 	if (opt.mode & MODE_CHECK_EMBEDDED) {
@@ -566,10 +1256,14 @@ int check_hash_file(file_t* file, int chdir)
 			pos++;
 	} else pos = 0;
 
+	/* strings of a line are allocated from the arena, which is reset for the next line */
+	rsh_arena_init(&arena);
+
 	/* read crc file line by line */
 	for (line_num = 0; fgets(buf, sizeof(buf), fd); line_num++) {
 		char* line = buf;
 		char* path_without_ext = NULL;
+		rsh_arena_reset(&arena);
 
 		/* skip unicode BOM */
 		if (line_num == 0 && buf[0] == (char)0xEF && buf[1] == (char)0xBB && buf[2] == (char)0xBF)
@@ -582,6 +1276,7 @@ int check_hash_file(file_t* file, int chdir)
 			log_error(_("file is binary: %s\n"), hash_file_path);
 			if (fd != stdin)
 				fclose(fd);
+			rsh_arena_destroy(&arena);
 			return -1;
 		}
 
@@ -590,6 +1285,7 @@ int check_hash_file(file_t* file, int chdir)
 			continue;
 
 		memset(&info, 0, sizeof(info));
+		info.arena = &arena;
 
 		if (!hash_check_parse_line(line, &info.hc, !feof(fd)))
 			continue;
@@ -602,7 +1298,7 @@ int check_hash_file(file_t* file, int chdir)
 		/* see if crc file contains a hash sum without a filename */
 		if (info.print_path == NULL) {
 			char* point;
-			path_without_ext = rsh_strdup(hash_file_path);
+			path_without_ext = rsh_arena_strdup(&arena, hash_file_path);
 			point = strrchr(path_without_ext, '.');
 
 			if (point) {
@@ -619,14 +1315,13 @@ int check_hash_file(file_t* file, int chdir)
 			/* if filename shall be prepended by a directory path */
 			if (pos && !is_absolute) {
 				size_t len = strlen(info.print_path);
-				info.full_path = (char*)rsh_malloc(pos + len + 1);
+				info.full_path = (char*)rsh_arena_alloc(&arena, pos + len + 1);
 				memcpy(info.full_path, hash_file_path, pos);
 				strcpy(info.full_path + pos, info.print_path);
 			} else {
-				info.full_path = rsh_strdup(info.print_path);
+				info.full_path = rsh_arena_strdup(&arena, info.print_path);
 			}
-			memset(&file_to_check, 0, sizeof(file_t));
-			file_to_check.path = info.full_path;
+			file_init(&file_to_check, info.full_path, FILE_OPT_DONT_FREE_PATH);
 			file_stat(&file_to_check, 0);
 			info.file = &file_to_check;
 
@@ -637,10 +1332,8 @@ int check_hash_file(file_t* file, int chdir)
 			file_cleanup(&file_to_check);
 			file_info_destroy(&info);
 
-			if (rhash_data.interrupted) {
-				free(path_without_ext);
+			if (rhash_data.interrupted)
 				break;
-			}
 
 			/* update statistics */
 			if (res == 0)
@@ -649,8 +1342,8 @@ int check_hash_file(file_t* file, int chdir)
 				rhash_data.miss++;
 			rhash_data.processed++;
 		}
-		free(path_without_ext);
 	}
+	rsh_arena_destroy(&arena);
 	time = rsh_timer_stop(&timer);
 
 	rsh_fprintf(rhash_data.out, "%s\n", str_set(buf, '-', 80));
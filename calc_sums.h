@@ -29,6 +29,7 @@ struct file_info {
 	struct rhash_context* rctx; /* state of hash algorithms */
 	int error;  /* -1 for i/o error, -2 for wrong sum, 0 on success */
 	char* allocated_ptr;
+	rsh_arena* arena; /* the arena for strings of the file, NULL to use malloc */
 
 	unsigned sums_flags; /* mask of ids of calculated hash functions */
 	struct hash_check hc; /* hash values parsed from a hash file */
@@ -40,6 +41,9 @@ const char* file_info_get_utf8_print_path(struct file_info*);
 int save_torrent_to(file_t* torrent_file, struct rhash_context* rctx);
 int calculate_and_print_sums(FILE* out, struct file_t* file, const char *print_path);
 int check_hash_file(struct file_t* file, int chdir);
+void start_hash_threads(unsigned threads_count);
+void flush_hash_queue(void);
+void stop_hash_threads(void);
 int rename_file_by_embeding_crc32(struct file_info *info);
 
 /* Benchmarking */
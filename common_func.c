@@ -604,6 +604,99 @@ void rsh_blocks_vector_destroy(blocks_vector_t* bvector)
 	rsh_vector_destroy(&bvector->blocks);
 }
 
+/*=========================================================================
+ * Arena allocator
+ *=========================================================================*/
+
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_ALIGN 8
+
+/**
+ * Initialize an empty arena.
+ *
+ * @param arena pointer to the arena
+ */
+void rsh_arena_init(rsh_arena* arena)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->blocks.destructor = free;
+}
+
+/**
+ * Release all chunks allocated from the arena, keeping its current
+ * block to serve next allocations without calling malloc().
+ *
+ * @param arena pointer to the arena
+ */
+void rsh_arena_reset(rsh_arena* arena)
+{
+	size_t i;
+	for (i = 0; i < arena->blocks.size; i++) {
+		if (arena->blocks.array[i] != arena->current)
+			free(arena->blocks.array[i]);
+	}
+	arena->blocks.size = 0;
+	if (arena->current) {
+		rsh_vector_add_ptr(&arena->blocks, arena->current);
+		arena->pos = arena->current;
+		arena->left = ARENA_BLOCK_SIZE;
+	}
+}
+
+/**
+ * Free all memory allocated from the arena.
+ *
+ * @param arena pointer to the arena
+ */
+void rsh_arena_destroy(rsh_arena* arena)
+{
+	rsh_vector_destroy(&arena->blocks);
+	arena->current = arena->pos = NULL;
+	arena->left = 0;
+}
+
+/**
+ * Allocate a memory chunk from the arena. The chunk is aligned
+ * to 8 bytes and is freed only by destroying the arena.
+ *
+ * @param arena pointer to the arena
+ * @param size the size of the chunk
+ * @return pointer to the allocated chunk
+ */
+void* rsh_arena_alloc(rsh_arena* arena, size_t size)
+{
+	char* res;
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (size > arena->left) {
+		if (size > ARENA_BLOCK_SIZE / 4) {
+			/* a big chunk gets its own block, keeping the current one */
+			res = (char*)rsh_malloc(size);
+			rsh_vector_add_ptr(&arena->blocks, res);
+			return res;
+		}
+		arena->current = arena->pos = (char*)rsh_malloc(ARENA_BLOCK_SIZE);
+		arena->left = ARENA_BLOCK_SIZE;
+		rsh_vector_add_ptr(&arena->blocks, arena->current);
+	}
+	res = arena->pos;
+	arena->pos += size;
+	arena->left -= size;
+	return res;
+}
+
+/**
+ * Duplicate a string into the arena memory.
+ *
+ * @param arena pointer to the arena
+ * @param str the string to duplicate
+ * @return the allocated copy of the string
+ */
+char* rsh_arena_strdup(rsh_arena* arena, const char* str)
+{
+	size_t size = strlen(str) + 1;
+	return (char*)memcpy(rsh_arena_alloc(arena, size), str, size);
+}
+
 /*=========================================================================
  * String buffer functions
  *=========================================================================*/
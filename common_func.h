@@ -195,6 +195,21 @@ void rsh_blocks_vector_destroy(blocks_vector_t* vect);
 	rsh_vector_add_ptr(&((bvector)->blocks), rsh_malloc((item_size) * (blocksize))); \
 }
 
+/* arena allocator, releasing all allocated memory at once */
+typedef struct rsh_arena
+{
+	vector_t blocks; /* the allocated memory blocks */
+	char* current;   /* the current block */
+	char* pos;       /* the free memory of the current block */
+	size_t left;     /* the number of free bytes in the current block */
+} rsh_arena;
+
+void rsh_arena_init(rsh_arena* arena);
+void rsh_arena_reset(rsh_arena* arena);
+void rsh_arena_destroy(rsh_arena* arena);
+void* rsh_arena_alloc(rsh_arena* arena, size_t size);
+char* rsh_arena_strdup(rsh_arena* arena, const char* str);
+
 /* string buffer functions */
 typedef struct strbuf_t
 {
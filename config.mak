@@ -0,0 +1,34 @@
+# -------- Generated by configure -----------
+
+DESTDIR ?=
+BINDIR       = $(DESTDIR)/usr/local/bin
+SYSCONFDIR   = $(DESTDIR)/usr/local/etc
+MANDIR       = $(DESTDIR)/usr/local/share/man
+PKGCONFIGDIR = $(DESTDIR)/usr/local/lib/pkgconfig
+LOCALEDIR    = $(DESTDIR)/usr/local/share/locale
+
+AR      = ar
+CC      = cc
+INSTALL = install
+
+LIBRHASH_STATIC = librhash/librhash.a
+LIBRHASH_SHARED = librhash/librhash.so.0
+BUILD_TYPE      = shared
+VERSION         = 1.3.8
+EXEC_EXT        = 
+RHASH_STATIC    = rhash_static$(EXEC_EXT)
+RHASH_SHARED    = rhash$(EXEC_EXT)
+BUILD_TARGETS   = $(RHASH_SHARED)
+EXTRA_INSTALL   = install-lib-shared
+SYMLINKS        = sfv-hash has160-hash gost12-256-hash gost12-512-hash edonr256-hash edonr512-hash tiger-hash tth-hash whirlpool-hash ed2k-link magnet-link
+LN_S            = ln -sf
+
+OPTFLAGS    = -O2 -pipe -DNDEBUG -fomit-frame-pointer -ffunction-sections -fdata-sections
+OPTLDFLAGS  = 
+WARN_CFLAGS = -Wall -W -Wstrict-prototypes -Wnested-externs -Winline -Wpointer-arith -Wbad-function-cast -Wmissing-prototypes -Wmissing-declarations -Wdeclaration-after-statement
+ADDCFLAGS   = 
+ADDLDFLAGS  = 
+CFLAGS  = -DUSE_GETTEXT -DUSE_PTHREADS $(OPTFLAGS) $(WARN_CFLAGS) $(ADDCFLAGS)
+LDFLAGS = $(OPTLDFLAGS) $(ADDLDFLAGS) -pthread
+BIN_STATIC_LDFLAGS = $(LDFLAGS) -static
+
@@ -23,6 +23,9 @@
 #endif
 # include <fcntl.h>  /* _O_RDONLY, _O_BINARY */
 # include <io.h>
+#else
+# include <fcntl.h>  /* open() */
+# include <unistd.h> /* unlink() */
 #endif
 
 #ifdef __cplusplus
@@ -398,6 +401,41 @@ FILE* file_fopen(file_t* file, int fopen_flags)
 #endif
 }
 
+/**
+ * Open the file and return its low-level (unbuffered) descriptor.
+ *
+ * @param file the file information, including the path
+ * @param fopen_flags bitmask consisting of FileFOpenModes bits
+ * @return file descriptor on success, -1 on error
+ */
+int file_open(file_t* file, int fopen_flags)
+{
+	const int possible_flags[4] = { 0, O_RDONLY, O_WRONLY | O_CREAT | O_TRUNC, O_RDWR };
+	int flags = possible_flags[fopen_flags & FOpenRW];
+	assert((fopen_flags & FOpenRW) != 0);
+#ifdef _WIN32
+	if (fopen_flags & FOpenBin)
+		flags |= _O_BINARY;
+	if (!file->wpath)
+	{
+		int i;
+		int fd = -1;
+		for (i = 0; i < 2; i++) {
+			file->wpath = c2w_long_path(file->path, i);
+			if (file->wpath == NULL) continue;
+			fd = _wsopen(file->wpath, flags, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+			if (fd >= 0 || errno != ENOENT) break;
+			free(file->wpath);
+			file->wpath = 0;
+		}
+		return fd;
+	}
+	return _wsopen(file->wpath, flags, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+#else
+	return open(file->path, flags, 0666);
+#endif
+}
+
 /**
  * Open file at the specified path and return its decriptor.
  *
@@ -436,6 +474,21 @@ int file_rename(file_t* from, file_t* to)
 	return rename(from->path, to->path);
 }
 
+/**
+ * Remove the file.
+ *
+ * @param file the file to remove
+ * @return 0 on success, -1 on error and errno is set
+ */
+int file_remove(file_t* file)
+{
+#ifdef _WIN32
+	if (file->wpath)
+		return _wunlink(file->wpath);
+#endif
+	return unlink(file->path);
+}
+
 /**
  * Rename a given file to *.bak, if it exists.
  *
@@ -96,9 +96,11 @@ enum FileFOpenModes {
 	FOpenMask  = 7
 };
 FILE* file_fopen(file_t* file, int fopen_flags);
+int file_open(file_t* file, int fopen_flags);
 FILE* rsh_tfopen(ctpath_t tpath, file_tchar* tmode);
 
 int file_rename(file_t* from, file_t* to);
+int file_remove(file_t* file);
 int file_move_to_bak(file_t* file);
 
 #ifdef _WIN32
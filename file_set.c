@@ -1,123 +1,168 @@
 /* file_set.c - functions to manipulate a set of files */
 #include <assert.h>
-#include <ctype.h>  /* isspace */
-#include <stddef.h> /* ptrdiff_t */
+#include <ctype.h>  /* tolower */
 #include <stdlib.h> /* qsort */
 #include <string.h>
 #include <sys/stat.h>
 
 #include "file_set.h"
 #include "common_func.h"
-#include "hash_print.h"
-#include "output.h"
 #include "parse_cmdline.h"
-#include "rhash_main.h"
-#include "librhash/rhash.h"
+
+#define FILE_SET_MIN_TABLE_SIZE 64
+
+/* constants of the 64-bit FNV-1a hash function */
+#define FNV_OFFSET_BASIS ((((uint64_t)0xcbf29ce4) << 32) | 0x84222325)
+#define FNV_PRIME ((((uint64_t)0x100) << 32) | 0x1b3)
 
 /**
- * Generate a hash for a string.
+ * Generate a hash for a string, using the 64-bit FNV-1a function.
+ * The string is lower-cased with OPT_IGNORE_CASE.
  *
  * @param string the string to hash
  * @return a string hash
  */
 static uint64_t file_set_make_hash(const char* string)
 {
-	unsigned hash;
-    int res = -1;
-
-	if (opt.flags & OPT_DETECT_CHANGES) {
-	    file_t tmp_file;
-	    file_init(&tmp_file, string, FILE_OPT_DONT_FREE_PATH);
-        if(file_stat(&tmp_file, 0) == 0)
-            res = tmp_file.stats->st_ino;
-        else
-            res = 0;
-
-        file_cleanup(&tmp_file);
-
-		return res;
-	}
+	uint64_t hash = FNV_OFFSET_BASIS;
+	const unsigned char* p = (const unsigned char*)string;
 
 	if (opt.flags & OPT_IGNORE_CASE) {
-		char* tmp_string = str_tolower(string);
-		res = rhash_msg(RHASH_CRC32, tmp_string, strlen(tmp_string), (unsigned char *) &hash);
-		free(tmp_string);
-	}
-	else {
-		res = rhash_msg(RHASH_CRC32, string, strlen(string), (unsigned char *) &hash);
-	}
-
-	if(res < 0) {
-		return 0;
+		for (; *p; p++) hash = (hash ^ (unsigned char)tolower(*p)) * FNV_PRIME;
+	} else {
+		for (; *p; p++) hash = (hash ^ *p) * FNV_PRIME;
 	}
 	return hash;
 }
 
 /**
- * Set file path of the given item.
+ * Compare two file paths, ignoring case with OPT_IGNORE_CASE.
  *
- * @param item pointer to the item to change
- * @param filepath the file path to set
+ * @param path1 the first path to compare
+ * @param path2 the second path to compare
+ * @return 0 if the paths are equal, non-zero otherwise
  */
-static int file_set_item_set_filepath(file_set_item* item, const char* filepath)
+static int file_set_compare_paths(const char* path1, const char* path2)
 {
-	free(item->filepath);
-	item->filepath = rsh_strdup(filepath);
-	if (!item->filepath) return 0;
+	if (opt.flags & OPT_IGNORE_CASE)
+		return strcmpci(path1, path2);
+	return strcmp(path1, path2);
+}
 
-	item->name_hash_or_inode = file_set_make_hash(item->filepath);
-	return 1;
+/**
+ * Allocate an empty file_set.
+ *
+ * @param arena the arena to allocate items from
+ * @return allocated file_set
+ */
+file_set* file_set_new(rsh_arena* arena)
+{
+	file_set* set = (file_set*)rsh_malloc(sizeof(file_set));
+	memset(set, 0, sizeof(file_set));
+	set->arena = arena;
+	return set;
 }
 
 /**
- * Allocate a file_set_item structure and initialize it with a filepath.
+ * Free memory allocated by file_set. The items are released with the arena.
  *
- * @param filepath a filepath to initialize the file_set_item
- * @return allocated file_set_item structure
+ * @param set the set to free
  */
-file_set_item* file_set_item_new(const char* filepath)
+void file_set_free(file_set* set)
 {
-	file_set_item *item = (file_set_item*)rsh_malloc(sizeof(file_set_item));
-	memset(item, 0, sizeof(file_set_item));
+	if (!set) return;
+	free(set->array);
+	free(set->table);
+	free(set);
+}
 
-	if (filepath) {
-		if (!file_set_item_set_filepath(item, filepath)) {
-			free(item);
-			return NULL;
-		}
+/**
+ * Find the table slot of a file path, which is either the slot
+ * of the item with this path or the empty slot to insert the item to.
+ *
+ * @param set the file_set to search
+ * @param filepath the file path to search for
+ * @param hash the hash of the file path
+ * @return pointer to the table slot
+ */
+static file_set_item** file_set_find_slot(file_set* set, const char* filepath, uint64_t hash)
+{
+	size_t mask = set->table_size - 1;
+	size_t index = (size_t)hash & mask;
+	for (; set->table[index]; index = (index + 1) & mask) {
+		file_set_item* item = set->table[index];
+		if (item->name_hash == hash && file_set_compare_paths(filepath, item->filepath) == 0)
+			break;
 	}
-	return item;
+	return &set->table[index];
 }
 
 /**
- * Free memory allocated by file_set_item.
+ * Double the size of the hash table and re-insert all items into it.
  *
- * @param item the item to delete
+ * @param set the file_set to resize the table of
  */
-void file_set_item_free(file_set_item *item)
+static void file_set_grow_table(file_set* set)
 {
-	free(item->filepath);
-	free(item);
+	size_t i;
+	size_t new_size = (set->table_size ? set->table_size * 2 : FILE_SET_MIN_TABLE_SIZE);
+	free(set->table);
+	set->table = (file_set_item**)rsh_calloc(new_size, sizeof(file_set_item*));
+	set->table_size = new_size;
+	for (i = 0; i < set->size; i++) {
+		size_t index = (size_t)set->array[i]->name_hash & (new_size - 1);
+		while (set->table[index]) index = (index + 1) & (new_size - 1);
+		set->table[index] = set->array[i];
+	}
 }
 
 /**
- * Call-back function to compare two file items by search_filepath, using hashes
+ * Add a file path to the file_set. If the set already contains
+ * the path, then the item of the path is returned.
  *
- * @param pp_rec1 the first item to compare
- * @param pp_rec2 the second item to compare
- * @return 0 if items are equal, -1 if pp_rec1 &lt; pp_rec2, 1 otherwise
+ * @param set the file_set to add the item to
+ * @param filepath the item file path
+ * @return the item of the file path
  */
-static int crc_pp_rec_compare(const void *pp_rec1, const void *pp_rec2)
+file_set_item* file_set_add_name(file_set *set, const char* filepath)
 {
-	const file_set_item *rec1 = *(file_set_item *const *)pp_rec1;
-	const file_set_item *rec2 = *(file_set_item *const *)pp_rec2;
-	if (rec1->name_hash_or_inode != rec2->name_hash_or_inode)
-		return (rec1->name_hash_or_inode < rec2->name_hash_or_inode ? -1 : 1);
+	uint64_t hash = file_set_make_hash(filepath);
+	file_set_item** slot;
+	file_set_item* item;
+
+	/* keep the table at most half full */
+	if ((set->size + 1) * 2 > set->table_size)
+		file_set_grow_table(set);
+	slot = file_set_find_slot(set, filepath, hash);
+	if (*slot)
+		return *slot;
+
+	item = (file_set_item*)rsh_arena_alloc(set->arena, sizeof(file_set_item));
+	memset(item, 0, sizeof(file_set_item));
+	item->name_hash = hash;
+	item->filepath = rsh_arena_strdup(set->arena, filepath);
+	*slot = item;
 
-	if (opt.flags & OPT_IGNORE_CASE)
-		return strcmpci(rec1->filepath, rec2->filepath);
-	else
-		return strcmp(rec1->filepath, rec2->filepath);
+	if (set->size >= set->allocated) {
+		set->allocated = (set->allocated ? set->allocated * 2 : 16);
+		set->array = (file_set_item**)rsh_realloc(set->array, set->allocated * sizeof(file_set_item*));
+	}
+	set->array[set->size++] = item;
+	return item;
+}
+
+/**
+ * Store a copy of the file attributes in the given item.
+ *
+ * @param set the file_set containing the item
+ * @param item the item to change
+ * @param stats the file attributes to copy
+ */
+void file_set_item_set_stats(file_set* set, file_set_item* item, const struct stat* stats)
+{
+	if (!item->stats)
+		item->stats = (struct stat*)rsh_arena_alloc(set->arena, sizeof(struct stat));
+	memcpy(item->stats, stats, sizeof(struct stat));
 }
 
 /**
@@ -133,40 +178,33 @@ static int path_compare(const void *rec1, const void *rec2)
 		(*(file_set_item *const *)rec2)->filepath);
 }
 
-/**
- * Sort given file_set using hashes of search_filepath for fast binary search.
- *
- * @param set the file_set to sort
- */
-void file_set_sort(file_set *set)
-{
-	if (set->array) qsort(set->array, set->size, sizeof(file_set_item*), crc_pp_rec_compare);
-}
-
 /**
  * Sort files in the specified file_set by file path.
+ * The order of items doesn't affect searching in the set.
  *
  * @param set the file-set to sort
  */
 void file_set_sort_by_path(file_set *set)
 {
-	qsort(set->array, set->size, sizeof(file_set_item*), path_compare);
+	if (set->array) qsort(set->array, set->size, sizeof(file_set_item*), path_compare);
 }
 
 /**
- * Create and add a file_set_item with given filepath to given file_set
+ * Find a file path in the file_set.
  *
- * @param set the file_set to add the item to
- * @param filepath the item file path
+ * @param set the file_set to search
+ * @param filepath the file path to search for
+ * @return the found item, NULL if filepath is not found
  */
-void file_set_add_name(file_set *set, const char* filepath)
+file_set_item* file_set_find(file_set *set, const char* filepath)
 {
-	file_set_item* item = file_set_item_new(filepath);
-	if (item) file_set_add(set, item);
+	if (!set->size) return NULL; /* not found */
+	assert(set->table != NULL);
+	return *file_set_find_slot(set, filepath, file_set_make_hash(filepath));
 }
 
 /**
- * Find a file path in the file_set.
+ * Check if a file path is present in the file_set.
  *
  * @param set the file_set to search
  * @param filepath the file path to search for
@@ -174,38 +212,5 @@ void file_set_add_name(file_set *set, const char* filepath)
  */
 int file_set_exist(file_set *set, const char* filepath)
 {
-	int a, b, c;
-	int cmp, res = 0;
-	uint64_t hash;
-
-	if (!set->size) return 0; /* not found */
-	assert(set->array != NULL);
-
-	/* generate hash to speedup the search */
-	hash = file_set_make_hash(filepath);
-
-	/* fast binary search */
-	for (a = -1, b = (int)set->size; (a + 1) < b;) {
-		file_set_item *item;
-
-		c = (a + b) / 2;
-		assert(0 <= c && c < (int)set->size);
-
-		item = (file_set_item*)set->array[c];
-		if (hash != item->name_hash_or_inode) {
-			cmp = (hash < item->name_hash_or_inode ? -1 : 1);
-		} else {
-			if (opt.flags & OPT_IGNORE_CASE)
-				cmp = strcmpci(filepath, item->filepath);
-			else
-				cmp = strcmp(filepath, item->filepath);
-			if (cmp == 0) {
-				res = 1; /* file path has been found */
-				break;
-			}
-		}
-		if (cmp < 0) b = c;
-		else a = c;
-	}
-	return res;
+	return (file_set_find(set, filepath) != NULL);
 }
@@ -13,25 +13,36 @@ extern "C" {
  */
 typedef struct file_set_item
 {
-	uint64_t name_hash_or_inode;
+	uint64_t name_hash;
 	char* filepath;
+	struct stat* stats; /* file attributes, found by a directory scan, can be NULL */
+	int accepted; /* non-zero if the directory scan has accepted the file for hashing */
 } file_set_item;
 
-/* array to store filenames from a parsed hash file */
-struct vector_t;
-typedef struct vector_t file_set;
-
-#define file_set_new() rsh_vector_new((void(*)(void*))file_set_item_free) /* allocate new file set */
-#define file_set_free(set) rsh_vector_free(set) /* free memory */
-#define file_set_get(set, index) ((file_set_item*)((set)->array[index])) /* get i-th element */
-#define file_set_add(set, item) rsh_vector_add_ptr(set, item) /* add a file_set_item to file_set */
-
-void file_set_item_free(file_set_item *item);
-void file_set_add_name(file_set *set, const char* filename);
-void file_set_sort(file_set *set);
+/**
+ * A set of file paths, kept in the order of addition and indexed
+ * by an open addressing hash table. The items and their paths are
+ * allocated from an arena, which must outlive the set.
+ */
+typedef struct file_set
+{
+	file_set_item** array; /* the items in the order of addition */
+	size_t size;           /* the number of items */
+	size_t allocated;      /* the number of allocated array elements */
+	file_set_item** table; /* the hash table with linear probing */
+	size_t table_size;     /* the number of table slots, a power of two */
+	rsh_arena* arena;      /* the memory of the items and their paths */
+} file_set;
+
+#define file_set_get(set, index) ((set)->array[index]) /* get i-th element */
+
+file_set* file_set_new(rsh_arena* arena);
+void file_set_free(file_set* set);
+file_set_item* file_set_add_name(file_set *set, const char* filename);
 void file_set_sort_by_path(file_set *set);
-file_set_item* file_set_item_new(const char* filepath);
+file_set_item* file_set_find(file_set *set, const char* filename);
 int file_set_exist(file_set *set, const char* filename);
+void file_set_item_set_stats(file_set* set, file_set_item* item, const struct stat* stats);
 
 #ifdef __cplusplus
 } /* extern "C" */
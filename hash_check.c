@@ -136,7 +136,7 @@ static unsigned hash_check_mask_by_digest_size(int digest_size)
 	int code;
 	if (mask[9] == 0) {
 		unsigned hid;
-		for (hid = 1; hid <= RHASH_ALL_HASHES; hid <<= 1) {
+		for (hid = 1; hid & RHASH_ALL_HASHES; hid <<= 1) {
 			code = code_digest_size(rhash_get_digest_size(hid));
 			assert(0 <= code && code <= 7);
 			if (code >= 0) mask[code] |= hid;
@@ -313,7 +313,7 @@ static int hash_check_find_str(hc_search *search, const char* format)
 			 /* find hash_id by a hash function name */
 			for (i = 0; i < RHASH_HASH_COUNT; i++) {
 				if (strcmp(buf, hash_info_table[i].name) == 0) {
-					search->expected_hash_id = 1 << i;
+					search->expected_hash_id = 1u << i;
 					search->hash_type = (HV_HEX | HV_B32);
 					break;
 				}
@@ -383,14 +383,16 @@ static int hash_check_find_str(hc_search *search, const char* format)
 				if (*begin != 'i')
 					return 0;
 				startptr = begin;
-				hc->inode = 0L;
+				hc->inode = 0;
 				hc->mtime = 0L;
 
-				errno = 0;
-				hc->inode = strtoul(begin + 1, &endptr, 10);
-				if (errno != 0 || *endptr != 't')
+				/* parse all 64 bits of the inode, unsigned long can be 32-bit */
+				for (endptr = begin + 1; *endptr >= '0' && *endptr <= '9'; endptr++)
+					hc->inode = hc->inode * 10 + (*endptr - '0');
+				if (*endptr != 't')
 					return 0;
 
+				errno = 0;
 				hc->mtime = strtol(endptr + 1, &endptr, 10);
 				if (errno != 0 || endptr > end || (*endptr != ' ' && endptr < end))
 					return 0;
@@ -498,7 +500,7 @@ int hash_check_parse_line(char* line, hash_check* hashes, int check_eol)
 
 					/* find hash by its magnet link specific URN name  */
 					for (i = 0; i < RHASH_HASH_COUNT; i++) {
-						const char* urn = rhash_get_magnet_name(1 << i);
+						const char* urn = rhash_get_magnet_name(1u << i);
 						size_t len = hf_end - hs.begin;
 						if (strncmp(hs.begin, urn, len) == 0 &&
 							urn[len] == '\0') break;
@@ -512,7 +514,7 @@ int hash_check_parse_line(char* line, hash_check* hashes, int check_eol)
 					}
 
 					hs.begin = hf_end + 1;
-					hs.expected_hash_id = 1 << i;
+					hs.expected_hash_id = 1u << i;
 					hs.hash_type = (HV_HEX | HV_B32);
 					if (!hash_check_find_str(&hs, "\3")) bad = 1;
 					if (hs.begin != param_end) bad = 1;
@@ -689,9 +691,9 @@ int hash_check_verify(hash_check* hashes, struct rhash_context* ctx)
 	if (hashes->hashes_num == 0)
 		return !HC_FAILED(hashes->flags);
 
-	unverified_mask = (1 << hashes->hashes_num) - 1;
+	unverified_mask = ~0u >> (HC_MAX_HASHES - hashes->hashes_num);
 
-	for (hid = 1; hid <= RHASH_ALL_HASHES; hid <<= 1) {
+	for (hid = 1; hid & RHASH_ALL_HASHES; hid <<= 1) {
 		if ((hashes->hash_mask & hid) == 0) continue;
 		printed = 0;
 
@@ -701,7 +703,7 @@ int hash_check_verify(hash_check* hashes, struct rhash_context* ctx)
 			int dgst_size;
 
 			/* skip already verified hashes and hashes with different digest size */
-			if (!(unverified_mask & (1 << j)) || !(hv->hash_id & hid)) continue;
+			if (!(unverified_mask & (1u << j)) || !(hv->hash_id & hid)) continue;
 			dgst_size = rhash_get_digest_size(hid);
 			if (hv->length == (dgst_size * 2)) {
 				assert(hv->format & HV_HEX);
@@ -733,7 +735,7 @@ int hash_check_verify(hash_check* hashes, struct rhash_context* ctx)
 				if (memcmp(hash_orig, hash_str, hv->length) != 0) continue;
 			}
 
-			unverified_mask &= ~(1 << j); /* the j-th hash verified */
+			unverified_mask &= ~(1u << j); /* the j-th hash verified */
 			hashes->found_hash_ids |= hid;
 
 			/* end loop if all hashes were successfully verified */
@@ -24,7 +24,7 @@
 /**
  * The table with information about hash functions.
  */
-print_hash_info hash_info_table[32];
+print_hash_info hash_info_table[RHASH_HASH_COUNT];
 
 /**
  * Possible types of a print_item.
@@ -215,7 +215,7 @@ static unsigned printf_name_to_id(const char* name, size_t length, unsigned *fla
         return 0;
     }
 
-	for (bit = 1; bit <= RHASH_ALL_HASHES; bit = bit << 1, info++) {
+	for (bit = 1; bit & RHASH_ALL_HASHES; bit = bit << 1, info++) {
 		if (memcmp(buf, info->short_name, length) == 0 &&
 			info->short_name[length] == 0) return bit;
 	}
@@ -531,24 +531,20 @@ void init_hash_info_table(void)
 {
 	unsigned bit;
 	unsigned short_opt_mask = RHASH_CRC32 | RHASH_MD5 | RHASH_SHA1 | RHASH_TTH | RHASH_ED2K |
-		RHASH_AICH | RHASH_WHIRLPOOL | RHASH_RIPEMD160 | RHASH_GOST12_256 | OPT_ED2K_LINK;
-	char* short_opt = "cmhteawrgl";
+		RHASH_AICH | RHASH_WHIRLPOOL | RHASH_RIPEMD160 | RHASH_GOST12_256;
+	char* short_opt = "cmhteawrg";
 	print_hash_info *info = hash_info_table;
-	unsigned fullmask = RHASH_ALL_HASHES | OPT_ED2K_LINK;
 
 	memset(hash_info_table, 0, sizeof(hash_info_table));
 
-	for (bit = 1; bit && bit <= fullmask; bit = bit << 1) {
+	for (bit = 1; bit & RHASH_ALL_HASHES; bit = bit << 1) {
 		const char *p;
 		char *e, *d;
 
-		if (!(bit & fullmask))
-			continue;
-
 		info->short_char = ((bit & short_opt_mask) != 0 && *short_opt ?
 			*(short_opt++) : 0);
 
-		info->name = (bit & RHASH_ALL_HASHES ? rhash_get_name(bit) : "ED2K-LINK");
+		info->name = rhash_get_name(bit);
 		assert(strlen(info->name) < 19);
 		p = info->name;
 		d = info->short_name;
@@ -590,7 +586,8 @@ void init_printf_format(strbuf_t* out)
 
 	if (!opt.fmt) {
 		/* print SFV header for CRC32 or if no hash sums options specified */
-		opt.fmt = (opt.sum_flags == RHASH_CRC32 || !opt.sum_flags ? FMT_SFV : FMT_SIMPLE);
+		opt.fmt = ((opt.sum_flags == RHASH_CRC32 || !opt.sum_flags) && !(opt.flags & OPT_ED2K_LINK) ?
+			FMT_SFV : FMT_SIMPLE);
 	}
 	uppercase = ((opt.flags & OPT_UPPERCASE) ||
 		(!(opt.flags & OPT_LOWERCASE) && (opt.fmt & FMT_SFV)));
@@ -598,7 +595,7 @@ void init_printf_format(strbuf_t* out)
 
 	rsh_str_ensure_size(out, 1024); /* allocate big enough buffer */
 
-	if (opt.sum_flags & OPT_ED2K_LINK) {
+	if (opt.flags & OPT_ED2K_LINK) {
 		rsh_str_append_n(out, "%l", 2);
 		out->str[1] &= up_flag;
 		return;
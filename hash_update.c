@@ -1,5 +1,11 @@
 /* hash_update.c - functions to update a crc file */
 
+/* use 64-bit off_t, must be defined before any include file */
+#undef _LARGEFILE64_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,82 +27,173 @@
 #include "win_utils.h"
 #include "line_set.h"
 #include "find_file.h"
+#include "update_index.h"
 #include <sys/stat.h>
 
+#ifdef _WIN32
+# define rsh_ftell(fd) _ftelli64(fd)
+#else
+# define rsh_ftell(fd) ftello(fd)
+#endif
+
+/**
+ * A line of the loaded hash file.
+ */
+typedef struct crc_line
+{
+	char* line;           /* the line as it was read from the hash file */
+	file_set_item* entry; /* the entry of the line file, NULL if no file path has been parsed */
+	uint64_t offset;      /* offset of the line in the hash file */
+	uint64_t file_size;   /* the file size, parsed from the line */
+	uint64_t inode;       /* the file inode, parsed from the line */
+	time_t mtime;         /* the file modification time, parsed from the line */
+	short path_offset;    /* offset of the file path inside the line */
+	short path_len;       /* length of the file path */
+	int is_dropped;       /* non-zero if the line must be removed from the hash file */
+} crc_line;
+
 /* first define some internal functions, implemented later in this file */
-static int add_new_crc_entries(file_t* file, file_set *crc_entries, inode_line_set* removed_entries);
-static int file_set_load_from_crc_file(file_set *set, inode_line_set* removed_entries, file_t* file);
-static int fix_sfv_header(file_t* file);
+static int load_crc_file(file_t* file, file_set *crc_entries, vector_t* crc_lines, rsh_arena* arena);
+static void scan_new_files(char* dir_path, file_set *crc_entries, file_set* files_to_add, update_index* index);
+static size_t check_crc_lines(vector_t* crc_lines, file_set* crc_entries, file_set* files_to_add,
+	inode_line_set* removed_entries, uint64_t dev);
+static int write_crc_file(file_t* file, char* dir_path, vector_t* crc_lines, int rewrite,
+	file_set* crc_entries, file_set* files_to_add, inode_line_set* removed_entries, update_index* index);
 
 typedef struct update_call_back_ctx
 {
 	file_set *crc_entries;
 	file_set* files_to_add;
-	inode_line_set *removed_entries;
+	update_index* index; /* the index of the hash file, used instead of loaded crc_entries */
+	int keep_stats; /* non-zero to store attributes of the files listed in crc_entries */
 } update_call_back_ctx;
 
 /**
  * Update given crc file, by adding to it hashes of files from the same
  * directory, but which the crc file doesn't contain yet.
  *
+ * <p/>The hash file is loaded into memory, then the directory is scanned
+ * and the attributes of the scanned files are used to check the loaded lines,
+ * so every file is stat'ed at most once. The hash sums of new files are
+ * appended to the hash file, which is rewritten only if some lines
+ * are removed from it or if an SFV header must be extended.
+ *
  * @param file the file containing hash sums
  * @return 0 on success, -1 on fail
  */
 int update_hash_file(file_t* file)
 {
 	file_set* crc_entries;
+	file_set* files_to_add;
+	vector_t* crc_lines;
 	inode_line_set* removed_entries;
+	rsh_arena arena;
+	update_index index;
 	timedelta_t timer;
-	int res;
+	int res = 0;
+	/* the index can't be kept for SFV files, which header is rewritten on adding files */
+	int keep_index = ((opt.flags & OPT_UPDATE_INDEX) && opt.fmt != FMT_SFV);
+	int use_index = 0;
 
 	if (opt.flags & OPT_VERBOSE) {
 		log_msg(_("Updating: %s\n"), file->path);
 	}
 
-	crc_entries = file_set_new();
-	removed_entries = line_set_new();
-	res = file_set_load_from_crc_file(crc_entries, removed_entries, file);
+	/* the loaded lines, the file sets and their strings are released at once */
+	rsh_arena_init(&arena);
+	crc_entries = file_set_new(&arena);
+	files_to_add = file_set_new(&arena);
+	crc_lines = rsh_vector_new(NULL);
+	removed_entries = line_set_new(&arena);
+	update_index_init(&index);
+	/* an index of an unchanged hash file replaces parsing it, unless its lines must be checked */
+	if (keep_index && !(opt.flags & (OPT_REMOVE_MISSING | OPT_DETECT_CHANGES | OPT_IGNORE_CASE)))
+		use_index = (update_index_load(&index, file) == 0);
+	if (!use_index)
+		res = load_crc_file(file, crc_entries, crc_lines, &arena);
 
 	if (opt.flags & OPT_SPEED) rsh_timer_start(&timer);
 	rhash_data.total_size = 0;
 	rhash_data.processed  = 0;
 
-	if (res == 0) {
+	if (res >= 0) {
+		char* dir_path = get_dirname(file->path);
+		int rewrite = 0;
+		file_set_item* crc_file_entry;
+
 		/* add the crc file itself to the set of excluded from re-calculation files */
-		file_set_add_name(crc_entries, get_basename(file->path));
-		file_set_sort(crc_entries);
-		line_set_sort(removed_entries);
+		crc_file_entry = file_set_add_name(crc_entries, get_basename(file->path));
+		if (keep_index) {
+			/* the index file is also excluded */
+			char* index_name = str_append(get_basename(file->path), UPDATE_INDEX_SUFFIX);
+			file_set_add_name(crc_entries, index_name);
+			free(index_name);
+		}
+
+		/* find files absent from the crc file, collecting attributes of the listed ones */
+		scan_new_files(dir_path, crc_entries, files_to_add, (use_index ? &index : NULL));
+
+		if (res > 0) {
+			uint64_t dev = 0;
+			if (opt.flags & OPT_DETECT_CHANGES) {
+				/* fingerprints keep only inodes, so moved files are looked for on the hash file device */
+				struct stat stats;
+				if (crc_file_entry->stats)
+					dev = crc_file_entry->stats->st_dev;
+				else if (stat(file->path, &stats) == 0)
+					dev = stats.st_dev;
+			}
+			/* rewrite the loaded crc file only if it loses lines or gets SFV header lines */
+			rewrite = (check_crc_lines(crc_lines, crc_entries, files_to_add, removed_entries, dev) > 0 ||
+				(opt.fmt == FMT_SFV && files_to_add->size > 0));
+		}
 
 		/* update crc file with sums of files not present in the crc_entries */
-		res = add_new_crc_entries(file, crc_entries, removed_entries);
+		res = write_crc_file(file, dir_path, crc_lines, rewrite, crc_entries, files_to_add,
+			removed_entries, (keep_index ? &index : NULL));
+		free(dir_path);
 	}
+	if (res == 0 && keep_index && !rhash_data.interrupted && (!use_index || index.items_count > 0)) {
+		if (update_index_save(&index, file) < 0) {
+			file_t index_file;
+			file_path_append(&index_file, file, UPDATE_INDEX_SUFFIX);
+			log_file_t_error(&index_file);
+			file_cleanup(&index_file);
+		}
+	}
+	update_index_cleanup(&index);
 	file_set_free(crc_entries);
+	file_set_free(files_to_add);
+	rsh_vector_free(crc_lines);
 	line_set_free(removed_entries);
+	rsh_arena_destroy(&arena);
 
 	if (opt.flags & OPT_SPEED && rhash_data.processed > 0) {
 		double time = rsh_timer_stop(&timer);
 		print_time_stats(time, rhash_data.total_size, 1);
 	}
 
-	return res;
+	return (res < 0 ? -1 : 0);
 }
 
 /**
- * Load a set of files from given crc file.
+ * Load the lines of given crc file into memory, without accessing the listed files.
  *
- * @param set the file set to store loaded files
  * @param file the file containing hash sums to load
- * @return 0 on success, -1 on fail with error code in errno
+ * @param crc_entries the file set to store the paths of the listed files
+ * @param crc_lines the vector to store loaded crc_line items
+ * @param arena the arena to allocate the loaded lines from
+ * @return 1 if the file has been loaded, 0 if it doesn't exist,
+ *         -1 on fail with error code in errno
  */
-static int file_set_load_from_crc_file(file_set *set, inode_line_set* removed_entries, file_t* file)
+static int load_crc_file(file_t* file, file_set *crc_entries, vector_t* crc_lines, rsh_arena* arena)
 {
 	FILE *in;
-	FILE* out;
 	int line_num;
 	char buf[2048];
 	char orig_line[2048];
 	hash_check hc;
-	file_t new_file;
+	uint64_t offset = 0;
 	int err = 0;
 
 	if ( !(in = file_fopen(file, FOpenRead | FOpenBin) )) {
@@ -104,22 +201,12 @@ static int file_set_load_from_crc_file(file_set *set, inode_line_set* removed_en
 		return (errno == ENOENT ? 0 : -1);
 	}
 
-	/* open a temporary file for writing */
-	file_path_append(&new_file, file, ".new");
-	if ( !(out = file_fopen(&new_file, FOpenWrite) )) {
-		log_file_t_error(&new_file);
-		file_cleanup(&new_file);
-		fclose(in);
-		return -1;
-	}
-
-	if (opt.fmt == FMT_SFV)
-		print_sfv_banner(out);
-
 	for (line_num = 0; fgets(buf, 2048, in); line_num++) {
-		char append = 1;
+		crc_line line_info;
 		char* line = buf;
+		uint64_t line_offset = offset;
 		strcpy(orig_line, line);
+		offset += strlen(buf);
 
 		/* skip unicode BOM */
 		if (line_num == 0 && buf[0] == (char)0xEF && buf[1] == (char)0xBB && buf[2] == (char)0xBF) line += 3;
@@ -135,176 +222,93 @@ static int file_set_load_from_crc_file(file_set *set, inode_line_set* removed_en
 		if (IS_COMMENT(*line) || *line == '\r' || *line == '\n')
 			continue;
 
+		memset(&line_info, 0, sizeof(crc_line));
+
 		/* parse a hash file line */
-		if (hash_check_parse_line(line, &hc, !feof(in))) {
-			/* store file info to the file set */
-			if (hc.file_path) {
-				if ((opt.flags & OPT_REMOVE_MISSING) || (opt.flags & OPT_DETECT_CHANGES)) {
-					struct stat stats;
-					int res = stat(hc.file_path, &stats);
-					if (res != 0) { // file is missing
-						append = 0;
-						if ((opt.flags & OPT_DETECT_CHANGES) && hc.inode && hc.mtime) {
-							char *path_offset = strstr(orig_line, hc.file_path);
-							line_set_add_line(removed_entries, orig_line, path_offset - orig_line, strlen(hc.file_path),
-											  hc.inode, hc.mtime);
-						}
-					} else if ((opt.flags & OPT_DETECT_CHANGES) && (hc.inode != stats.st_ino || hc.mtime != stats.st_mtim.tv_sec)) {
-						append = 0;
-					}
-				}
-
-				if (append) {
-					file_set_add_name(set, hc.file_path);
-					if (opt.fmt == FMT_SFV) {
-						file_t tmp_file;
-						file_init(&tmp_file, hc.file_path, FILE_OPT_DONT_FREE_PATH);
-						if (file_stat(&tmp_file, 0) < 0) {
-							err = 1;
-							file_cleanup(&tmp_file);
-							break;
-						}
-						print_sfv_header_line(out, &tmp_file, 0);
-						file_cleanup(&tmp_file);
-					}
-				}
-			} else if (opt.flags & OPT_DETECT_CHANGES) {
-				append = 0;
-			}
-		} else if (opt.flags & OPT_DETECT_CHANGES) {
-			append = 0;
+		if (hash_check_parse_line(line, &hc, !feof(in)) && hc.file_path) {
+			char *path = strstr(orig_line, hc.file_path);
+			line_info.entry = file_set_add_name(crc_entries, hc.file_path);
+			line_info.file_size = hc.file_size;
+			line_info.inode = hc.inode;
+			line_info.mtime = hc.mtime;
+			line_info.path_offset = (short)(path ? path - orig_line : 0);
+			line_info.path_len = (short)strlen(hc.file_path);
 		}
-
-		if (append && fputs(orig_line, out) < 0)
-			break;
+		line_info.line = rsh_arena_strdup(arena, orig_line);
+		line_info.offset = line_offset;
+		rsh_vector_add_ptr(crc_lines,
+			memcpy(rsh_arena_alloc(arena, sizeof(crc_line)), &line_info, sizeof(crc_line)));
 	}
 
 	if (ferror(in)) {
 		log_file_t_error(file);
 		err = 1;
 	}
-	if (ferror(out)) {
-		log_file_t_error(&new_file);
-		err = 1;
-	}
 	fclose(in);
-	fclose(out);
-
-	/* overwrite the hash file with a new one */
-	if (!err && file_rename(&new_file, file) < 0) {
-		log_error(_("can't move %s to %s: %s\n"),
-				  new_file.path, file->path, strerror(errno));
-	}
-	file_cleanup(&new_file);
-	return (err ? -1 : 0);
+	return (err ? -1 : 1);
 }
 
 /**
- * Add hash sums of files from given file-set to a specified hash-file.
- * A specified directory path will be prepended to the path of added files,
- * if it is not a current directory.
+ * Mark the loaded lines of missing files with OPT_REMOVE_MISSING and
+ * the lines of changed files with OPT_DETECT_CHANGES as dropped.
+ * The attributes of the listed files are taken from the directory scan,
+ * only the files missed by the scan are stat'ed.
  *
- * @param file the hash file to add the hash sums to
- * @param dir_path the directory path to prepend
- * @param files_to_add the set of files to hash and add
- * @return 0 on success, -1 on error
+ * @param crc_lines the loaded lines of the hash file
+ * @param crc_entries the file set of the loaded lines
+ * @param files_to_add the set to add the changed files to, for re-calculation
+ * @param removed_entries the set to store lines of files, which were moved
+ * @param dev the device of the hash file, where the moved files are looked for
+ * @return the number of dropped lines
  */
-static int add_sums_to_file(file_t* file, char* dir_path, file_set *files_to_add, inode_line_set* removed_entries)
+static size_t check_crc_lines(vector_t* crc_lines, file_set* crc_entries, file_set* files_to_add,
+	inode_line_set* removed_entries, uint64_t dev)
 {
-	FILE* fd;
-	unsigned i;
-	int ch;
-	char new_line[2048];
-
-	/* SFV banner will be printed only in SFV mode and only for empty crc files */
-	int print_banner = (opt.fmt == FMT_SFV);
-
-	file->size = 0;
-	if (file_stat(file, 0) == 0) {
-		if (print_banner && file->size > 0) print_banner = 0;
-	}
-
-	/* open the hash file for writing */
-	if ( !(fd = file_fopen(file, FOpenRead | FOpenWrite) )) {
-		log_file_t_error(file);
-		return -1;
-	}
-	rhash_data.upd_fd = fd;
+	size_t dropped = 0;
+	size_t i;
 
-	if (file->size > 0) {
-		/* read the last character of the file to check if it is EOL */
-		if (fseek(fd, -1, SEEK_END) != 0) {
-			log_file_t_error(file);
-			return -1;
-		}
-		ch = fgetc(fd);
-
-		/* somehow writing doesn't work without seeking */
-		if (fseek(fd, 0, SEEK_END) != 0) {
-			log_file_t_error(file);
-			return -1;
-		}
-
-		/* write EOL if it wasn't present */
-		if (ch != '\n' && ch != '\r') {
-			/* fputc('\n', fd); */
-			rsh_fprintf(fd, "\n");
-		}
-	}
-
-	/* append hash sums to the updated crc file */
-	for (i = 0; i < files_to_add->size; i++, rhash_data.processed++) {
-		file_t tmp_file;
-		char *print_path = file_set_get(files_to_add, i)->filepath;
-		int removed_index = -1;
-		memset(&tmp_file, 0, sizeof(tmp_file));
+	if (!(opt.flags & (OPT_REMOVE_MISSING | OPT_DETECT_CHANGES)))
+		return 0;
 
-		if (dir_path[0] != '.' || dir_path[1] != 0) {
-			/* prepend the file path by directory path */
-			file_init(&tmp_file, make_path(dir_path, print_path), 0);
-		} else {
-			file_init(&tmp_file, print_path, FILE_OPT_DONT_FREE_PATH);
-		}
+	for (i = 0; i < crc_lines->size; i++) {
+		crc_line* line_info = (crc_line*)crc_lines->array[i];
+		file_set_item* entry = line_info->entry;
+		struct stat stats;
 
-		if (opt.fmt == FMT_SFV) {
-			if (print_banner) {
-				print_sfv_banner(fd);
-				print_banner = 0;
+		if (!entry) {
+			/* lines without a file path can't be checked for changes, so drop them */
+			if (opt.flags & OPT_DETECT_CHANGES) {
+				line_info->is_dropped = 1;
+				dropped++;
 			}
+			continue;
+		}
+		if (!entry->stats && stat(entry->filepath, &stats) == 0) {
+			/* stat only the files, which were not met by the directory scan */
+			file_set_item_set_stats(crc_entries, entry, &stats);
 		}
-		file_stat(&tmp_file, 0);
 
-		removed_index = line_set_exist(removed_entries, tmp_file.stats->st_ino);
-		if (removed_index >= 0) {
-			// the file has been moved, so reuse the same hashes of the input file for that inode
-			line_set_item *removed_item = line_set_get(removed_entries, removed_index);
-			if (removed_item->mtime == tmp_file.stats->st_mtim.tv_sec) { // check that the inode has not been reused
-				// replace the original name with the new,  keeping the rest of the original line
-				strncpy(new_line, removed_item->line, removed_item->path_offset);
-				strcpy(new_line + removed_item->path_offset, tmp_file.path);
-				strcat(new_line, removed_item->line + removed_item->path_offset + removed_item->path_len);
-				fputs(new_line, fd);
+		if (!entry->stats) {
+			/* the file is missing, but it can be moved to a new place */
+			if ((opt.flags & OPT_DETECT_CHANGES) && line_info->inode && line_info->mtime) {
+				line_set_add_line(removed_entries, line_info->line, line_info->path_offset,
+					line_info->path_len, dev, line_info->inode, line_info->mtime);
 			}
-			else {
-				/* print hash sums to the crc file */
-				calculate_and_print_sums(fd, &tmp_file, print_path);
+			line_info->is_dropped = 1;
+		} else if ((opt.flags & OPT_DETECT_CHANGES) &&
+				(line_info->inode != (uint64_t)entry->stats->st_ino || line_info->mtime != entry->stats->st_mtim.tv_sec)) {
+			/* the file has changed, re-calculate its hash sums if it was accepted by the scan */
+			if (entry->accepted) {
+				file_set_item* item = file_set_add_name(files_to_add, entry->filepath);
+				file_set_item_set_stats(files_to_add, item, entry->stats);
+				entry->accepted = 0; /* add the file once for duplicated lines */
 			}
+			line_info->is_dropped = 1;
 		}
-		else {
-			/* print hash sums to the crc file */
-			calculate_and_print_sums(fd, &tmp_file, print_path);
-		}
-
-		file_cleanup(&tmp_file);
-
-		if (rhash_data.interrupted) {
-			fclose(fd);
-			return 0;
-		}
+		if (line_info->is_dropped)
+			dropped++;
 	}
-	fclose(fd);
-	log_msg(_("Updated: %s\n"), file->path);
-	return 0;
+	return dropped;
 }
 
 /**
@@ -325,7 +329,8 @@ static int must_skip_file(file_t* file)
 }
 /**
  * Callback function to process new files while recursively traversing a directory.
- * It adds new files to the file_set of the caller.
+ * It adds new files to the file_set of the caller, and stores the attributes
+ * of the files already present in the hash file.
  *
  * @param file the file to process
  * @param call_back_data context of the call, containing the entries already present in the
@@ -333,134 +338,330 @@ static int must_skip_file(file_t* file)
  */
 static int update_file_callback(file_t* file, call_back_ctx call_back_data) {
 	update_call_back_ctx* ctx = call_back_data.pval;
+	file_set_item* item;
+	int accepted;
 
-	if (FILE_ISDATA(file) || !file_mask_match(opt.files_accept, file->path) ||
-		(opt.files_exclude && file_mask_match(opt.files_exclude, file->path)) ||
-		must_skip_file(file)) {
+	if (FILE_ISDATA(file))
+		return 0;
+	accepted = (file_mask_match(opt.files_accept, file->path) &&
+		!(opt.files_exclude && file_mask_match(opt.files_exclude, file->path)) &&
+		!must_skip_file(file));
+
+	item = file_set_find(ctx->crc_entries, file->path);
+	if (item) {
+		/* remember the attributes, to check the listed file without stat'ing it again */
+		if (ctx->keep_stats && file->stats)
+			file_set_item_set_stats(ctx->crc_entries, item, file->stats);
+		item->accepted = accepted;
 		return 0;
 	}
 
-	if(!file_set_exist(ctx->crc_entries, file->path))
-		file_set_add_name(ctx->files_to_add, file->path);
-
+	if (accepted && !(ctx->index && update_index_find(ctx->index, file->path))) {
+		item = file_set_add_name(ctx->files_to_add, file->path);
+		if (file->stats)
+			file_set_item_set_stats(ctx->files_to_add, item, file->stats);
+	}
 	return 0;
 }
 
 /**
- * Calculate and add to the given hash-file the hash-sums for all files
- * from the same directory as the hash-file, but absent from given
- * crc_entries file-set.
- *
- * <p/>If SFV format was specified by a command line switch, the after adding
- * hash sums SFV header of the file is fixed by moving all lines starting
- * with a semicolon before other lines. So an SFV-formatted hash-file
- * will remain correct.
+ * Scan the directory of a hash file for the files absent from the hash file.
  *
- * @param file the hash-file to add sums into
- * @param crc_entries file-set of files to omit from adding
- * @param removed_entries inode-line-set of files not found on the filesystem
- * @return 0 on success, -1 on error
+ * @param dir_path the directory to scan
+ * @param crc_entries file-set of the files listed in the hash file,
+ *        their attributes are stored if they will be needed to check the files
+ * @param files_to_add the file-set to store found files
+ * @param index the index of the hash file to use instead of crc_entries, can be NULL
  */
-static int add_new_crc_entries(file_t* file, file_set *crc_entries, inode_line_set* removed_entries)
+static void scan_new_files(char* dir_path, file_set *crc_entries, file_set* files_to_add, update_index* index)
 {
-	char* dir_path;
-	int res = 0;
 	struct update_call_back_ctx ctx;
 	struct file_search_data search_data;
 	file_t dir;
 
-	ctx.files_to_add = file_set_new();
+	ctx.files_to_add = files_to_add;
 	ctx.crc_entries = crc_entries;
-	ctx.removed_entries = removed_entries;
+	ctx.index = index;
+	ctx.keep_stats = ((opt.flags & (OPT_REMOVE_MISSING | OPT_DETECT_CHANGES)) || opt.fmt == FMT_SFV);
 
 	search_data.max_depth = opt.search_data->max_depth ? opt.search_data->max_depth : 1;
 	search_data.options = opt.search_data->options;
 	search_data.call_back = update_file_callback;
 	search_data.call_back_data.pval = &ctx;
 
-	dir_path = get_dirname(file->path);
 	file_init(&dir, dir_path, FILE_IFDIR | FILE_OPT_DONT_FREE_PATH);
-
 	dir_scan(&dir, &search_data);
+}
 
-	if (ctx.files_to_add->size > 0) {
-		/* sort files by path */
-		file_set_sort_by_path(ctx.files_to_add);
+/**
+ * Print an SFV header line of a file with known attributes.
+ *
+ * @param out the stream to print to
+ * @param path the file path
+ * @param stats the file attributes
+ */
+static void print_sfv_header_stats(FILE* out, const char* path, struct stat* stats)
+{
+	file_t tmp_file;
+	file_init(&tmp_file, path, FILE_OPT_DONT_FREE_PATH);
+	tmp_file.stats = stats;
+	tmp_file.size = stats->st_size;
+	print_sfv_header_line(out, &tmp_file, 0);
+	tmp_file.stats = NULL; /* the attributes are not owned by tmp_file */
+	file_cleanup(&tmp_file);
+}
 
-		/* calculate and write crc sums to the file */
-		res = add_sums_to_file(file, dir_path, ctx.files_to_add, removed_entries);
+/**
+ * Print SFV header for the kept lines of a rewritten hash file and
+ * for the files to add, so the header is merged in one pass.
+ *
+ * @param out the stream to print to
+ * @param crc_lines the loaded lines of the hash file
+ * @param crc_entries the file set of the loaded lines
+ * @param files_to_add the files, which hash sums will be added
+ * @return 0 on success, -1 if a listed file can't be stat'ed
+ */
+static int print_sfv_header(FILE* out, vector_t* crc_lines, file_set* crc_entries, file_set* files_to_add)
+{
+	struct stat stats;
+	size_t i;
+
+	print_sfv_banner(out);
+	for (i = 0; i < crc_lines->size; i++) {
+		crc_line* line_info = (crc_line*)crc_lines->array[i];
+		file_set_item* entry = line_info->entry;
+		if (!entry || line_info->is_dropped)
+			continue;
+		if (!entry->stats) {
+			if (stat(entry->filepath, &stats) < 0)
+				return -1;
+			file_set_item_set_stats(crc_entries, entry, &stats);
+		}
+		print_sfv_header_stats(out, entry->filepath, entry->stats);
 	}
-
-	if (res == 0 && opt.fmt == FMT_SFV && !rhash_data.interrupted) {
-		/* move SFV header from the end of updated file to its head */
-		res = fix_sfv_header(file);
+	for (i = 0; i < files_to_add->size; i++) {
+		file_set_item* item = file_set_get(files_to_add, i);
+		if (!item->stats && stat(item->filepath, &stats) == 0)
+			file_set_item_set_stats(files_to_add, item, &stats);
+		if (item->stats)
+			print_sfv_header_stats(out, item->filepath, item->stats);
 	}
-
-	file_set_free(ctx.files_to_add);
-	free(dir_path);
-	return res;
+	return 0;
 }
 
 /**
- * Move all SFV header lines (i.e. all lines starting with a semicolon)
- * from the end of updated file to its head.
+ * Calculate hash sums of files from given file-set and print them to a hash file stream.
+ * A specified directory path will be prepended to the path of added files,
+ * if it is not a current directory.
  *
- * @param file the hash file requiring fixing of its SFV header
+ * @param fd the stream of the hash file to print the hash sums to
+ * @param dir_path the directory path to prepend
+ * @param files_to_add the set of files to hash and add
+ * @param removed_entries the lines of files, which were moved
+ * @param index the index to add the lines to, can be NULL
  */
-static int fix_sfv_header(file_t* file)
+static void add_sums_to_file(FILE* fd, char* dir_path, file_set *files_to_add, inode_line_set* removed_entries,
+	update_index* index)
 {
-	FILE* in;
-	FILE* out;
-	char line[2048];
-	file_t new_file;
-	int err = 0;
+	unsigned i;
+	char new_line[2048];
 
-	if ( !(in = file_fopen(file, FOpenRead))) {
-		log_file_t_error(file);
-		return -1;
-	}
+	/* append hash sums to the updated crc file */
+	for (i = 0; i < files_to_add->size; i++, rhash_data.processed++) {
+		file_t tmp_file;
+		file_set_item* item = file_set_get(files_to_add, i);
+		char *print_path = item->filepath;
+		line_set_item* removed_item = NULL;
+		uint64_t offset = (index ? (uint64_t)rsh_ftell(fd) : 0);
+		memset(&tmp_file, 0, sizeof(tmp_file));
 
-	/* open a temporary file for writing */
-	file_path_append(&new_file, file, ".new");
-	if ( !(out = file_fopen(&new_file, FOpenWrite) )) {
-		log_file_t_error(&new_file);
-		file_cleanup(&new_file);
-		fclose(in);
-		return -1;
-	}
+		if (dir_path[0] != '.' || dir_path[1] != 0) {
+			/* prepend the file path by directory path */
+			file_init(&tmp_file, make_path(dir_path, print_path), 0);
+		} else {
+			file_init(&tmp_file, print_path, FILE_OPT_DONT_FREE_PATH);
+		}
 
-	/* The first, output all commented lines to the file header */
-	while (fgets(line, 2048, in)) {
-		if (*line == ';') {
-			if (fputs(line, out) < 0) break;
+		if (item->stats) {
+			/* reuse the attributes found by the directory scan */
+			tmp_file.stats = item->stats;
+			tmp_file.size = item->stats->st_size;
+			tmp_file.mode |= FILE_IFREG;
+		} else {
+			file_stat(&tmp_file, 0);
 		}
-	}
-	if (!ferror(out) && !ferror(in)) {
-		fseek(in, 0, SEEK_SET);
-		/* The second, output non-commented lines */
-		while (fgets(line, 2048, in)) {
-			if (*line != ';') {
-				if (fputs(line, out) < 0) break;
+
+		if (tmp_file.stats)
+			removed_item = line_set_find(removed_entries, tmp_file.stats->st_dev, tmp_file.stats->st_ino);
+		if (removed_item) {
+			// the file has been moved, so reuse the same hashes of the input file for that inode
+			if (removed_item->mtime == tmp_file.stats->st_mtim.tv_sec) { // check that the inode has not been reused
+				// replace the original name with the new,  keeping the rest of the original line
+				strncpy(new_line, removed_item->line, removed_item->path_offset);
+				strcpy(new_line + removed_item->path_offset, tmp_file.path);
+				strcat(new_line, removed_item->line + removed_item->path_offset + removed_item->path_len);
+				fputs(new_line, fd);
 			}
+			else {
+				/* print hash sums to the crc file */
+				calculate_and_print_sums(fd, &tmp_file, print_path);
+			}
+		}
+		else {
+			/* print hash sums to the crc file */
+			calculate_and_print_sums(fd, &tmp_file, print_path);
 		}
+
+		/* index the line, if it was printed */
+		if (index && tmp_file.stats && (uint64_t)rsh_ftell(fd) > offset) {
+			update_index_add(index, print_path, tmp_file.stats->st_ino,
+				tmp_file.stats->st_mtime, tmp_file.size, offset);
+		}
+		if (tmp_file.stats == item->stats)
+			tmp_file.stats = NULL; /* the attributes are owned by the file set */
+		file_cleanup(&tmp_file);
+
+		if (rhash_data.interrupted)
+			break;
 	}
-	if (ferror(in)) {
+}
+
+/**
+ * Open given hash file for appending, adding a missing EOL to its last line.
+ *
+ * @param file the hash file to open
+ * @return the opened stream on success, NULL on error
+ */
+static FILE* open_for_append(file_t* file)
+{
+	FILE* fd;
+	int ch;
+
+	file->size = 0;
+	file_stat(file, 0);
+
+	/* open the hash file for writing */
+	if ( !(fd = file_fopen(file, FOpenRead | FOpenWrite) )) {
 		log_file_t_error(file);
-		err = 1;
+		return NULL;
 	}
-	if (ferror(out)) {
-		log_file_t_error(&new_file);
-		err = 1;
+
+	if (file->size > 0) {
+		/* read the last character of the file to check if it is EOL */
+		if (fseek(fd, -1, SEEK_END) != 0) {
+			log_file_t_error(file);
+			fclose(fd);
+			return NULL;
+		}
+		ch = fgetc(fd);
+
+		/* somehow writing doesn't work without seeking */
+		if (fseek(fd, 0, SEEK_END) != 0) {
+			log_file_t_error(file);
+			fclose(fd);
+			return NULL;
+		}
+
+		/* write EOL if it wasn't present */
+		if (ch != '\n' && ch != '\r') {
+			/* fputc('\n', fd); */
+			rsh_fprintf(fd, "\n");
+		}
 	}
+	return fd;
+}
 
-	fclose(in);
-	fclose(out);
+/**
+ * Add hash sums of new files to the hash file.
+ *
+ * <p/>If no loaded line is dropped, then the hash sums are appended to the hash file,
+ * so its unchanged part is neither read nor written again. Otherwise the hash file is
+ * rewritten in one pass: the SFV header, the kept lines and the hash sums of new files.
+ *
+ * @param file the hash file to update
+ * @param dir_path the directory of the hash file
+ * @param crc_lines the loaded lines of the hash file
+ * @param rewrite non-zero to rewrite the hash file, zero to append to it
+ * @param crc_entries the file set of the loaded lines
+ * @param files_to_add the set of files to hash and add
+ * @param removed_entries the lines of files, which were moved
+ * @param index the index to add the lines to, can be NULL
+ * @return 0 on success, -1 on error
+ */
+static int write_crc_file(file_t* file, char* dir_path, vector_t* crc_lines, int rewrite,
+	file_set* crc_entries, file_set* files_to_add, inode_line_set* removed_entries, update_index* index)
+{
+	FILE* fd;
+	file_t new_file;
+	uint64_t offset = 0;
+	size_t i;
+	int err = 0;
+
+	/* sort files by path */
+	file_set_sort_by_path(files_to_add);
+
+	if (!rewrite) {
+		/* the loaded lines keep their places in the hash file */
+		for (i = 0; index && i < crc_lines->size; i++) {
+			crc_line* line_info = (crc_line*)crc_lines->array[i];
+			if (line_info->entry) {
+				update_index_add(index, line_info->entry->filepath, line_info->inode,
+					line_info->mtime, line_info->file_size, line_info->offset);
+			}
+		}
+		if (files_to_add->size == 0)
+			return 0;
+		if ( !(fd = open_for_append(file)) )
+			return -1;
+		add_sums_to_file(fd, dir_path, files_to_add, removed_entries, index);
+		if (ferror(fd)) {
+			log_file_t_error(file);
+			err = 1;
+		}
+		fclose(fd);
+	} else {
+		/* open a temporary file for writing */
+		file_path_append(&new_file, file, ".new");
+		if ( !(fd = file_fopen(&new_file, FOpenWrite) )) {
+			log_file_t_error(&new_file);
+			file_cleanup(&new_file);
+			return -1;
+		}
 
-	/* overwrite the hash file with a new one */
-	if (!err && file_rename(&new_file, file) < 0) {
-		log_error(_("can't move %s to %s: %s\n"),
-				  new_file.path, file->path, strerror(errno));
+		if (opt.fmt == FMT_SFV && print_sfv_header(fd, crc_lines, crc_entries, files_to_add) < 0)
+			err = 1;
+
+		/* write back the kept lines */
+		for (i = 0; !err && i < crc_lines->size; i++) {
+			crc_line* line_info = (crc_line*)crc_lines->array[i];
+			if (line_info->is_dropped)
+				continue;
+			if (fputs(line_info->line, fd) < 0)
+				break;
+			if (index && line_info->entry) {
+				update_index_add(index, line_info->entry->filepath, line_info->inode,
+					line_info->mtime, line_info->file_size, offset);
+			}
+			offset += strlen(line_info->line);
+		}
+		if (!err && !ferror(fd))
+			add_sums_to_file(fd, dir_path, files_to_add, removed_entries, index);
+
+		if (ferror(fd)) {
+			log_file_t_error(&new_file);
+			err = 1;
+		}
+		fclose(fd);
+
+		/* overwrite the hash file with a new one */
+		if (!err && file_rename(&new_file, file) < 0) {
+			log_error(_("can't move %s to %s: %s\n"),
+					  new_file.path, file->path, strerror(errno));
+		}
+		file_cleanup(&new_file);
 	}
-	file_cleanup(&new_file);
+
+	if (!err && files_to_add->size > 0 && !rhash_data.interrupted)
+		log_msg(_("Updated: %s\n"), file->path);
 	return (err ? -1 : 0);
 }
@@ -245,6 +245,27 @@ static void rhash_aich_hash_tree(aich_ctx *ctx, unsigned char* result, int type)
 #define AICH_PROCESS_FINAL_BLOCK 1
 #define AICH_PROCESS_FLUSH_BLOCK 2
 
+/**
+ * Get the place to store the hash of the last processed 180K/140K block
+ * of the current ed2k chunk.
+ *
+ * @param ctx algorithm context
+ * @return pointer to the block hash on success, NULL on memory error
+ */
+static unsigned char* rhash_aich_block_hash_ptr(aich_ctx *ctx)
+{
+	/* ensure that the block_hashes array is allocated to save the result */
+	if (ctx->block_hashes == NULL) {
+		ctx->block_hashes = (unsigned char (*)[sha1_hash_size])malloc(BLOCKS_PER_CHUNK * sha1_hash_size);
+		if (ctx->block_hashes == NULL) {
+			ctx->error = 1;
+			return NULL;
+		}
+	}
+	assert(((ctx->index - 1) / FULL_BLOCK_SIZE) < BLOCKS_PER_CHUNK);
+	return ctx->block_hashes[(ctx->index - 1) / FULL_BLOCK_SIZE];
+}
+
 /**
  * Calculate and store a hash for a 180K/140K block.
  * Also, if it is the last block of a 9.2MiB ed2k chunk or of the hashed message,
@@ -252,28 +273,20 @@ static void rhash_aich_hash_tree(aich_ctx *ctx, unsigned char* result, int type)
  *
  * @param ctx algorithm context
  * @param type the actions to take, can be combination of bits AICH_PROCESS_FINAL_BLOCK
- *             and AICH_PROCESS_FLUSH_BLOCK
+ *             and AICH_PROCESS_FLUSH_BLOCK. Zero value is used, when the block hash
+ *             is already stored
  */
 static void rhash_aich_process_block(aich_ctx *ctx, int type)
 {
-	assert(type != 0);
 	assert(ctx->index <= ED2K_CHUNK_SIZE);
 
 	/* if there is unprocessed data left in the current 180K block. */
 	if ((type & AICH_PROCESS_FLUSH_BLOCK) != 0)
 	{
-		/* ensure that the block_hashes array is allocated to save the result */
-		if (ctx->block_hashes == NULL) {
-			ctx->block_hashes = (unsigned char (*)[sha1_hash_size])malloc(BLOCKS_PER_CHUNK * sha1_hash_size);
-			if (ctx->block_hashes == NULL) {
-				ctx->error = 1;
-				return;
-			}
-		}
-
 		/* store the 180-KiB block hash to the block_hashes array */
-		assert(((ctx->index - 1) / FULL_BLOCK_SIZE) < BLOCKS_PER_CHUNK);
-		SHA1_FINAL(ctx, ctx->block_hashes[(ctx->index - 1) / FULL_BLOCK_SIZE]);
+		unsigned char* block_hash = rhash_aich_block_hash_ptr(ctx);
+		if (block_hash == NULL) return;
+		SHA1_FINAL(ctx, block_hash);
 	}
 
 	/* check, if it's time to calculate the tree hash for the current ed2k chunk */
@@ -345,6 +358,72 @@ void rhash_aich_update(aich_ctx *ctx, const unsigned char* msg, size_t size)
 	assert(ctx->index < ED2K_CHUNK_SIZE);
 }
 
+/* the maximal number of blocks hashed by one call of the thread pool */
+#define AICH_MAX_JOB_BLOCKS 128
+
+/**
+ * Calculate message hash, hashing whole 180K/140K blocks of the message
+ * by threads of the given pool. The block hashes are stored in the message
+ * order and the tree hashes of ed2k chunks are calculated by
+ * rhash_aich_hash_tree(), so the result is the same as of rhash_aich_update().
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+void rhash_aich_update_mt(aich_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool)
+{
+	const void* messages[AICH_MAX_JOB_BLOCKS];
+	size_t lengths[AICH_MAX_JOB_BLOCKS];
+	unsigned char* results[AICH_MAX_JOB_BLOCKS];
+	unsigned char hashes[AICH_MAX_JOB_BLOCKS][sha1_hash_size];
+	size_t count, offset, i;
+
+	if (ctx->error) return;
+
+	/* finish the current block */
+	if ((ctx->index % FULL_BLOCK_SIZE) != 0) {
+		unsigned left_in_chunk = ED2K_CHUNK_SIZE - ctx->index;
+		size_t rest = (left_in_chunk <= LAST_BLOCK_SIZE ? left_in_chunk :
+			FULL_BLOCK_SIZE - ctx->index % FULL_BLOCK_SIZE);
+		if (size < rest) rest = size;
+		rhash_aich_update(ctx, msg, rest);
+		msg  += rest;
+		size -= rest;
+	}
+
+	while (rhash_thread_pool_size(pool) > 1 && !ctx->error) {
+		unsigned index = ctx->index;
+		for (count = 0, offset = 0; count < AICH_MAX_JOB_BLOCKS; count++) {
+			unsigned left_in_chunk = ED2K_CHUNK_SIZE - index;
+			unsigned block_size = (left_in_chunk <= LAST_BLOCK_SIZE ? left_in_chunk : FULL_BLOCK_SIZE);
+			if (size - offset < block_size) break;
+			messages[count] = msg + offset;
+			lengths[count] = block_size;
+			results[count] = hashes[count];
+			offset += block_size;
+			index = (block_size == left_in_chunk ? 0 : index + block_size);
+		}
+		if (count < 2 || rhash_msg_batch_mt(RHASH_SHA1, messages, lengths, results, count, pool) < 0)
+			break; /* hash the rest of the message in the current thread */
+
+		/* store block hashes and calculate tree hashes of complete ed2k chunks */
+		for (i = 0; i < count; i++) {
+			unsigned char* block_hash;
+			ctx->index += (unsigned)lengths[i];
+			block_hash = rhash_aich_block_hash_ptr(ctx);
+			if (block_hash == NULL) return;
+			memcpy(block_hash, hashes[i], sha1_hash_size);
+			rhash_aich_process_block(ctx, 0);
+		}
+		SHA1_INIT(ctx); /* the context is used by tree hashing */
+		msg  += offset;
+		size -= offset;
+	}
+	rhash_aich_update(ctx, msg, size);
+}
+
 /**
  * Store calculated hash into the given array.
  *
@@ -397,3 +476,90 @@ void rhash_aich_final(aich_ctx *ctx, unsigned char result[20])
 	ctx->sha1_context.length = total_size; /* store total message size  */
 	if (result) memcpy(result, hash, sha1_hash_size);
 }
+
+/**
+ * Export the algorithm context into a memory buffer.
+ * The block hashes of the current ed2k chunk and the table of chunk hashes
+ * are stored after the context structure.
+ *
+ * @param ctx the algorithm context
+ * @param out the buffer to export the context into, can be NULL
+ * @param size size of the buffer
+ * @return the size of exported data, or 0 if the buffer is too small
+ */
+size_t rhash_aich_export(const aich_ctx *ctx, void* out, size_t size)
+{
+	size_t export_size = sizeof(aich_ctx) + ctx->chunks_number * sizeof(hash_pair_t);
+	char* p = (char*)out;
+	size_t i, count;
+
+	if (ctx->block_hashes)
+		export_size += BLOCKS_PER_CHUNK * sha1_hash_size;
+	if (!out) return export_size;
+	if (size < export_size) return 0;
+
+	memcpy(p, ctx, sizeof(aich_ctx));
+	p += sizeof(aich_ctx);
+	if (ctx->block_hashes) {
+		memcpy(p, ctx->block_hashes, BLOCKS_PER_CHUNK * sha1_hash_size);
+		p += BLOCKS_PER_CHUNK * sha1_hash_size;
+	}
+	for (i = 0; i < ctx->chunks_number; i += CT_GROUP_SIZE) {
+		count = ctx->chunks_number - i;
+		if (count > CT_GROUP_SIZE) count = CT_GROUP_SIZE;
+		memcpy(p, ctx->chunk_table[i >> CT_BITS], count * sizeof(hash_pair_t));
+		p += count * sizeof(hash_pair_t);
+	}
+	return export_size;
+}
+
+/**
+ * Import the algorithm context, exported by rhash_aich_export().
+ * The context must be freshly initialized by rhash_aich_init().
+ *
+ * @param ctx the algorithm context to import data into
+ * @param in the exported data
+ * @param size size of the exported data
+ * @return the size of imported data, 0 on error
+ */
+size_t rhash_aich_import(aich_ctx *ctx, const void* in, size_t size)
+{
+	const char* p = (const char*)in;
+	aich_ctx saved;
+	size_t i, count, import_size = sizeof(aich_ctx);
+
+	if (size < sizeof(aich_ctx)) return 0;
+	memcpy(&saved, p, sizeof(aich_ctx));
+	p += sizeof(aich_ctx);
+	if (saved.index > ED2K_CHUNK_SIZE || saved.error ||
+			saved.chunks_number > (size - import_size) / sizeof(hash_pair_t))
+		return 0;
+	import_size += saved.chunks_number * sizeof(hash_pair_t);
+	if (saved.block_hashes) {
+		import_size += BLOCKS_PER_CHUNK * sha1_hash_size;
+		if (size < import_size) return 0;
+		ctx->block_hashes = (unsigned char (*)[sha1_hash_size])malloc(BLOCKS_PER_CHUNK * sha1_hash_size);
+		if (ctx->block_hashes == NULL) return 0;
+		memcpy(ctx->block_hashes, p, BLOCKS_PER_CHUNK * sha1_hash_size);
+		p += BLOCKS_PER_CHUNK * sha1_hash_size;
+	}
+	for (i = 0; i < saved.chunks_number; i += CT_GROUP_SIZE) {
+		ctx->chunks_number = i; /* keep the context consistent for cleanup */
+		rhash_aich_chunk_table_extend(ctx, (unsigned)i);
+		if (ctx->error) return 0;
+		count = saved.chunks_number - i;
+		if (count > CT_GROUP_SIZE) count = CT_GROUP_SIZE;
+		memcpy(ctx->chunk_table[i >> CT_BITS], p, count * sizeof(hash_pair_t));
+		p += count * sizeof(hash_pair_t);
+		ctx->chunks_number = i + count;
+	}
+
+	/* restore the hashing state, keeping own methods and allocated memory */
+	memcpy(&ctx->sha1_context, &saved.sha1_context, sizeof(ctx->sha1_context));
+#if defined(USE_OPENSSL) || defined(OPENSSL_RUNTIME)
+	memcpy(&ctx->reserved, &saved.reserved, sizeof(ctx->reserved));
+#endif
+	ctx->index = saved.index;
+	assert((size_t)(p - (const char*)in) == import_size);
+	return import_size;
+}
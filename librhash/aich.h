@@ -2,6 +2,7 @@
 #ifndef AICH_H
 #define AICH_H
 #include "sha1.h"
+#include "thread_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,7 @@ typedef struct aich_ctx
 
 void rhash_aich_init(aich_ctx *ctx);
 void rhash_aich_update(aich_ctx *ctx, const unsigned char* msg, size_t size);
+void rhash_aich_update_mt(aich_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool);
 void rhash_aich_final(aich_ctx *ctx, unsigned char result[20]);
 
 /* Clean up context by freeing allocated memory.
@@ -35,6 +37,11 @@ void rhash_aich_final(aich_ctx *ctx, unsigned char result[20]);
  * Shall be called when aborting hash calculations. */
 void rhash_aich_cleanup(aich_ctx* ctx);
 
+/* Export/import the context with its allocated data,
+ * return the size of exported/imported data, 0 on error. */
+size_t rhash_aich_export(const aich_ctx *ctx, void* out, size_t size);
+size_t rhash_aich_import(aich_ctx *ctx, const void* in, size_t size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
@@ -23,6 +23,9 @@
 
 /* header files of all supported hash sums */
 #include "aich.h"
+#include "blake2b.h"
+#include "blake2s.h"
+#include "blake3.h"
 #include "crc32.h"
 #include "ed2k.h"
 #include "edonr.h"
@@ -98,6 +101,9 @@ rhash_info info_sha3_224 = { RHASH_SHA3_224, F_LE64, 28, "SHA3-224", "sha3-224"
 rhash_info info_sha3_256 = { RHASH_SHA3_256, F_LE64, 32, "SHA3-256", "sha3-256" };
 rhash_info info_sha3_384 = { RHASH_SHA3_384, F_LE64, 48, "SHA3-384", "sha3-384" };
 rhash_info info_sha3_512 = { RHASH_SHA3_512, F_LE64, 64, "SHA3-512", "sha3-512" };
+rhash_info info_blake2s = { RHASH_BLAKE2S, F_LE32, 32, "BLAKE2S", "blake2s" };
+rhash_info info_blake2b = { RHASH_BLAKE2B, F_LE64, 64, "BLAKE2B", "blake2b" };
+rhash_info info_blake3  = { RHASH_BLAKE3,  F_LE32, 32, "BLAKE3", "blake3" };
 
 /* some helper macros */
 #define dgshft(name) (((char*)&((name##_ctx*)0)->hash) - (char*)0)
@@ -141,6 +147,9 @@ rhash_hash_info rhash_hash_info_default[RHASH_HASH_COUNT] =
 	{ &info_crc32c, sizeof(uint32_t), 0, iuf(rhash_crc32c), 0 }, /* 32 bit */
 	{ &info_snf128, sizeof(snefru_ctx), dgshft(snefru), iuf2(rhash_snefru128, rhash_snefru), 0 }, /* 128 bit */
 	{ &info_snf256, sizeof(snefru_ctx), dgshft(snefru), iuf2(rhash_snefru256, rhash_snefru), 0 }, /* 256 bit */
+	{ &info_blake2s, sizeof(blake2s_ctx), dgshft(blake2s), iuf(rhash_blake2s), 0 }, /* 256 bit */
+	{ &info_blake2b, sizeof(blake2b_ctx), dgshft(blake2b), iuf(rhash_blake2b), 0 }, /* 512 bit */
+	{ &info_blake3, sizeof(blake3_ctx), dgshft(blake3), iuf(rhash_blake3), 0 }, /* 256 bit */
 };
 
 /**
@@ -171,11 +180,35 @@ const rhash_info* rhash_info_by_id(unsigned hash_id)
 {
 	hash_id &= RHASH_ALL_HASHES;
 	/* check that only one bit is set */
-	if (hash_id != (hash_id & -(int)hash_id)) return NULL;
+	if (hash_id != (hash_id & (0u - hash_id))) return NULL;
 	/* note: alternative condition is (hash_id == 0 || (hash_id & (hash_id - 1)) != 0) */
 	return rhash_info_table[rhash_ctz(hash_id)].info;
 }
 
+/**
+ * Return the function updating a hash algorithm by several threads.
+ * Such function splits a message between all threads of the given pool.
+ *
+ * @param hash_id the id of hash algorithm
+ * @return the update function or NULL, if the algorithm can't be split between threads
+ */
+pupdate_mt_t rhash_update_mt_by_id(unsigned hash_id)
+{
+	switch (hash_id) {
+	case RHASH_TTH:
+		return (pupdate_mt_t)rhash_tth_update_mt;
+	case RHASH_BTIH:
+		return (pupdate_mt_t)bt_update_mt;
+	case RHASH_ED2K:
+		return (pupdate_mt_t)rhash_ed2k_update_mt;
+	case RHASH_AICH:
+		return (pupdate_mt_t)rhash_aich_update_mt;
+	case RHASH_BLAKE3:
+		return (pupdate_mt_t)rhash_blake3_update_mt;
+	}
+	return NULL;
+}
+
 /* CRC32 helper functions */
 
 /**
@@ -5,6 +5,7 @@
 #include <stddef.h> /* for ptrdiff_t */
 #include "rhash.h"
 #include "byte_order.h"
+#include "thread_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,7 @@ typedef void (*pinit_t)(void*);
 typedef void (*pupdate_t)(void *ctx, const void* msg, size_t size);
 typedef void (*pfinal_t)(void*, unsigned char*);
 typedef void (*pcleanup_t)(void*);
+typedef void (*pupdate_mt_t)(void *ctx, const void* msg, size_t size, rhash_thread_pool* pool);
 
 /**
  * Information about a hash function
@@ -85,7 +87,12 @@ typedef struct rhash_context_ext
 	unsigned flags;
 	unsigned state;
 	void *callback, *callback_data;
+	void *block_callback, *block_callback_data;
 	void *bt_ctx;
+	void *thread_pool; /* workers for multi-threaded update, can be NULL */
+	unsigned threads; /* the number of threads, requested by rhash_set_threads() */
+	size_t io_block_size; /* size of blocks read by rhash_fd_update() */
+	size_t alloc_size; /* size of the memory block, holding the context */
 	rhash_vector_item vector[1]; /* contexts of contained hash sums */
 } rhash_context_ext;
 
@@ -121,6 +128,9 @@ extern rhash_info info_sha3_384;
 extern rhash_info info_sha3_512;
 extern rhash_info info_edr256;
 extern rhash_info info_edr512;
+extern rhash_info info_blake2s;
+extern rhash_info info_blake2b;
+extern rhash_info info_blake3;
 
 /* rhash_info flags */
 #define F_BS32 1   /* default output in base32 */
@@ -142,6 +152,9 @@ extern rhash_info info_edr512;
 
 void rhash_init_algorithms(unsigned mask);
 const rhash_info* rhash_info_by_id(unsigned hash_id); /* get hash sum info by hash id */
+pupdate_mt_t rhash_update_mt_by_id(unsigned hash_id); /* get multi-threaded update function */
+int rhash_msg_batch_mt(unsigned hash_id, const void* messages[], const size_t lengths[],
+	unsigned char* results[], size_t count, rhash_thread_pool* pool);
 
 #if defined(OPENSSL_RUNTIME) && !defined(USE_OPENSSL)
 # define USE_OPENSSL
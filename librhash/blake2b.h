@@ -0,0 +1,29 @@
+/* blake2b.h BLAKE2b hash function */
+#ifndef BLAKE2B_H
+#define BLAKE2B_H
+#include "ustd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define blake2b_block_size 128
+#define blake2b_hash_size  64
+
+/* algorithm context */
+typedef struct blake2b_ctx
+{
+	uint64_t hash[8];     /* 512-bit algorithm internal hashing state */
+	uint64_t message[16]; /* 1024-bit buffer for leftovers */
+	uint64_t length;      /* number of processed bytes */
+} blake2b_ctx;
+
+void rhash_blake2b_init(blake2b_ctx *ctx);
+void rhash_blake2b_update(blake2b_ctx *ctx, const unsigned char* data, size_t length);
+void rhash_blake2b_final(blake2b_ctx *ctx, unsigned char* result);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* BLAKE2B_H */
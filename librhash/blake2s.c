@@ -0,0 +1,160 @@
+/* blake2s.c - an implementation of BLAKE2s hash function, see RFC 7693.
+ *
+ * Copyright: 2026 RHash contributors
+ *
+ * Permission is hereby granted,  free of charge,  to any person  obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,  including without limitation
+ * the rights to  use, copy, modify,  merge, publish, distribute, sublicense,
+ * and/or sell copies  of  the Software,  and to permit  persons  to whom the
+ * Software is furnished to do so.
+ *
+ * This program  is  distributed  in  the  hope  that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  Use this program  at  your own risk!
+ */
+
+#include <string.h>
+#include "byte_order.h"
+#include "blake2s.h"
+
+/* the initialization vector, the same as the initial SHA-256 hash value */
+static const unsigned blake2s_IV[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* message word permutations for 10 rounds */
+static const unsigned char blake2s_sigma[10][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+	{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+	{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+	{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+	{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+	{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+	{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+	{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+	{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+/**
+ * Initialize context before calculating hash.
+ *
+ * @param ctx context to initialize
+ */
+void rhash_blake2s_init(blake2s_ctx *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	memcpy(ctx->hash, blake2s_IV, sizeof(ctx->hash));
+	/* parameter block: 32-byte digest, no key, fanout and depth are 1 */
+	ctx->hash[0] ^= 0x01010000 ^ blake2s_hash_size;
+}
+
+#define G(a, b, c, d, x, y) { \
+	a += b + (x); d = ROTR32(d ^ a, 16); \
+	c += d;       b = ROTR32(b ^ c, 12); \
+	a += b + (y); d = ROTR32(d ^ a, 8); \
+	c += d;       b = ROTR32(b ^ c, 7); }
+
+#define ROUND(r) { \
+	const unsigned char* s = blake2s_sigma[r]; \
+	G(v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]); \
+	G(v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]); \
+	G(v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]); \
+	G(v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]); \
+	G(v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]); \
+	G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]); \
+	G(v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]); \
+	G(v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]); }
+
+/**
+ * The core transformation. Process a 512-bit block.
+ *
+ * @param hash algorithm state
+ * @param block the message block to process
+ * @param length the number of message bytes processed including the block
+ * @param is_last non-zero for the last block of the message
+ */
+static void rhash_blake2s_process_block(unsigned hash[8], const unsigned block[16], uint64_t length, int is_last)
+{
+	unsigned m[16], v[16];
+	int i;
+
+	for (i = 0; i < 16; i++)
+		m[i] = le2me_32(block[i]);
+	for (i = 0; i < 8; i++) {
+		v[i] = hash[i];
+		v[i + 8] = blake2s_IV[i];
+	}
+	v[12] ^= (unsigned)length;
+	v[13] ^= (unsigned)(length >> 32);
+	if (is_last)
+		v[14] = ~v[14];
+
+	for (i = 0; i < 10; i++)
+		ROUND(i);
+
+	for (i = 0; i < 8; i++)
+		hash[i] ^= v[i] ^ v[i + 8];
+}
+
+/**
+ * Calculate message hash.
+ * Can be called repeatedly with chunks of the message to be hashed.
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ */
+void rhash_blake2s_update(blake2s_ctx *ctx, const unsigned char* msg, size_t size)
+{
+	if (size == 0)
+		return;
+
+	/* the last block is processed by final, so a full block can be kept buffered */
+	if (ctx->length > 0) {
+		size_t index = (((size_t)ctx->length - 1) & 63) + 1;
+		size_t left = blake2s_block_size - index;
+		if (left > 0) {
+			if (size < left) left = size;
+			memcpy((char*)ctx->message + index, msg, left);
+			ctx->length += left;
+			msg  += left;
+			size -= left;
+			if (size == 0)
+				return;
+		}
+		rhash_blake2s_process_block(ctx->hash, ctx->message, ctx->length, 0);
+	}
+	while (size > blake2s_block_size) {
+		ctx->length += blake2s_block_size;
+		if (IS_ALIGNED_32(msg)) {
+			rhash_blake2s_process_block(ctx->hash, (const unsigned*)msg, ctx->length, 0);
+		} else {
+			memcpy(ctx->message, msg, blake2s_block_size);
+			rhash_blake2s_process_block(ctx->hash, ctx->message, ctx->length, 0);
+		}
+		msg  += blake2s_block_size;
+		size -= blake2s_block_size;
+	}
+	memcpy(ctx->message, msg, size);
+	ctx->length += size;
+}
+
+/**
+ * Store calculated hash into the given array.
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param result calculated hash in binary form
+ */
+void rhash_blake2s_final(blake2s_ctx *ctx, unsigned char* result)
+{
+	size_t index = (ctx->length > 0 ? (((size_t)ctx->length - 1) & 63) + 1 : 0);
+
+	/* pad the last block with zeros */
+	memset((char*)ctx->message + index, 0, blake2s_block_size - index);
+	rhash_blake2s_process_block(ctx->hash, ctx->message, ctx->length, 1);
+
+	if (result) le32_copy(result, 0, ctx->hash, blake2s_hash_size);
+}
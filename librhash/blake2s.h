@@ -0,0 +1,29 @@
+/* blake2s.h BLAKE2s hash function */
+#ifndef BLAKE2S_H
+#define BLAKE2S_H
+#include "ustd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define blake2s_block_size 64
+#define blake2s_hash_size  32
+
+/* algorithm context */
+typedef struct blake2s_ctx
+{
+	unsigned hash[8];     /* 256-bit algorithm internal hashing state */
+	unsigned message[16]; /* 512-bit buffer for leftovers */
+	uint64_t length;      /* number of processed bytes */
+} blake2s_ctx;
+
+void rhash_blake2s_init(blake2s_ctx *ctx);
+void rhash_blake2s_update(blake2s_ctx *ctx, const unsigned char* data, size_t length);
+void rhash_blake2s_final(blake2s_ctx *ctx, unsigned char* result);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* BLAKE2S_H */
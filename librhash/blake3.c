@@ -0,0 +1,564 @@
+/* blake3.c - an implementation of BLAKE3 hash function
+ *
+ * Copyright: 2026 RHash contributors
+ *
+ * Permission is hereby granted,  free of charge,  to any person  obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,  including without limitation
+ * the rights to  use, copy, modify,  merge, publish, distribute, sublicense,
+ * and/or sell copies  of  the Software,  and to permit  persons  to whom the
+ * Software is furnished to do so.
+ *
+ * This program  is  distributed  in  the  hope  that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  Use this program  at  your own risk!
+ *
+ * The message is split into 1 KiB chunks, which are hashed independently
+ * and combined by a binary tree. So the whole chunks are hashed by SIMD
+ * instructions, several chunks at once.
+ */
+
+#include <string.h>
+#include "byte_order.h"
+#include "blake3.h"
+
+/* domain separation flags */
+#define CHUNK_START 1
+#define CHUNK_END   2
+#define PARENT      4
+#define ROOT        8
+
+/* the initialization vector, the same as the initial SHA-256 hash value */
+static const unsigned blake3_IV[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* message word permutations for 7 rounds */
+static const unsigned char blake3_schedule[7][16] = {
+	{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+	{  2,  6,  3, 10,  7,  0,  4, 13,  1, 11, 12,  5,  9, 14, 15,  8 },
+	{  3,  4, 10, 12, 13,  2,  7, 14,  6,  5,  9,  0, 11, 15,  8,  1 },
+	{ 10,  7, 12,  9, 14,  3, 13, 15,  4,  0, 11,  2,  5,  8,  1,  6 },
+	{ 12, 13,  9, 11, 15, 10, 14,  8,  7,  2,  5,  3,  0,  1,  6,  4 },
+	{  9, 14, 11,  5,  8, 12, 15,  1, 13,  3,  0, 10,  2,  6,  4,  7 },
+	{ 11, 15,  5,  0,  1,  9,  8,  6, 14, 10,  2, 12,  3,  4,  7, 13 }
+};
+
+/**
+ * Initialize context before calculating hash.
+ *
+ * @param ctx context to initialize
+ */
+void rhash_blake3_init(blake3_ctx *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+#define G(a, b, c, d, x, y) { \
+	a += b + (x); d = ROTR32(d ^ a, 16); \
+	c += d;       b = ROTR32(b ^ c, 12); \
+	a += b + (y); d = ROTR32(d ^ a, 8); \
+	c += d;       b = ROTR32(b ^ c, 7); }
+
+#define ROUND(r) { \
+	const unsigned char* s = blake3_schedule[r]; \
+	G(v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]); \
+	G(v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]); \
+	G(v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]); \
+	G(v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]); \
+	G(v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]); \
+	G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]); \
+	G(v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]); \
+	G(v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]); }
+
+/**
+ * The compression function. Process a 512-bit block.
+ *
+ * @param cv the chaining value, replaced by the first 8 words of the output
+ * @param block the message block to process
+ * @param counter index of the chunk
+ * @param block_len number of message bytes in the block
+ * @param flags domain separation flags
+ */
+static void rhash_blake3_compress(unsigned cv[8], const unsigned block[16], uint64_t counter, unsigned block_len, unsigned flags)
+{
+	unsigned m[16], v[16];
+	int i;
+
+	for (i = 0; i < 16; i++)
+		m[i] = le2me_32(block[i]);
+	for (i = 0; i < 8; i++)
+		v[i] = cv[i];
+	v[8] = blake3_IV[0];
+	v[9] = blake3_IV[1];
+	v[10] = blake3_IV[2];
+	v[11] = blake3_IV[3];
+	v[12] = (unsigned)counter;
+	v[13] = (unsigned)(counter >> 32);
+	v[14] = block_len;
+	v[15] = flags;
+
+	for (i = 0; i < 7; i++)
+		ROUND(i);
+
+	for (i = 0; i < 8; i++)
+		cv[i] = v[i] ^ v[i + 8];
+}
+
+/**
+ * Calculate chaining values of the given number of whole chunks.
+ *
+ * @param msg the chunks to hash
+ * @param count number of chunks
+ * @param counter index of the first chunk
+ * @param cvs the chaining values of the chunks
+ */
+static void rhash_blake3_hash_chunks_soft(const unsigned char* msg, size_t count, uint64_t counter, unsigned cvs[][8])
+{
+	unsigned block[16];
+	size_t i;
+	unsigned j;
+
+	for (i = 0; i < count; i++, counter++) {
+		memcpy(cvs[i], blake3_IV, sizeof(blake3_IV));
+		for (j = 0; j < 16; j++, msg += blake3_block_size) {
+			unsigned flags = (j == 0 ? CHUNK_START : j == 15 ? CHUNK_END : 0);
+			memcpy(block, msg, blake3_block_size);
+			rhash_blake3_compress(cvs[i], block, counter, blake3_block_size, flags);
+		}
+	}
+}
+
+#if defined(HAS_INTEL_AVX2)
+#include <immintrin.h>
+
+#define B3_ROTR16(x) _mm256_shuffle_epi8((x), _mm256_set_epi8( \
+	13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2, \
+	13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2))
+#define B3_ROTR8(x) _mm256_shuffle_epi8((x), _mm256_set_epi8( \
+	12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1, \
+	12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1))
+#define B3_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define B3_ADD(a, b) _mm256_add_epi32((a), (b))
+#define B3_XOR(a, b) _mm256_xor_si256((a), (b))
+
+#define G8(a, b, c, d, x, y) { \
+	a = B3_ADD(B3_ADD(a, b), (x)); d = B3_ROTR16(B3_XOR(d, a)); \
+	c = B3_ADD(c, d);              b = B3_ROTR(B3_XOR(b, c), 12); \
+	a = B3_ADD(B3_ADD(a, b), (y)); d = B3_ROTR8(B3_XOR(d, a)); \
+	c = B3_ADD(c, d);              b = B3_ROTR(B3_XOR(b, c), 7); }
+
+#define ROUND8(r) { \
+	const unsigned char* s = blake3_schedule[r]; \
+	G8(v[0], v[4], v[ 8], v[12], m[s[ 0]], m[s[ 1]]); \
+	G8(v[1], v[5], v[ 9], v[13], m[s[ 2]], m[s[ 3]]); \
+	G8(v[2], v[6], v[10], v[14], m[s[ 4]], m[s[ 5]]); \
+	G8(v[3], v[7], v[11], v[15], m[s[ 6]], m[s[ 7]]); \
+	G8(v[0], v[5], v[10], v[15], m[s[ 8]], m[s[ 9]]); \
+	G8(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]); \
+	G8(v[2], v[7], v[ 8], v[13], m[s[12]], m[s[13]]); \
+	G8(v[3], v[4], v[ 9], v[14], m[s[14]], m[s[15]]); }
+
+/**
+ * Transpose 8x8 matrix of 32-bit words.
+ *
+ * @param x the rows of the matrix
+ */
+__attribute__((target("avx2")))
+static void blake3_transpose8(__m256i x[8])
+{
+	__m256i ab_0145 = _mm256_unpacklo_epi32(x[0], x[1]);
+	__m256i ab_2367 = _mm256_unpackhi_epi32(x[0], x[1]);
+	__m256i cd_0145 = _mm256_unpacklo_epi32(x[2], x[3]);
+	__m256i cd_2367 = _mm256_unpackhi_epi32(x[2], x[3]);
+	__m256i ef_0145 = _mm256_unpacklo_epi32(x[4], x[5]);
+	__m256i ef_2367 = _mm256_unpackhi_epi32(x[4], x[5]);
+	__m256i gh_0145 = _mm256_unpacklo_epi32(x[6], x[7]);
+	__m256i gh_2367 = _mm256_unpackhi_epi32(x[6], x[7]);
+	__m256i abcd_04 = _mm256_unpacklo_epi64(ab_0145, cd_0145);
+	__m256i abcd_15 = _mm256_unpackhi_epi64(ab_0145, cd_0145);
+	__m256i abcd_26 = _mm256_unpacklo_epi64(ab_2367, cd_2367);
+	__m256i abcd_37 = _mm256_unpackhi_epi64(ab_2367, cd_2367);
+	__m256i efgh_04 = _mm256_unpacklo_epi64(ef_0145, gh_0145);
+	__m256i efgh_15 = _mm256_unpackhi_epi64(ef_0145, gh_0145);
+	__m256i efgh_26 = _mm256_unpacklo_epi64(ef_2367, gh_2367);
+	__m256i efgh_37 = _mm256_unpackhi_epi64(ef_2367, gh_2367);
+	x[0] = _mm256_permute2x128_si256(abcd_04, efgh_04, 0x20);
+	x[1] = _mm256_permute2x128_si256(abcd_15, efgh_15, 0x20);
+	x[2] = _mm256_permute2x128_si256(abcd_26, efgh_26, 0x20);
+	x[3] = _mm256_permute2x128_si256(abcd_37, efgh_37, 0x20);
+	x[4] = _mm256_permute2x128_si256(abcd_04, efgh_04, 0x31);
+	x[5] = _mm256_permute2x128_si256(abcd_15, efgh_15, 0x31);
+	x[6] = _mm256_permute2x128_si256(abcd_26, efgh_26, 0x31);
+	x[7] = _mm256_permute2x128_si256(abcd_37, efgh_37, 0x31);
+}
+
+/**
+ * Calculate chaining values of the given number of whole chunks,
+ * processing 8 chunks at once, one chunk per 32-bit lane of AVX2 registers.
+ * Unused lanes of the last group hash a dummy chunk.
+ *
+ * @param msg the chunks to hash
+ * @param count number of chunks
+ * @param counter index of the first chunk
+ * @param cvs the chaining values of the chunks
+ */
+__attribute__((target("avx2")))
+static void rhash_blake3_hash_chunks_avx2(const unsigned char* msg, size_t count, uint64_t counter, unsigned cvs[][8])
+{
+	static const unsigned char zero_chunk[blake3_chunk_size];
+	unsigned out[8][8];
+
+	if (count == 1) {
+		/* a single chunk is hashed faster without SIMD lanes */
+		rhash_blake3_hash_chunks_soft(msg, count, counter, cvs);
+		return;
+	}
+	for (; count > 0; counter += 8, msg += 8 * blake3_chunk_size, cvs += 8) {
+		const unsigned char* chunks[8];
+		__m256i h[8], m[16], v[16];
+		__m256i counter_lo = _mm256_setr_epi32(
+			(int)counter, (int)(counter + 1), (int)(counter + 2), (int)(counter + 3),
+			(int)(counter + 4), (int)(counter + 5), (int)(counter + 6), (int)(counter + 7));
+		__m256i counter_hi = _mm256_setr_epi32(
+			(int)(counter >> 32), (int)((counter + 1) >> 32), (int)((counter + 2) >> 32), (int)((counter + 3) >> 32),
+			(int)((counter + 4) >> 32), (int)((counter + 5) >> 32), (int)((counter + 6) >> 32), (int)((counter + 7) >> 32));
+		size_t n = (count < 8 ? count : 8);
+		unsigned i, j;
+
+		for (i = 0; i < 8; i++)
+			chunks[i] = (i < n ? msg + i * blake3_chunk_size : zero_chunk);
+		for (i = 0; i < 8; i++)
+			h[i] = _mm256_set1_epi32((int)blake3_IV[i]);
+		for (j = 0; j < 16; j++) {
+			size_t offset = j * blake3_block_size;
+			int flags = (j == 0 ? CHUNK_START : j == 15 ? CHUNK_END : 0);
+
+			/* load the j-th block of every chunk and transpose words to lanes */
+			for (i = 0; i < 8; i++) {
+				m[i] = _mm256_loadu_si256((const __m256i*)(chunks[i] + offset));
+				m[i + 8] = _mm256_loadu_si256((const __m256i*)(chunks[i] + offset + 32));
+			}
+			blake3_transpose8(m);
+			blake3_transpose8(m + 8);
+
+			for (i = 0; i < 8; i++)
+				v[i] = h[i];
+			v[8] = _mm256_set1_epi32((int)blake3_IV[0]);
+			v[9] = _mm256_set1_epi32((int)blake3_IV[1]);
+			v[10] = _mm256_set1_epi32((int)blake3_IV[2]);
+			v[11] = _mm256_set1_epi32((int)blake3_IV[3]);
+			v[12] = counter_lo;
+			v[13] = counter_hi;
+			v[14] = _mm256_set1_epi32(blake3_block_size);
+			v[15] = _mm256_set1_epi32(flags);
+
+			ROUND8(0);
+			ROUND8(1);
+			ROUND8(2);
+			ROUND8(3);
+			ROUND8(4);
+			ROUND8(5);
+			ROUND8(6);
+
+			for (i = 0; i < 8; i++)
+				h[i] = B3_XOR(v[i], v[i + 8]);
+		}
+
+		/* transpose lanes back to the chaining values of chunks */
+		blake3_transpose8(h);
+		for (i = 0; i < 8; i++)
+			_mm256_storeu_si256((__m256i*)out[i], h[i]);
+		memcpy(cvs, out, n * sizeof(out[0]));
+		count -= n;
+	}
+}
+
+static void rhash_blake3_hash_chunks_choose_best(const unsigned char* msg, size_t count, uint64_t counter, unsigned cvs[][8]);
+static void (*rhash_blake3_hash_chunks)(const unsigned char* msg, size_t count, uint64_t counter, unsigned cvs[][8]) = rhash_blake3_hash_chunks_choose_best;
+
+static void rhash_blake3_hash_chunks_choose_best(const unsigned char* msg, size_t count, uint64_t counter, unsigned cvs[][8])
+{
+	rhash_blake3_hash_chunks = (has_cpu_feature(CPU_FEATURE_AVX2) ?
+		rhash_blake3_hash_chunks_avx2 : rhash_blake3_hash_chunks_soft);
+	rhash_blake3_hash_chunks(msg, count, counter, cvs);
+}
+#else
+# define rhash_blake3_hash_chunks rhash_blake3_hash_chunks_soft
+#endif /* HAS_INTEL_AVX2 */
+
+/**
+ * Add the chaining value of a complete chunk to the tree, merging
+ * complete subtrees of equal size.
+ *
+ * The stack keeps chaining values in little-endian byte order, like message blocks.
+ *
+ * @param ctx the algorithm context
+ * @param cv the chaining value of the chunk
+ * @param total_chunks number of chunks hashed including this one
+ */
+static void rhash_blake3_add_chunk_cv(blake3_ctx *ctx, const unsigned cv[8], uint64_t total_chunks)
+{
+	unsigned block[16], parent_cv[8];
+	le32_copy(block + 8, 0, cv, 32);
+
+	/* every trailing zero bit of total_chunks means a completed subtree */
+	while ((total_chunks & 1) == 0) {
+		memcpy(block, ctx->stack[--ctx->stack_size], 32);
+		memcpy(parent_cv, blake3_IV, sizeof(blake3_IV));
+		rhash_blake3_compress(parent_cv, block, 0, blake3_block_size, PARENT);
+		le32_copy(block + 8, 0, parent_cv, 32);
+		total_chunks >>= 1;
+	}
+	memcpy(ctx->stack[ctx->stack_size++], block + 8, 32);
+}
+
+/**
+ * Process a message block, which is not the last block of the message.
+ *
+ * @param ctx the algorithm context, its length includes the block
+ * @param block the message block to process
+ */
+static void rhash_blake3_process_block(blake3_ctx *ctx, const unsigned block[16])
+{
+	uint64_t index = (ctx->length - 1) >> 6; /* index of the block in the message */
+	unsigned flags = 0;
+
+	if ((index & 15) == 0) {
+		memcpy(ctx->chunk_cv, blake3_IV, sizeof(blake3_IV));
+		flags = CHUNK_START;
+	}
+	if ((index & 15) == 15) {
+		flags |= CHUNK_END;
+		rhash_blake3_compress(ctx->chunk_cv, block, index >> 4, blake3_block_size, flags);
+		rhash_blake3_add_chunk_cv(ctx, ctx->chunk_cv, (index >> 4) + 1);
+		return;
+	}
+	rhash_blake3_compress(ctx->chunk_cv, block, index >> 4, blake3_block_size, flags);
+}
+
+/* the maximal number of subtrees hashed by one call of the thread pool */
+#define BLAKE3_MAX_JOBS 64
+/* the minimal number of chunks per thread to start multi-threaded hashing */
+#define BLAKE3_MIN_THREAD_CHUNKS 16
+
+/**
+ * A complete subtree of chunks, hashed by a thread.
+ */
+struct blake3_job
+{
+	const unsigned char* msg;
+	uint64_t counter;
+	unsigned level;
+	unsigned cv[8];
+};
+
+/**
+ * Calculate the chaining value of a subtree of 2^level chunks.
+ *
+ * @param data array of blake3_job structures
+ * @param index index of the job to process
+ */
+static void rhash_blake3_subtree_job(void* data, unsigned index)
+{
+	struct blake3_job* job = (struct blake3_job*)data + index;
+	uint64_t count = (uint64_t)1 << job->level;
+	uint64_t i;
+	unsigned cvs[8][8];
+	blake3_ctx ctx;
+
+	ctx.stack_size = 0;
+	for (i = 0; i < count; i += 8) {
+		size_t n = (count - i < 8 ? (size_t)(count - i) : 8);
+		size_t j;
+		rhash_blake3_hash_chunks(job->msg + (size_t)i * blake3_chunk_size, n, job->counter + i, cvs);
+		for (j = 0; j < n; j++)
+			rhash_blake3_add_chunk_cv(&ctx, cvs[j], i + j + 1);
+	}
+	/* the stack contains the only chaining value in little-endian byte order */
+	le32_copy(job->cv, 0, ctx.stack[0], 32);
+}
+
+/**
+ * Hash whole chunks, splitting them between threads of the pool.
+ * Every thread hashes complete subtrees of chunks, which are merged
+ * into the tree in the message order.
+ *
+ * @param ctx the algorithm context, its length must be a multiple of the chunk size
+ * @param msg the chunks to hash
+ * @param chunks number of chunks
+ * @param pool the thread pool
+ */
+static void rhash_blake3_hash_subtrees(blake3_ctx *ctx, const unsigned char* msg, uint64_t chunks, rhash_thread_pool* pool)
+{
+	struct blake3_job jobs[BLAKE3_MAX_JOBS];
+	unsigned threads = rhash_thread_pool_size(pool);
+	uint64_t max_chunks, chunk_index;
+	unsigned count, i;
+
+	/* give about four subtrees to every thread */
+	for (max_chunks = 1; max_chunks * 2 <= chunks / (threads * 4); max_chunks <<= 1);
+
+	while (chunks > 0) {
+		chunk_index = ctx->length >> 10;
+		for (count = 0; count < BLAKE3_MAX_JOBS && chunks > 0; count++) {
+			unsigned level = 0;
+			/* a subtree of 2^level chunks must start at a multiple of 2^level */
+			while (((uint64_t)2 << level) <= max_chunks && ((uint64_t)2 << level) <= chunks &&
+					(chunk_index & (((uint64_t)2 << level) - 1)) == 0)
+				level++;
+			jobs[count].msg = msg;
+			jobs[count].counter = chunk_index;
+			jobs[count].level = level;
+			msg += (size_t)blake3_chunk_size << level;
+			chunk_index += (uint64_t)1 << level;
+			chunks -= (uint64_t)1 << level;
+		}
+		rhash_thread_pool_run(pool, rhash_blake3_subtree_job, jobs, count);
+		for (i = 0; i < count; i++) {
+			ctx->length += (uint64_t)blake3_chunk_size << jobs[i].level;
+			rhash_blake3_add_chunk_cv(ctx, jobs[i].cv, (ctx->length >> 10) >> jobs[i].level);
+		}
+	}
+}
+
+/**
+ * Hash a message chunk, splitting whole chunks between threads of the pool,
+ * if the pool is not NULL.
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+static void rhash_blake3_update_pool(blake3_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool)
+{
+	if (size == 0)
+		return;
+
+	/* the last block is processed by final, so a full block can be kept buffered */
+	if (ctx->length > 0) {
+		size_t index = (((size_t)ctx->length - 1) & 63) + 1;
+		size_t left = blake3_block_size - index;
+		if (left > 0) {
+			if (size < left) left = size;
+			memcpy((char*)ctx->message + index, msg, left);
+			ctx->length += left;
+			msg  += left;
+			size -= left;
+			if (size == 0)
+				return;
+		}
+		rhash_blake3_process_block(ctx, ctx->message);
+	}
+
+	/* hash whole chunks at once, keeping the last chunk for final */
+	if (((size_t)ctx->length & (blake3_chunk_size - 1)) == 0) {
+		unsigned cvs[8][8];
+		if (pool && size > blake3_chunk_size) {
+			size_t count = (size - 1) / blake3_chunk_size;
+			rhash_blake3_hash_subtrees(ctx, msg, count, pool);
+			msg  += count * blake3_chunk_size;
+			size -= count * blake3_chunk_size;
+		}
+		while (size > blake3_chunk_size) {
+			size_t count = (size - 1) / blake3_chunk_size;
+			size_t i;
+			if (count > 8) count = 8;
+			rhash_blake3_hash_chunks(msg, count, ctx->length >> 10, cvs);
+			for (i = 0; i < count; i++) {
+				ctx->length += blake3_chunk_size;
+				rhash_blake3_add_chunk_cv(ctx, cvs[i], ctx->length >> 10);
+			}
+			msg  += count * blake3_chunk_size;
+			size -= count * blake3_chunk_size;
+		}
+	}
+
+	while (size > blake3_block_size) {
+		ctx->length += blake3_block_size;
+		if (IS_ALIGNED_32(msg)) {
+			rhash_blake3_process_block(ctx, (const unsigned*)msg);
+		} else {
+			memcpy(ctx->message, msg, blake3_block_size);
+			rhash_blake3_process_block(ctx, ctx->message);
+		}
+		msg  += blake3_block_size;
+		size -= blake3_block_size;
+	}
+	memcpy(ctx->message, msg, size);
+	ctx->length += size;
+}
+
+/**
+ * Calculate message hash.
+ * Can be called repeatedly with chunks of the message to be hashed.
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ */
+void rhash_blake3_update(blake3_ctx *ctx, const unsigned char* msg, size_t size)
+{
+	rhash_blake3_update_pool(ctx, msg, size, NULL);
+}
+
+/**
+ * Calculate message hash, splitting whole chunks of the message between
+ * threads. The result is the same as of rhash_blake3_update().
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+void rhash_blake3_update_mt(blake3_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool)
+{
+	unsigned threads = rhash_thread_pool_size(pool);
+	size_t rest = (size_t)(0 - ctx->length) & (blake3_chunk_size - 1);
+
+	if (threads < 2 || size <= rest ||
+			(size - rest) / blake3_chunk_size < (size_t)threads * BLAKE3_MIN_THREAD_CHUNKS) {
+		rhash_blake3_update(ctx, msg, size);
+		return;
+	}
+	/* finish the current chunk, so whole chunks start at a chunk boundary */
+	rhash_blake3_update(ctx, msg, rest);
+	rhash_blake3_update_pool(ctx, msg + rest, size - rest, pool);
+}
+
+/**
+ * Store calculated hash into the given array.
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param result calculated hash in binary form
+ */
+void rhash_blake3_final(blake3_ctx *ctx, unsigned char* result)
+{
+	size_t index = (ctx->length > 0 ? (((size_t)ctx->length - 1) & 63) + 1 : 0);
+	uint64_t block_index = (ctx->length > 0 ? (ctx->length - 1) >> 6 : 0);
+	unsigned flags = CHUNK_END;
+	unsigned block[16];
+	unsigned i;
+
+	/* pad the last block with zeros */
+	memset((char*)ctx->message + index, 0, blake3_block_size - index);
+	if ((block_index & 15) == 0) {
+		memcpy(ctx->chunk_cv, blake3_IV, sizeof(blake3_IV));
+		flags |= CHUNK_START;
+	}
+	memcpy(ctx->hash, ctx->chunk_cv, 32);
+	rhash_blake3_compress(ctx->hash, ctx->message, block_index >> 4, (unsigned)index,
+		flags | (ctx->stack_size == 0 ? ROOT : 0));
+
+	/* merge the last chunk with the complete subtrees from right to left */
+	for (i = ctx->stack_size; i > 0; i--) {
+		memcpy(block, ctx->stack[i - 1], 32);
+		le32_copy(block + 8, 0, ctx->hash, 32);
+		memcpy(ctx->hash, blake3_IV, sizeof(blake3_IV));
+		rhash_blake3_compress(ctx->hash, block, 0, blake3_block_size, PARENT | (i == 1 ? ROOT : 0));
+	}
+
+	if (result) le32_copy(result, 0, ctx->hash, blake3_hash_size);
+}
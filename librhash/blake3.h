@@ -0,0 +1,37 @@
+/* blake3.h BLAKE3 hash function */
+#ifndef BLAKE3_H
+#define BLAKE3_H
+#include "ustd.h"
+#include "thread_pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define blake3_block_size 64
+#define blake3_chunk_size 1024
+#define blake3_hash_size  32
+/* the maximal depth of the tree of chunks, enough for 2^64 bytes */
+#define blake3_max_depth  54
+
+/* algorithm context */
+typedef struct blake3_ctx
+{
+	unsigned hash[8];       /* 256-bit message digest, set by final */
+	unsigned chunk_cv[8];   /* chaining value of the current chunk */
+	unsigned message[16];   /* 512-bit buffer for leftovers */
+	uint64_t length;        /* number of processed bytes */
+	unsigned stack_size;    /* number of chaining values in the stack */
+	unsigned stack[blake3_max_depth][8]; /* chaining values of complete subtrees */
+} blake3_ctx;
+
+void rhash_blake3_init(blake3_ctx *ctx);
+void rhash_blake3_update(blake3_ctx *ctx, const unsigned char* data, size_t length);
+void rhash_blake3_update_mt(blake3_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool);
+void rhash_blake3_final(blake3_ctx *ctx, unsigned char* result);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* BLAKE3_H */
@@ -154,20 +154,48 @@ void rhash_u32_mem_swap(unsigned *arr, int length)
 #ifdef HAS_INTEL_CPUID
 #include <cpuid.h>
 
-static uint64_t get_cpuid_features(void)
+/* cpuid(1).ecx bits: OSXSAVE and AVX */
+#define CPU_OSXSAVE_AVX ((((uint64_t)1) << 59) | (((uint64_t)1) << 60))
+
+static void get_cpuid_features(uint64_t features[2])
 {
-	uint32_t tmp, edx, ecx;
+	uint32_t tmp, ebx, ecx, edx;
 	if (__get_cpuid(1, &tmp, &tmp, &ecx, &edx))
-		return ((((uint64_t)ecx) << 32) ^ edx);
-	return 0;
+		features[0] = ((((uint64_t)ecx) << 32) ^ edx);
+	if (__get_cpuid_max(0, 0) >= 7) {
+		__cpuid_count(7, 0, tmp, ebx, ecx, edx);
+		features[1] = ebx;
+	}
+	/* AVX2 can be used only if the OS saves XMM and YMM registers state */
+	if ((features[0] & CPU_OSXSAVE_AVX) == CPU_OSXSAVE_AVX) {
+		uint32_t xcr0;
+		__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0), "=d"(edx) : "c"(0)); /* xgetbv */
+		if ((xcr0 & 6) == 6)
+			return;
+	}
+	features[1] &= ~(((uint64_t)1) << (CPU_FEATURE_AVX2 - 64));
+}
+
+int has_cpu_feature(unsigned feature_bit)
+{
+	static uint64_t features[2];
+	const uint64_t feature = ((uint64_t)1) << (feature_bit & 63);
+	if (!features[0]) {
+		uint64_t detected[2] = { 0, 0 };
+		get_cpuid_features(detected);
+		features[1] = detected[1];
+		features[0] = (detected[0] | 1);
+	}
+	return !!(features[feature_bit >> 6] & feature);
 }
+#elif defined(HAS_ARM_HWCAP)
+#include <sys/auxv.h>
 
 int has_cpu_feature(unsigned feature_bit)
 {
-	static uint64_t features;
-	const uint64_t feature = ((uint64_t)1) << feature_bit;
-	if (!features)
-		features = (get_cpuid_features() | 1);
-	return !!(features & feature);
+	static unsigned long hwcap;
+	if (!hwcap)
+		hwcap = (getauxval(AT_HWCAP) | ((unsigned long)1 << 63));
+	return !!(hwcap & ((unsigned long)1 << feature_bit));
 }
 #endif
@@ -189,12 +189,33 @@ static RHASH_INLINE uint64_t bswap_64(uint64_t x)
 #define ROTL64(qword, n) ((qword) << (n) ^ ((qword) >> (64 - (n))))
 #define ROTR64(qword, n) ((qword) >> (n) ^ ((qword) << (64 - (n))))
 
+/* x86 features: bits 0-31 are cpuid(1).edx, bits 32-63 are cpuid(1).ecx,
+ * bits 64-95 are cpuid(7).ebx */
+#define CPU_FEATURE_PCLMULQDQ (33)
+#define CPU_FEATURE_SSSE3  (41)
+#define CPU_FEATURE_SSE4_1 (51)
 #define CPU_FEATURE_SSE4_2 (52)
+#define CPU_FEATURE_AVX2   (69) /* reported only if the OS saves AVX registers */
+#define CPU_FEATURE_SHA    (93)
+
+/* aarch64 features are bits of the Linux AT_HWCAP auxiliary vector entry */
+#define CPU_FEATURE_ARM_SHA1 (5)
+#define CPU_FEATURE_ARM_SHA2 (6)
 
 #if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3)) \
 	&& (defined(CPU_X64) || defined(CPU_IA32))
 # define HAS_INTEL_CPUID
 int has_cpu_feature(unsigned feature_bit);
+/* compiler supports SHA, PCLMULQDQ and AVX2 intrinsics in functions with target attribute */
+# if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#  define HAS_INTEL_SHA_NI
+#  define HAS_INTEL_PCLMUL
+#  define HAS_INTEL_AVX2
+# endif
+#elif defined(__aarch64__) && defined(__linux__) && (defined(__clang__) || __GNUC__ >= 8)
+# define HAS_ARM_HWCAP
+# define HAS_ARM_SHA
+int has_cpu_feature(unsigned feature_bit);
 #else
 # define has_cpu_feature(x) (0)
 #endif
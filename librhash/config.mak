@@ -0,0 +1,40 @@
+# -------- Generated by configure -----------
+
+DESTDIR ?=
+INCDIR  = $(DESTDIR)/usr/local/include
+LIBDIR  = $(DESTDIR)/usr/local/lib
+SO_DIR  = $(DESTDIR)/usr/local/lib
+
+AR      = ar
+CC      = cc
+INSTALL = install
+
+LIBRHASH_STATIC  = librhash.a
+LIBRHASH_SHARED  = librhash.so.0
+LIBRHASH_SOLINK  = librhash.so
+LIBRHASH_DEF     = librhash.def
+LIBRHASH_IMPLIB  = librhash.so.0.a
+EXPORTS_FILE     = exports.sym
+RM_FILES         = exports.sym librhash.so
+BUILD_TYPE       = shared
+EXEC_EXT         = 
+LEGACY_HEADERS   = rhash_timing.h
+
+EXPORTS_TARGET   = exports.sym
+BUILD_TARGETS    = librhash.so.0
+TEST_TARGETS     = test-shared
+SOLINK_TARGET    = librhash.so
+EXTRA_INSTALL_LIBSHARED   = 
+EXTRA_UNINSTALL_LIBSHARED = 
+
+OPTFLAGS    = -O2 -pipe -DNDEBUG -fomit-frame-pointer -ffunction-sections -fdata-sections
+OPTLDFLAGS  = 
+WARN_CFLAGS = -Wall -W -Wstrict-prototypes -Wnested-externs -Winline -Wpointer-arith -Wbad-function-cast -Wmissing-prototypes -Wmissing-declarations -Wdeclaration-after-statement
+ADDCFLAGS   = 
+ADDLDFLAGS  = 
+CFLAGS  = -DOPENSSL_RUNTIME -DUSE_PTHREADS $(OPTFLAGS) $(WARN_CFLAGS) $(ADDCFLAGS)
+LDFLAGS = $(OPTLDFLAGS) $(ADDLDFLAGS) -pthread
+SHARED_CFLAGS  = $(CFLAGS) -fpic
+SHARED_LDFLAGS = $(LDFLAGS) -shared -Wl,--version-script,exports.sym,-soname,$(LIBRHASH_SHARED)
+BIN_STATIC_LDFLAGS = $(LDFLAGS) -static
+
@@ -58,6 +58,68 @@ static unsigned calculate_crc_soft(unsigned crcinit, unsigned table[8][256], con
 		crc = table[0][(crc & 0xFF) ^ *msg++] ^ (crc >> 8);
 	return ~crc;
 }
+
+#ifdef HAS_INTEL_PCLMUL
+#include <wmmintrin.h>
+
+/* minimal message size to be processed by carry-less multiplication */
+#define PCLMUL_MIN_SIZE 64
+
+/* fold 128-bit value x forward and add the next 128 bits of data */
+#define CRC_FOLD(x, data, k) _mm_xor_si128(_mm_xor_si128( \
+	_mm_clmulepi64_si128((x), (k), 0x00), _mm_clmulepi64_si128((x), (k), 0x11)), (data))
+#define CRC_LOAD(msg) _mm_loadu_si128((const __m128i*)(msg))
+
+/**
+ * Calculate CRC sum by folding the message with carry-less multiplication,
+ * as described in the Intel paper "Fast CRC Computation for Generic
+ * Polynomials Using PCLMULQDQ Instruction". The folded remainder and
+ * the message tail are processed by the table.
+ *
+ * @param crcinit intermediate CRC hash result
+ * @param table CRC table of the polynomial
+ * @param msg the message to process, at least PCLMUL_MIN_SIZE bytes long
+ * @param size the length of the message
+ * @param k folding constants: bit-reflected x^(512+32), x^(512-32),
+ *          x^(128+32) and x^(128-32) modulo the polynomial, shifted left by 1
+ * @return updated CRC hash sum
+ */
+__attribute__((target("pclmul,sse2")))
+static unsigned calculate_crc_pclmul(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size, const uint64_t k[4])
+{
+	unsigned char folded[16];
+	__m128i x0, x1, x2, x3, k1k2, k3k4;
+
+	x0 = _mm_xor_si128(CRC_LOAD(msg), _mm_cvtsi32_si128((int)~crcinit));
+	x1 = CRC_LOAD(msg + 16);
+	x2 = CRC_LOAD(msg + 32);
+	x3 = CRC_LOAD(msg + 48);
+	msg += 64;
+	size -= 64;
+
+	/* fold four 128-bit values at once */
+	k1k2 = _mm_set_epi64x((long long)k[1], (long long)k[0]);
+	for (; size >= 64; msg += 64, size -= 64) {
+		x0 = CRC_FOLD(x0, CRC_LOAD(msg), k1k2);
+		x1 = CRC_FOLD(x1, CRC_LOAD(msg + 16), k1k2);
+		x2 = CRC_FOLD(x2, CRC_LOAD(msg + 32), k1k2);
+		x3 = CRC_FOLD(x3, CRC_LOAD(msg + 48), k1k2);
+	}
+
+	/* fold into a single 128-bit value */
+	k3k4 = _mm_set_epi64x((long long)k[3], (long long)k[2]);
+	x0 = CRC_FOLD(x0, x1, k3k4);
+	x0 = CRC_FOLD(x0, x2, k3k4);
+	x0 = CRC_FOLD(x0, x3, k3k4);
+	for (; size >= 16; msg += 16, size -= 16)
+		x0 = CRC_FOLD(x0, CRC_LOAD(msg), k3k4);
+
+	/* the folded value has the same remainder, as the processed message */
+	_mm_storeu_si128((__m128i*)folded, x0);
+	crcinit = calculate_crc_soft(0xFFFFFFFF, table, folded, 16);
+	return calculate_crc_soft(crcinit, table, msg, size);
+}
+#endif /* HAS_INTEL_PCLMUL */
 #else
 typedef int dummy_declaration_required_by_strict_iso_c;
 #endif
@@ -329,6 +391,28 @@ unsigned rhash_crc32_table[8][256] = { {
 	0x2c8e0fff, 0xe0240f61, 0x6eab0882, 0xa201081c, 0xa8c40105, 0x646e019b, 0xeae10678, 0x264b06e6
 } };
 
+#ifdef HAS_INTEL_PCLMUL
+static unsigned calculate_crc32_choose_best(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size);
+static unsigned (*calculate_crc32_p)(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size) = calculate_crc32_choose_best;
+
+static unsigned calculate_crc32_pclmul(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size)
+{
+	static const uint64_t k[4] = { 0x154442bd4, 0x1c6e41596, 0x1751997d0, 0x0ccaa009e };
+	if (size < PCLMUL_MIN_SIZE)
+		return calculate_crc_soft(crcinit, table, msg, size);
+	return calculate_crc_pclmul(crcinit, table, msg, size, k);
+}
+
+static unsigned calculate_crc32_choose_best(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size)
+{
+	calculate_crc32_p = (has_cpu_feature(CPU_FEATURE_PCLMULQDQ) ?
+		calculate_crc32_pclmul : calculate_crc_soft);
+	return calculate_crc32_p(crcinit, table, msg, size);
+}
+#else
+# define calculate_crc32_p calculate_crc_soft
+#endif
+
 /**
  * Calculate CRC32 sum of a given message.
  *
@@ -339,7 +423,7 @@ unsigned rhash_crc32_table[8][256] = { {
  */
 unsigned rhash_get_crc32(unsigned crcinit, const unsigned char *msg, size_t size)
 {
-	return calculate_crc_soft(crcinit, rhash_crc32_table, msg, size);
+	return calculate_crc32_p(crcinit, rhash_crc32_table, msg, size);
 }
 
 #endif /* DISABLE_CRC32 */
@@ -615,12 +699,19 @@ unsigned rhash_crc32c_table[8][256] = { {
 #ifdef HAS_INTEL_CPUID
 static unsigned calculate_crc32c_choose_best(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size);
 static unsigned calculate_crc32c_sse42(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size);
+#ifdef HAS_INTEL_PCLMUL
+static unsigned calculate_crc32c_pclmul(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size);
+#endif
 static unsigned (*calculate_crc32c_p)(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size) = calculate_crc32c_choose_best;
 
 static unsigned calculate_crc32c_choose_best(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size)
 {
 	calculate_crc32c_p = (has_cpu_feature(CPU_FEATURE_SSE4_2) ?
 		calculate_crc32c_sse42 : calculate_crc_soft);
+#ifdef HAS_INTEL_PCLMUL
+	if (has_cpu_feature(CPU_FEATURE_SSE4_2) && has_cpu_feature(CPU_FEATURE_PCLMULQDQ))
+		calculate_crc32c_p = calculate_crc32c_pclmul;
+#endif
 	return calculate_crc32c_p(crcinit, table, msg, size);
 }
 
@@ -657,6 +748,17 @@ static unsigned calculate_crc32c_sse42(unsigned crcinit, unsigned table[8][256],
 		CRC32C_U8(crc, *msg);
 	return ~crc;
 }
+
+#ifdef HAS_INTEL_PCLMUL
+static unsigned calculate_crc32c_pclmul(unsigned crcinit, unsigned table[8][256], const unsigned char *msg, size_t size)
+{
+	static const uint64_t k[4] = { 0x740eef02, 0x9e4addf8, 0xf20c0dfe, 0x14cd00bd6 };
+	/* the crc32 instruction is faster for short messages */
+	if (size < 256)
+		return calculate_crc32c_sse42(crcinit, table, msg, size);
+	return calculate_crc_pclmul(crcinit, table, msg, size, k);
+}
+#endif
 #else
 # define calculate_crc32c_p calculate_crc_soft
 #endif
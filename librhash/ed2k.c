@@ -29,6 +29,7 @@
  */
 
 #include <string.h>
+#include "algorithms.h"
 #include "ed2k.h"
 
 /* each hashed file is divided into 9500 KiB sized chunks */
@@ -85,6 +86,58 @@ void rhash_ed2k_update(ed2k_ctx *ctx, const unsigned char* msg, size_t size)
 	}
 }
 
+/* the maximal number of chunks hashed by one call of the thread pool */
+#define ED2K_MAX_JOB_CHUNKS 64
+
+/**
+ * Calculate message hash, hashing whole ed2k chunks of the message
+ * by threads of the given pool. The chunks hashes are combined in the
+ * message order, so the result is the same as of rhash_ed2k_update().
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+void rhash_ed2k_update_mt(ed2k_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool)
+{
+	const void* messages[ED2K_MAX_JOB_CHUNKS];
+	size_t lengths[ED2K_MAX_JOB_CHUNKS];
+	unsigned char* results[ED2K_MAX_JOB_CHUNKS];
+	unsigned char hashes[ED2K_MAX_JOB_CHUNKS][16];
+	size_t chunks, count, i;
+
+	/* finish the current chunk */
+	if (ctx->md4_context_inner.length > 0 && !ctx->not_emule) {
+		size_t rest = ED2K_CHUNK_SIZE - (size_t)ctx->md4_context_inner.length;
+		if (size < rest) rest = size;
+		rhash_ed2k_update(ctx, msg, rest);
+		msg += rest;
+		size -= rest;
+	}
+	chunks = size / ED2K_CHUNK_SIZE;
+	if (rhash_thread_pool_size(pool) < 2 || chunks < 2 || ctx->not_emule) {
+		rhash_ed2k_update(ctx, msg, size);
+		return;
+	}
+
+	while (chunks > 0) {
+		count = (chunks < ED2K_MAX_JOB_CHUNKS ? chunks : ED2K_MAX_JOB_CHUNKS);
+		for (i = 0; i < count; i++) {
+			messages[i] = msg + i * ED2K_CHUNK_SIZE;
+			lengths[i] = ED2K_CHUNK_SIZE;
+			results[i] = hashes[i];
+		}
+		if (rhash_msg_batch_mt(RHASH_MD4, messages, lengths, results, count, pool) < 0)
+			break; /* hash the rest of the message in the current thread */
+		rhash_md4_update(&ctx->md4_context, hashes[0], 16 * count);
+		msg += count * ED2K_CHUNK_SIZE;
+		size -= count * ED2K_CHUNK_SIZE;
+		chunks -= count;
+	}
+	rhash_ed2k_update(ctx, msg, size);
+}
+
 /**
  * Store calculated hash into the given array.
  *
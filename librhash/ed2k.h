@@ -2,6 +2,7 @@
 #ifndef ED2K_H
 #define ED2K_H
 #include "md4.h"
+#include "thread_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +20,7 @@ typedef struct ed2k_ctx
 
 void rhash_ed2k_init(ed2k_ctx *ctx);
 void rhash_ed2k_update(ed2k_ctx *ctx, const unsigned char* msg, size_t size);
+void rhash_ed2k_update_mt(ed2k_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool);
 void rhash_ed2k_final(ed2k_ctx *ctx, unsigned char result[16]);
 
 #ifdef __cplusplus
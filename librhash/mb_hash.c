@@ -0,0 +1,721 @@
+/* mb_hash.c - multi-buffer hashing of several messages in SIMD lanes
+ *
+ * Copyright: 2026 RHash contributors
+ *
+ * Permission is hereby granted,  free of charge,  to any person  obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,  including without limitation
+ * the rights to  use, copy, modify,  merge, publish, distribute, sublicense,
+ * and/or sell copies  of  the Software,  and to permit  persons  to whom the
+ * Software is furnished to do so.
+ *
+ * This program  is  distributed  in  the  hope  that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  Use this program  at  your own risk!
+ *
+ * Several independent messages are hashed in lockstep, each message in its
+ * own lane of SIMD registers: 32-bit lanes of SSE2 registers for MD5/SHA1/
+ * SHA256 and 64-bit lanes of AVX2 registers for SHA3. When a message is
+ * finished, its lane is refilled by the next message, so all lanes are
+ * kept busy.
+ */
+
+#include <string.h>
+#include "byte_order.h"
+#include "rhash.h"
+#include "sha256.h"
+#include "sha3.h"
+#include "mb_hash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define USE_MB_SSE2
+# include <emmintrin.h>
+#endif
+#if defined(HAS_INTEL_AVX2)
+# define USE_MB_AVX2
+# include <immintrin.h>
+#endif
+
+#ifdef USE_MB_SSE2
+
+#define MB_LANES 4
+#define MB_BLOCK_SIZE 64
+#define MB_MAX_WORDS 8
+
+/* the state of all lanes, word i of lane j is stored at state[i][j] */
+typedef unsigned mb_state[MB_MAX_WORDS][MB_LANES];
+typedef void (*mb_process_t)(mb_state state, const unsigned char* blocks[MB_LANES]);
+
+/* a hash algorithm, supported by the multi-buffer engine */
+typedef struct mb_algorithm
+{
+	unsigned hash_id;
+	unsigned digest_size;
+	unsigned state_words;
+	int is_big_endian;
+	const unsigned* initial_state;
+	mb_process_t process;
+} mb_algorithm;
+
+/* a message being hashed in a lane */
+typedef struct mb_lane
+{
+	size_t index;              /* index of the message in the batch */
+	const unsigned char* data; /* the next full block of the message */
+	size_t blocks;             /* number of full message blocks left */
+	unsigned tail_blocks;      /* number of padding blocks left */
+	unsigned char* tail_pos;   /* the next padding block */
+	unsigned char tail[MB_BLOCK_SIZE * 2]; /* the padded end of the message */
+} mb_lane;
+
+#define MB_ADD(a, b) _mm_add_epi32((a), (b))
+#define MB_AND(a, b) _mm_and_si128((a), (b))
+#define MB_OR(a, b)  _mm_or_si128((a), (b))
+#define MB_XOR(a, b) _mm_xor_si128((a), (b))
+#define MB_ROTL(x, n) _mm_or_si128(_mm_slli_epi32((x), (n)), _mm_srli_epi32((x), 32 - (n)))
+#define MB_ROTR(x, n) _mm_or_si128(_mm_srli_epi32((x), (n)), _mm_slli_epi32((x), 32 - (n)))
+
+/**
+ * Load 16 message words from a block of every lane.
+ *
+ * @param W the vectors to store words into
+ * @param blocks the message blocks
+ * @param is_big_endian non-zero if the words are stored in big-endian order
+ */
+static void mb_load_words(__m128i W[16], const unsigned char* blocks[MB_LANES], int is_big_endian)
+{
+	unsigned x[MB_LANES][16];
+	unsigned i;
+	for (i = 0; i < MB_LANES; i++) {
+		if (is_big_endian)
+			be32_copy(x[i], 0, blocks[i], MB_BLOCK_SIZE);
+		else
+			le32_copy(x[i], 0, blocks[i], MB_BLOCK_SIZE);
+	}
+	for (i = 0; i < 16; i++)
+		W[i] = _mm_set_epi32((int)x[3][i], (int)x[2][i], (int)x[1][i], (int)x[0][i]);
+}
+
+#define MB_LOAD_STATE(state, i) _mm_loadu_si128((const __m128i*)(state)[i])
+#define MB_ADD_STATE(state, i, x) \
+	_mm_storeu_si128((__m128i*)(state)[i], MB_ADD(MB_LOAD_STATE(state, i), (x)))
+
+/* MD5 */
+
+static const unsigned mb_md5_initial_state[4] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+};
+
+/**
+ * Process one block of every lane by the MD5 compression function.
+ *
+ * @param state the state of all lanes
+ * @param blocks the message blocks
+ */
+static void mb_md5_process(mb_state state, const unsigned char* blocks[MB_LANES])
+{
+	static const unsigned char word_index[64] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+		1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+		5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+		0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+	};
+	static const unsigned char shifts[16] = {
+		7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+	};
+	static const unsigned T[64] = {
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+		0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+		0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+		0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+		0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+		0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+		0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+		0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+		0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+		0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+		0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+		0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+		0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+		0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+	};
+	const __m128i ones = _mm_set1_epi32(-1);
+	__m128i W[16], a, b, c, d, f;
+	unsigned i, s;
+
+	mb_load_words(W, blocks, 0);
+	a = MB_LOAD_STATE(state, 0);
+	b = MB_LOAD_STATE(state, 1);
+	c = MB_LOAD_STATE(state, 2);
+	d = MB_LOAD_STATE(state, 3);
+
+	for (i = 0; i < 64; i++) {
+		switch (i >> 4) {
+		case 0: f = MB_XOR(MB_AND(MB_XOR(c, d), b), d); break;
+		case 1: f = MB_OR(MB_AND(b, d), _mm_andnot_si128(d, c)); break;
+		case 2: f = MB_XOR(MB_XOR(b, c), d); break;
+		default: f = MB_XOR(c, MB_OR(b, MB_XOR(d, ones))); break;
+		}
+		f = MB_ADD(MB_ADD(a, f), MB_ADD(W[word_index[i]], _mm_set1_epi32((int)T[i])));
+		s = shifts[((i >> 2) & 12) | (i & 3)];
+		f = MB_OR(_mm_sll_epi32(f, _mm_cvtsi32_si128((int)s)), _mm_srl_epi32(f, _mm_cvtsi32_si128((int)(32 - s))));
+		a = d;
+		d = c;
+		c = b;
+		b = MB_ADD(b, f);
+	}
+
+	MB_ADD_STATE(state, 0, a);
+	MB_ADD_STATE(state, 1, b);
+	MB_ADD_STATE(state, 2, c);
+	MB_ADD_STATE(state, 3, d);
+}
+
+/* SHA-1 */
+
+static const unsigned mb_sha1_initial_state[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+/**
+ * Process one block of every lane by the SHA-1 compression function.
+ *
+ * @param state the state of all lanes
+ * @param blocks the message blocks
+ */
+static void mb_sha1_process(mb_state state, const unsigned char* blocks[MB_LANES])
+{
+	__m128i W[16], a, b, c, d, e, f, k, t;
+	unsigned i;
+
+	mb_load_words(W, blocks, 1);
+	a = MB_LOAD_STATE(state, 0);
+	b = MB_LOAD_STATE(state, 1);
+	c = MB_LOAD_STATE(state, 2);
+	d = MB_LOAD_STATE(state, 3);
+	e = MB_LOAD_STATE(state, 4);
+
+	for (i = 0; i < 80; i++) {
+		if (i >= 16) {
+			t = MB_XOR(MB_XOR(W[(i - 3) & 15], W[(i - 8) & 15]), MB_XOR(W[(i - 14) & 15], W[i & 15]));
+			W[i & 15] = MB_ROTL(t, 1);
+		}
+		if (i < 20) {
+			f = MB_XOR(MB_AND(MB_XOR(c, d), b), d);
+			k = _mm_set1_epi32(0x5a827999);
+		} else if (i < 40) {
+			f = MB_XOR(MB_XOR(b, c), d);
+			k = _mm_set1_epi32(0x6ed9eba1);
+		} else if (i < 60) {
+			f = MB_OR(MB_AND(b, c), MB_AND(d, MB_OR(b, c)));
+			k = _mm_set1_epi32((int)0x8f1bbcdc);
+		} else {
+			f = MB_XOR(MB_XOR(b, c), d);
+			k = _mm_set1_epi32((int)0xca62c1d6);
+		}
+		t = MB_ADD(MB_ADD(MB_ROTL(a, 5), f), MB_ADD(MB_ADD(e, k), W[i & 15]));
+		e = d;
+		d = c;
+		c = MB_ROTL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	MB_ADD_STATE(state, 0, a);
+	MB_ADD_STATE(state, 1, b);
+	MB_ADD_STATE(state, 2, c);
+	MB_ADD_STATE(state, 3, d);
+	MB_ADD_STATE(state, 4, e);
+}
+
+/* SHA-224 and SHA-256 */
+
+static const unsigned mb_sha224_initial_state[8] = {
+	0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+	0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+static const unsigned mb_sha256_initial_state[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/**
+ * Process one block of every lane by the SHA-256 compression function.
+ *
+ * @param state the state of all lanes
+ * @param blocks the message blocks
+ */
+static void mb_sha256_process(mb_state state, const unsigned char* blocks[MB_LANES])
+{
+	__m128i W[16], a, b, c, d, e, f, g, h, s0, s1, t1, t2;
+	unsigned i;
+
+	mb_load_words(W, blocks, 1);
+	a = MB_LOAD_STATE(state, 0);
+	b = MB_LOAD_STATE(state, 1);
+	c = MB_LOAD_STATE(state, 2);
+	d = MB_LOAD_STATE(state, 3);
+	e = MB_LOAD_STATE(state, 4);
+	f = MB_LOAD_STATE(state, 5);
+	g = MB_LOAD_STATE(state, 6);
+	h = MB_LOAD_STATE(state, 7);
+
+	for (i = 0; i < 64; i++) {
+		if (i >= 16) {
+			t1 = W[(i - 15) & 15];
+			t2 = W[(i - 2) & 15];
+			s0 = MB_XOR(MB_XOR(MB_ROTR(t1, 7), MB_ROTR(t1, 18)), _mm_srli_epi32(t1, 3));
+			s1 = MB_XOR(MB_XOR(MB_ROTR(t2, 17), MB_ROTR(t2, 19)), _mm_srli_epi32(t2, 10));
+			W[i & 15] = MB_ADD(MB_ADD(W[i & 15], s0), MB_ADD(W[(i - 7) & 15], s1));
+		}
+		s1 = MB_XOR(MB_XOR(MB_ROTR(e, 6), MB_ROTR(e, 11)), MB_ROTR(e, 25));
+		t1 = MB_XOR(MB_AND(MB_XOR(f, g), e), g); /* Ch(e, f, g) */
+		t1 = MB_ADD(MB_ADD(MB_ADD(h, s1), t1), MB_ADD(_mm_set1_epi32((int)rhash_k256[i]), W[i & 15]));
+		s0 = MB_XOR(MB_XOR(MB_ROTR(a, 2), MB_ROTR(a, 13)), MB_ROTR(a, 22));
+		t2 = MB_ADD(s0, MB_OR(MB_AND(a, b), MB_AND(c, MB_OR(a, b)))); /* Sigma0(a) + Maj(a, b, c) */
+		h = g;
+		g = f;
+		f = e;
+		e = MB_ADD(d, t1);
+		d = c;
+		c = b;
+		b = a;
+		a = MB_ADD(t1, t2);
+	}
+
+	MB_ADD_STATE(state, 0, a);
+	MB_ADD_STATE(state, 1, b);
+	MB_ADD_STATE(state, 2, c);
+	MB_ADD_STATE(state, 3, d);
+	MB_ADD_STATE(state, 4, e);
+	MB_ADD_STATE(state, 5, f);
+	MB_ADD_STATE(state, 6, g);
+	MB_ADD_STATE(state, 7, h);
+}
+
+static const mb_algorithm mb_algorithms[] = {
+	{ RHASH_MD5,    16, 4, 0, mb_md5_initial_state,    mb_md5_process },
+	{ RHASH_SHA1,   20, 5, 1, mb_sha1_initial_state,   mb_sha1_process },
+	{ RHASH_SHA224, 28, 8, 1, mb_sha224_initial_state, mb_sha256_process },
+	{ RHASH_SHA256, 32, 8, 1, mb_sha256_initial_state, mb_sha256_process }
+};
+#define MB_ALGORITHMS_COUNT (sizeof(mb_algorithms) / sizeof(*mb_algorithms))
+
+/**
+ * Find the multi-buffer implementation of a hash algorithm.
+ *
+ * @param hash_id id of the hash algorithm
+ * @return the algorithm descriptor, NULL if the hash is not supported
+ */
+static const mb_algorithm* mb_find_algorithm(unsigned hash_id)
+{
+	unsigned i;
+	for (i = 0; i < MB_ALGORITHMS_COUNT; i++) {
+		if (mb_algorithms[i].hash_id == hash_id)
+			return &mb_algorithms[i];
+	}
+	return NULL;
+}
+
+/**
+ * Start hashing a message in the given lane.
+ *
+ * @param alg the hash algorithm
+ * @param state the state of all lanes
+ * @param lane the lane to start
+ * @param lane_index the index of the lane
+ * @param index the index of the message in the batch
+ * @param message the message to hash
+ * @param length the length of the message
+ */
+static void mb_lane_start(const mb_algorithm* alg, mb_state state, mb_lane* lane,
+	unsigned lane_index, size_t index, const unsigned char* message, size_t length)
+{
+	size_t rest = length % MB_BLOCK_SIZE;
+	uint64_t bit_length = (uint64_t)length << 3;
+	unsigned char* end;
+	unsigned i;
+
+	for (i = 0; i < alg->state_words; i++)
+		state[i][lane_index] = alg->initial_state[i];
+
+	lane->index = index;
+	lane->data = message;
+	lane->blocks = length / MB_BLOCK_SIZE;
+	lane->tail_blocks = (rest < MB_BLOCK_SIZE - 8 ? 1 : 2);
+	lane->tail_pos = lane->tail;
+
+	/* pad the message and append its length in bits */
+	memset(lane->tail, 0, sizeof(lane->tail));
+	if (rest > 0)
+		memcpy(lane->tail, message + length - rest, rest);
+	lane->tail[rest] = 0x80;
+	end = lane->tail + lane->tail_blocks * MB_BLOCK_SIZE - 8;
+	for (i = 0; i < 8; i++) {
+		unsigned shift = (alg->is_big_endian ? 56 - 8 * i : 8 * i);
+		end[i] = (unsigned char)(bit_length >> shift);
+	}
+}
+
+/**
+ * Get the next block to be hashed in a lane.
+ *
+ * @param lane the lane
+ * @return the next message or padding block
+ */
+static const unsigned char* mb_lane_next_block(mb_lane* lane)
+{
+	const unsigned char* block;
+	if (lane->blocks > 0) {
+		block = lane->data;
+		lane->data += MB_BLOCK_SIZE;
+		lane->blocks--;
+	} else {
+		block = lane->tail_pos;
+		lane->tail_pos += MB_BLOCK_SIZE;
+		lane->tail_blocks--;
+	}
+	return block;
+}
+
+/**
+ * Hash several messages by MD5, SHA1 or SHA2 in SSE2 lanes.
+ *
+ * @param alg the hash algorithm
+ * @param messages the messages to hash
+ * @param lengths the lengths of the messages
+ * @param results the buffers to receive the message digests
+ * @param count the number of messages
+ */
+static void mb_hash_sse2(const mb_algorithm* alg, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count)
+{
+	static const unsigned char zero_block[MB_BLOCK_SIZE];
+	const unsigned char* blocks[MB_LANES];
+	mb_lane lanes[MB_LANES];
+	int active[MB_LANES];
+	unsigned active_count = 0;
+	unsigned words[MB_MAX_WORDS];
+	mb_state state;
+	size_t next = 0;
+	unsigned i, j;
+
+	memset(state, 0, sizeof(state));
+	for (i = 0; i < MB_LANES; i++) {
+		active[i] = (next < count);
+		if (active[i]) {
+			mb_lane_start(alg, state, &lanes[i], i, next, (const unsigned char*)messages[next], lengths[next]);
+			next++;
+			active_count++;
+		}
+	}
+
+	while (active_count > 0) {
+		/* idle lanes hash a dummy block */
+		for (i = 0; i < MB_LANES; i++)
+			blocks[i] = (active[i] ? mb_lane_next_block(&lanes[i]) : zero_block);
+		alg->process(state, blocks);
+
+		for (i = 0; i < MB_LANES; i++) {
+			if (!active[i] || lanes[i].blocks > 0 || lanes[i].tail_blocks > 0)
+				continue;
+
+			/* the message is finished, store its digest and refill the lane */
+			for (j = 0; j < alg->state_words; j++)
+				words[j] = state[j][i];
+			if (alg->is_big_endian)
+				be32_copy(results[lanes[i].index], 0, words, alg->digest_size);
+			else
+				le32_copy(results[lanes[i].index], 0, words, alg->digest_size);
+
+			if (next < count) {
+				mb_lane_start(alg, state, &lanes[i], i, next, (const unsigned char*)messages[next], lengths[next]);
+				next++;
+			} else {
+				active[i] = 0;
+				active_count--;
+			}
+		}
+	}
+}
+
+#endif /* USE_MB_SSE2 */
+
+#ifdef USE_MB_AVX2
+
+#define MB_SHA3_LANES 4
+#define MB_SHA3_HASHES (RHASH_SHA3_224 | RHASH_SHA3_256 | RHASH_SHA3_384 | RHASH_SHA3_512)
+#define MB_SHA3_MAX_RATE 144
+
+/* a message being hashed by SHA3 in a lane */
+typedef struct mb_sha3_lane
+{
+	size_t index;              /* index of the message in the batch */
+	const unsigned char* data; /* the next full block of the message */
+	size_t blocks;             /* number of full message blocks left */
+	int has_tail;              /* non-zero if the padding block is not processed yet */
+	unsigned char tail[MB_SHA3_MAX_RATE]; /* the padded end of the message */
+} mb_sha3_lane;
+
+#define MB_ROTL64(x, n) _mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+#define MB_XOR5(a, b, c, d, e) _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(a, b), \
+	_mm256_xor_si256(c, d)), e)
+#define MB_CHI(a, b, c) _mm256_xor_si256((a), _mm256_andnot_si256((b), (c)))
+
+/**
+ * Apply the Keccak-f[1600] permutation to the states of all lanes.
+ *
+ * @param A the states of the lanes, A[i] contains the word i of every lane
+ */
+__attribute__((target("avx2")))
+static void mb_keccak_permutation(__m256i A[25])
+{
+	__m256i B[25], C0, C1, C2, C3, C4, D0, D1, D2, D3, D4;
+	unsigned round;
+
+	for (round = 0; round < 24; round++) {
+		C0 = MB_XOR5(A[0], A[5], A[10], A[15], A[20]);
+		C1 = MB_XOR5(A[1], A[6], A[11], A[16], A[21]);
+		C2 = MB_XOR5(A[2], A[7], A[12], A[17], A[22]);
+		C3 = MB_XOR5(A[3], A[8], A[13], A[18], A[23]);
+		C4 = MB_XOR5(A[4], A[9], A[14], A[19], A[24]);
+		D0 = _mm256_xor_si256(C4, MB_ROTL64(C1, 1));
+		D1 = _mm256_xor_si256(C0, MB_ROTL64(C2, 1));
+		D2 = _mm256_xor_si256(C1, MB_ROTL64(C3, 1));
+		D3 = _mm256_xor_si256(C2, MB_ROTL64(C4, 1));
+		D4 = _mm256_xor_si256(C3, MB_ROTL64(C0, 1));
+
+		/* theta, rho and pi: B[y, 2x + 3y] = ROTL(A[x, y] ^ D[x], rho[x, y]) */
+		B[ 0] = _mm256_xor_si256(A[ 0], D0);
+		B[10] = MB_ROTL64(_mm256_xor_si256(A[ 1], D1), 1);
+		B[20] = MB_ROTL64(_mm256_xor_si256(A[ 2], D2), 62);
+		B[ 5] = MB_ROTL64(_mm256_xor_si256(A[ 3], D3), 28);
+		B[15] = MB_ROTL64(_mm256_xor_si256(A[ 4], D4), 27);
+		B[16] = MB_ROTL64(_mm256_xor_si256(A[ 5], D0), 36);
+		B[ 1] = MB_ROTL64(_mm256_xor_si256(A[ 6], D1), 44);
+		B[11] = MB_ROTL64(_mm256_xor_si256(A[ 7], D2), 6);
+		B[21] = MB_ROTL64(_mm256_xor_si256(A[ 8], D3), 55);
+		B[ 6] = MB_ROTL64(_mm256_xor_si256(A[ 9], D4), 20);
+		B[ 7] = MB_ROTL64(_mm256_xor_si256(A[10], D0), 3);
+		B[17] = MB_ROTL64(_mm256_xor_si256(A[11], D1), 10);
+		B[ 2] = MB_ROTL64(_mm256_xor_si256(A[12], D2), 43);
+		B[12] = MB_ROTL64(_mm256_xor_si256(A[13], D3), 25);
+		B[22] = MB_ROTL64(_mm256_xor_si256(A[14], D4), 39);
+		B[23] = MB_ROTL64(_mm256_xor_si256(A[15], D0), 41);
+		B[ 8] = MB_ROTL64(_mm256_xor_si256(A[16], D1), 45);
+		B[18] = MB_ROTL64(_mm256_xor_si256(A[17], D2), 15);
+		B[ 3] = MB_ROTL64(_mm256_xor_si256(A[18], D3), 21);
+		B[13] = MB_ROTL64(_mm256_xor_si256(A[19], D4), 8);
+		B[14] = MB_ROTL64(_mm256_xor_si256(A[20], D0), 18);
+		B[24] = MB_ROTL64(_mm256_xor_si256(A[21], D1), 2);
+		B[ 9] = MB_ROTL64(_mm256_xor_si256(A[22], D2), 61);
+		B[19] = MB_ROTL64(_mm256_xor_si256(A[23], D3), 56);
+		B[ 4] = MB_ROTL64(_mm256_xor_si256(A[24], D4), 14);
+
+		/* chi */
+		A[ 0] = MB_CHI(B[ 0], B[ 1], B[ 2]);
+		A[ 1] = MB_CHI(B[ 1], B[ 2], B[ 3]);
+		A[ 2] = MB_CHI(B[ 2], B[ 3], B[ 4]);
+		A[ 3] = MB_CHI(B[ 3], B[ 4], B[ 0]);
+		A[ 4] = MB_CHI(B[ 4], B[ 0], B[ 1]);
+		A[ 5] = MB_CHI(B[ 5], B[ 6], B[ 7]);
+		A[ 6] = MB_CHI(B[ 6], B[ 7], B[ 8]);
+		A[ 7] = MB_CHI(B[ 7], B[ 8], B[ 9]);
+		A[ 8] = MB_CHI(B[ 8], B[ 9], B[ 5]);
+		A[ 9] = MB_CHI(B[ 9], B[ 5], B[ 6]);
+		A[10] = MB_CHI(B[10], B[11], B[12]);
+		A[11] = MB_CHI(B[11], B[12], B[13]);
+		A[12] = MB_CHI(B[12], B[13], B[14]);
+		A[13] = MB_CHI(B[13], B[14], B[10]);
+		A[14] = MB_CHI(B[14], B[10], B[11]);
+		A[15] = MB_CHI(B[15], B[16], B[17]);
+		A[16] = MB_CHI(B[16], B[17], B[18]);
+		A[17] = MB_CHI(B[17], B[18], B[19]);
+		A[18] = MB_CHI(B[18], B[19], B[15]);
+		A[19] = MB_CHI(B[19], B[15], B[16]);
+		A[20] = MB_CHI(B[20], B[21], B[22]);
+		A[21] = MB_CHI(B[21], B[22], B[23]);
+		A[22] = MB_CHI(B[22], B[23], B[24]);
+		A[23] = MB_CHI(B[23], B[24], B[20]);
+		A[24] = MB_CHI(B[24], B[20], B[21]);
+
+		/* iota */
+		A[0] = _mm256_xor_si256(A[0], _mm256_set1_epi64x((long long)rhash_keccak_round_constants[round]));
+	}
+}
+
+/**
+ * Start hashing a message by SHA3 in the given lane.
+ *
+ * @param A the states of all lanes
+ * @param lane the lane to start
+ * @param lane_index the index of the lane
+ * @param rate the size of SHA3 message block
+ * @param index the index of the message in the batch
+ * @param message the message to hash
+ * @param length the length of the message
+ */
+__attribute__((target("avx2")))
+static void mb_sha3_lane_start(__m256i A[25], mb_sha3_lane* lane, unsigned lane_index,
+	size_t rate, size_t index, const unsigned char* message, size_t length)
+{
+	size_t rest = length % rate;
+	uint64_t mask[MB_SHA3_LANES] = { ~I64(0), ~I64(0), ~I64(0), ~I64(0) };
+	__m256i keep;
+	unsigned i;
+
+	/* clear the state of the lane */
+	mask[lane_index] = 0;
+	keep = _mm256_loadu_si256((const __m256i*)mask);
+	for (i = 0; i < 25; i++)
+		A[i] = _mm256_and_si256(A[i], keep);
+
+	lane->index = index;
+	lane->data = message;
+	lane->blocks = length / rate;
+	lane->has_tail = 1;
+	memset(lane->tail, 0, sizeof(lane->tail));
+	if (rest > 0)
+		memcpy(lane->tail, message + length - rest, rest);
+	lane->tail[rest] |= 0x06;
+	lane->tail[rate - 1] |= 0x80;
+}
+
+/**
+ * Hash several messages by a SHA3 function in AVX2 lanes.
+ *
+ * @param hash_id id of the SHA3 function
+ * @param messages the messages to hash
+ * @param lengths the lengths of the messages
+ * @param results the buffers to receive the message digests
+ * @param count the number of messages
+ */
+__attribute__((target("avx2")))
+static void mb_sha3_hash_avx2(unsigned hash_id, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count)
+{
+	static const unsigned char zero_block[MB_SHA3_MAX_RATE];
+	const size_t digest_size = (hash_id == RHASH_SHA3_224 ? 28 :
+		hash_id == RHASH_SHA3_256 ? 32 : hash_id == RHASH_SHA3_384 ? 48 : 64);
+	const size_t rate = 200 - 2 * digest_size;
+	const unsigned char* blocks[MB_SHA3_LANES];
+	mb_sha3_lane lanes[MB_SHA3_LANES];
+	int active[MB_SHA3_LANES];
+	unsigned active_count = 0;
+	uint64_t words[25][MB_SHA3_LANES];
+	uint64_t hash[25];
+	__m256i A[25];
+	size_t next = 0;
+	unsigned i, j;
+
+	for (i = 0; i < 25; i++)
+		A[i] = _mm256_setzero_si256();
+	for (i = 0; i < MB_SHA3_LANES; i++) {
+		active[i] = (next < count);
+		if (active[i]) {
+			mb_sha3_lane_start(A, &lanes[i], i, rate, next, (const unsigned char*)messages[next], lengths[next]);
+			next++;
+			active_count++;
+		}
+	}
+
+	while (active_count > 0) {
+		/* idle lanes absorb a dummy block */
+		for (i = 0; i < MB_SHA3_LANES; i++) {
+			mb_sha3_lane* lane = &lanes[i];
+			if (!active[i]) {
+				blocks[i] = zero_block;
+			} else if (lane->blocks > 0) {
+				blocks[i] = lane->data;
+				lane->data += rate;
+				lane->blocks--;
+			} else {
+				blocks[i] = lane->tail;
+				lane->has_tail = 0;
+			}
+		}
+		for (j = 0; j < rate / 8; j++) {
+			for (i = 0; i < MB_SHA3_LANES; i++) {
+				uint64_t word;
+				memcpy(&word, blocks[i] + j * 8, 8);
+				words[j][i] = le2me_64(word);
+			}
+			A[j] = _mm256_xor_si256(A[j], _mm256_loadu_si256((const __m256i*)words[j]));
+		}
+		mb_keccak_permutation(A);
+
+		for (i = 0; i < MB_SHA3_LANES; i++) {
+			if (!active[i] || lanes[i].blocks > 0 || lanes[i].has_tail)
+				continue;
+
+			/* the message is finished, store its digest and refill the lane */
+			for (j = 0; j < 25; j++) {
+				_mm256_storeu_si256((__m256i*)words[j], A[j]);
+				hash[j] = words[j][i];
+			}
+			me64_to_le_str(results[lanes[i].index], hash, digest_size);
+
+			if (next < count) {
+				mb_sha3_lane_start(A, &lanes[i], i, rate, next, (const unsigned char*)messages[next], lengths[next]);
+				next++;
+			} else {
+				active[i] = 0;
+				active_count--;
+			}
+		}
+	}
+}
+#endif /* USE_MB_AVX2 */
+
+/**
+ * Check if multi-buffer hashing is supported for the given hash algorithm.
+ *
+ * @param hash_id id of the hash algorithm
+ * @return 1 if the hash algorithm is supported, 0 otherwise
+ */
+int rhash_mb_is_supported(unsigned hash_id)
+{
+#ifdef USE_MB_AVX2
+	if ((hash_id & MB_SHA3_HASHES) != 0)
+		return has_cpu_feature(CPU_FEATURE_AVX2);
+#endif
+#ifdef USE_MB_SSE2
+	/* SHA extensions hash a single message faster, than SSE2 lanes */
+	if ((hash_id & (RHASH_SHA1 | RHASH_SHA224 | RHASH_SHA256)) != 0 && has_cpu_feature(CPU_FEATURE_SHA))
+		return 0;
+	if (mb_find_algorithm(hash_id) != NULL)
+		return 1;
+#endif
+	(void)hash_id;
+	return 0;
+}
+
+/**
+ * Hash several messages by a hash algorithm, supported by the
+ * multi-buffer engine.
+ *
+ * @param hash_id id of the hash algorithm
+ * @param messages the messages to hash
+ * @param lengths the lengths of the messages
+ * @param results the buffers to receive the message digests
+ * @param count the number of messages
+ */
+void rhash_mb_hash(unsigned hash_id, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count)
+{
+#ifdef USE_MB_AVX2
+	if ((hash_id & MB_SHA3_HASHES) != 0) {
+		mb_sha3_hash_avx2(hash_id, messages, lengths, results, count);
+		return;
+	}
+#endif
+#ifdef USE_MB_SSE2
+	mb_hash_sse2(mb_find_algorithm(hash_id), messages, lengths, results, count);
+#else
+	(void)hash_id;
+	(void)messages;
+	(void)lengths;
+	(void)results;
+	(void)count;
+#endif
+}
@@ -0,0 +1,18 @@
+/* mb_hash.h - multi-buffer hashing of several messages in SIMD lanes */
+#ifndef MB_HASH_H
+#define MB_HASH_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rhash_mb_is_supported(unsigned hash_id);
+void rhash_mb_hash(unsigned hash_id, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* MB_HASH_H */
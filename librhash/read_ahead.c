@@ -0,0 +1,319 @@
+/* read_ahead.c - a file reader, loading next blocks by a background thread
+ *
+ * Copyright: 2026 RHash contributors
+ *
+ * Permission is hereby granted,  free of charge,  to any person  obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,  including without limitation
+ * the rights to  use, copy, modify,  merge, publish, distribute, sublicense,
+ * and/or sell copies  of  the Software,  and to permit  persons  to whom the
+ * Software is furnished to do so.
+ *
+ * This program  is  distributed  in  the  hope  that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  Use this program  at  your own risk!
+ */
+
+/* O_DIRECT and 64-bit off_t must be requested before any included file */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#undef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef _WIN32
+# include <io.h>
+# define rhash_read(fd, buf, size) _read(fd, buf, (unsigned)(size))
+#else
+# include <unistd.h>
+# define rhash_read(fd, buf, size) read(fd, buf, size)
+#endif
+#include "read_ahead.h"
+
+#if defined(O_DIRECT) && defined(F_SETFL)
+# define USE_O_DIRECT
+#endif
+
+/**
+ * Prepare the file descriptor for reading. If direct reading is requested,
+ * try to switch the descriptor to the O_DIRECT mode. If O_DIRECT is not
+ * supported, the read data is dropped from the page cache after reading.
+ *
+ * @param io the structure to initialize
+ * @param fd file descriptor opened for reading
+ * @param direct non-zero to bypass the page cache
+ */
+void rhash_io_open(rhash_io* io, int fd, int direct)
+{
+	io->fd = fd;
+	io->flags = 0;
+	io->saved_flags = -1;
+	io->offset = -1;
+	if (!direct) return;
+
+#if defined(POSIX_FADV_DONTNEED)
+	io->offset = (int64_t)lseek(fd, 0, SEEK_CUR);
+#endif
+#ifdef USE_O_DIRECT
+	io->saved_flags = fcntl(fd, F_GETFL);
+	if (io->saved_flags != -1 && (io->saved_flags & O_DIRECT) == 0 &&
+			fcntl(fd, F_SETFL, io->saved_flags | O_DIRECT) == 0) {
+		io->flags = RHASH_IO_DIRECT;
+		return;
+	}
+	io->saved_flags = -1;
+#endif
+	io->flags = RHASH_IO_DROP_CACHE;
+}
+
+/**
+ * Read the next block of the file. The buffer and the size must be
+ * aligned by 4 KiB, to be read in the O_DIRECT mode.
+ *
+ * @param io the file to read
+ * @param buffer the buffer to read data into
+ * @param size the size of the buffer
+ * @return the number of bytes read, 0 on end of file,
+ *         -1 on error with errno being set
+ */
+long rhash_io_read(rhash_io* io, void* buffer, size_t size)
+{
+	long length;
+	for (;;) {
+		length = (long)rhash_read(io->fd, buffer, size);
+		if (length >= 0) break;
+		if (errno == EINTR) continue;
+#ifdef USE_O_DIRECT
+		if (errno == EINVAL && (io->flags & RHASH_IO_DIRECT) != 0) {
+			/* the file system or the file offset doesn't allow O_DIRECT */
+			fcntl(io->fd, F_SETFL, io->saved_flags);
+			io->saved_flags = -1;
+			io->flags = RHASH_IO_DROP_CACHE;
+			continue;
+		}
+#endif
+		return -1;
+	}
+#if defined(POSIX_FADV_DONTNEED)
+	if ((io->flags & RHASH_IO_DROP_CACHE) != 0 && io->offset >= 0 && length > 0) {
+		posix_fadvise(io->fd, (off_t)io->offset, (off_t)length, POSIX_FADV_DONTNEED);
+	}
+#endif
+	if (io->offset >= 0) io->offset += length;
+	return length;
+}
+
+/**
+ * Restore the original mode of the file descriptor.
+ *
+ * @param io the file being read
+ */
+void rhash_io_close(rhash_io* io)
+{
+#ifdef USE_O_DIRECT
+	if (io->saved_flags != -1) {
+		int save_errno = errno;
+		fcntl(io->fd, F_SETFL, io->saved_flags);
+		errno = save_errno;
+	}
+#endif
+	io->saved_flags = -1;
+}
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+
+/* number of blocks: one is being hashed, while the others are read */
+#define READ_AHEAD_BLOCKS 3
+#define READ_AHEAD_ALIGN 4096
+
+struct rhash_read_ahead
+{
+	pthread_mutex_t lock;
+	pthread_cond_t block_ready; /* signaled when a block is read or on eof */
+	pthread_cond_t block_free;  /* signaled when a block is released */
+	pthread_t thread;
+	rhash_io* io;
+	unsigned char* memory;
+	unsigned char* blocks[READ_AHEAD_BLOCKS];
+	long lengths[READ_AHEAD_BLOCKS];
+	size_t block_size;
+	unsigned head;   /* index of the next block to return */
+	unsigned filled; /* number of read blocks, including the returned one */
+	int returned;    /* non-zero if the head block was returned to the caller */
+	int eof;         /* non-zero if end of file is reached or error occurred */
+	int error;       /* errno value of the failed read() call */
+	int shutdown;
+};
+
+/**
+ * The main loop of the reading thread.
+ *
+ * @param arg the reader
+ * @return NULL
+ */
+static void* reader_thread(void* arg)
+{
+	rhash_read_ahead* reader = (rhash_read_ahead*)arg;
+	unsigned tail = 0;
+	long length;
+
+	for (;;) {
+		pthread_mutex_lock(&reader->lock);
+		while (!reader->shutdown && reader->filled == READ_AHEAD_BLOCKS)
+			pthread_cond_wait(&reader->block_free, &reader->lock);
+		if (reader->shutdown) {
+			pthread_mutex_unlock(&reader->lock);
+			break;
+		}
+		pthread_mutex_unlock(&reader->lock);
+
+		length = rhash_io_read(reader->io, reader->blocks[tail], reader->block_size);
+
+		pthread_mutex_lock(&reader->lock);
+		if (length > 0) {
+			reader->lengths[tail] = length;
+			reader->filled++;
+			tail = (tail + 1) % READ_AHEAD_BLOCKS;
+		} else {
+			reader->eof = 1;
+			reader->error = (length < 0 ? errno : 0);
+		}
+		pthread_cond_signal(&reader->block_ready);
+		pthread_mutex_unlock(&reader->lock);
+		if (length <= 0) break;
+	}
+	return NULL;
+}
+
+/**
+ * Start reading a file by a background thread. The file is read from
+ * the current position of the file descriptor. The io structure
+ * must not be used by the caller until the reader is freed.
+ *
+ * @param io the file to read
+ * @param block_size the size of blocks to read, a multiple of 4 KiB
+ * @return the reader on success, NULL on error with errno being set
+ */
+rhash_read_ahead* rhash_read_ahead_new(rhash_io* io, size_t block_size)
+{
+	rhash_read_ahead* reader;
+	size_t align;
+	unsigned i;
+	int err;
+
+	reader = (rhash_read_ahead*)calloc(1, sizeof(rhash_read_ahead));
+	if (!reader) return NULL;
+	reader->memory = (unsigned char*)malloc(block_size * READ_AHEAD_BLOCKS + READ_AHEAD_ALIGN);
+	if (!reader->memory) {
+		free(reader);
+		return NULL;
+	}
+	align = ((unsigned char*)0 - reader->memory) & (READ_AHEAD_ALIGN - 1);
+	for (i = 0; i < READ_AHEAD_BLOCKS; i++)
+		reader->blocks[i] = reader->memory + align + i * block_size;
+	reader->io = io;
+	reader->block_size = block_size;
+	pthread_mutex_init(&reader->lock, NULL);
+	pthread_cond_init(&reader->block_ready, NULL);
+	pthread_cond_init(&reader->block_free, NULL);
+
+	err = pthread_create(&reader->thread, NULL, reader_thread, reader);
+	if (err != 0) {
+		pthread_cond_destroy(&reader->block_free);
+		pthread_cond_destroy(&reader->block_ready);
+		pthread_mutex_destroy(&reader->lock);
+		free(reader->memory);
+		free(reader);
+		errno = err;
+		return NULL;
+	}
+	return reader;
+}
+
+/**
+ * Wait for the next block of the file. The block returned by
+ * the previous call is released and can't be used any more.
+ *
+ * @param reader the reader
+ * @param block pointer to receive the address of the block
+ * @return the length of the block, 0 on end of file,
+ *         -1 on error with errno being set
+ */
+long rhash_read_ahead_next(rhash_read_ahead* reader, unsigned char** block)
+{
+	long length;
+	pthread_mutex_lock(&reader->lock);
+	if (reader->returned) {
+		/* release the previously returned block */
+		reader->returned = 0;
+		reader->head = (reader->head + 1) % READ_AHEAD_BLOCKS;
+		reader->filled--;
+		pthread_cond_signal(&reader->block_free);
+	}
+	while (reader->filled == 0 && !reader->eof)
+		pthread_cond_wait(&reader->block_ready, &reader->lock);
+
+	if (reader->filled > 0) {
+		reader->returned = 1;
+		*block = reader->blocks[reader->head];
+		length = reader->lengths[reader->head];
+	} else if (reader->error) {
+		errno = reader->error;
+		length = -1;
+	} else {
+		length = 0;
+	}
+	pthread_mutex_unlock(&reader->lock);
+	return length;
+}
+
+/**
+ * Stop the reading thread and free the reader.
+ *
+ * @param reader the reader to free
+ */
+void rhash_read_ahead_free(rhash_read_ahead* reader)
+{
+	if (!reader) return;
+	pthread_mutex_lock(&reader->lock);
+	reader->shutdown = 1;
+	pthread_cond_signal(&reader->block_free);
+	pthread_mutex_unlock(&reader->lock);
+	pthread_join(reader->thread, NULL);
+
+	pthread_cond_destroy(&reader->block_free);
+	pthread_cond_destroy(&reader->block_ready);
+	pthread_mutex_destroy(&reader->lock);
+	free(reader->memory);
+	free(reader);
+}
+
+#else /* USE_PTHREADS */
+
+/* without threads support the caller falls back to synchronous reading */
+rhash_read_ahead* rhash_read_ahead_new(rhash_io* io, size_t block_size)
+{
+	(void)io;
+	(void)block_size;
+	errno = ENOSYS;
+	return NULL;
+}
+
+long rhash_read_ahead_next(rhash_read_ahead* reader, unsigned char** block)
+{
+	(void)reader;
+	(void)block;
+	errno = ENOSYS;
+	return -1;
+}
+
+void rhash_read_ahead_free(rhash_read_ahead* reader)
+{
+	(void)reader;
+}
+
+#endif /* USE_PTHREADS */
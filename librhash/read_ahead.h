@@ -0,0 +1,41 @@
+/* read_ahead.h - a file reader, loading next blocks by a background thread */
+#ifndef READ_AHEAD_H
+#define READ_AHEAD_H
+
+#include <stddef.h>
+#include "ustd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* flags of the rhash_io structure */
+#define RHASH_IO_DIRECT     1 /* the file is read by O_DIRECT, bypassing the page cache */
+#define RHASH_IO_DROP_CACHE 2 /* drop already read pages from the page cache */
+
+/**
+ * A file descriptor, being read from the beginning till the end.
+ */
+typedef struct rhash_io
+{
+	int fd;
+	unsigned flags;
+	int saved_flags; /* file status flags to restore, or -1 */
+	int64_t offset;  /* current file offset, or -1 if unknown */
+} rhash_io;
+
+void rhash_io_open(rhash_io* io, int fd, int direct);
+long rhash_io_read(rhash_io* io, void* buffer, size_t size);
+void rhash_io_close(rhash_io* io);
+
+typedef struct rhash_read_ahead rhash_read_ahead;
+
+rhash_read_ahead* rhash_read_ahead_new(rhash_io* io, size_t block_size);
+long rhash_read_ahead_next(rhash_read_ahead* reader, unsigned char** block);
+void rhash_read_ahead_free(rhash_read_ahead* reader);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* READ_AHEAD_H */
@@ -24,6 +24,16 @@
 #include <stdio.h>
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#ifdef _WIN32
+# include <io.h>
+# define rhash_open(path, flags) _open(path, flags)
+# define rhash_close(fd) _close(fd)
+#else
+# include <unistd.h>
+# define rhash_open(path, flags) open(path, flags)
+# define rhash_close(fd) close(fd)
+#endif
 
 /* modifier for Windows DLL */
 #if (defined(_WIN32) || defined(__CYGWIN__)) && defined(RHASH_EXPORTS)
@@ -33,9 +43,13 @@
 #include "byte_order.h"
 #include "algorithms.h"
 #include "torrent.h"
+#include "aich.h"
 #include "plug_openssl.h"
 #include "util.h"
 #include "hex.h"
+#include "mb_hash.h"
+#include "read_ahead.h"
+#include "thread_pool.h"
 #include "rhash.h" /* RHash library interface */
 
 #define STATE_ACTIVE  0xb01dbabe
@@ -43,10 +57,23 @@
 #define STATE_DELETED 0xdecea5ed
 #define RCTX_AUTO_FINAL 0x1
 #define RCTX_FINALIZED  0x2
+#define RCTX_DIRECT_IO  0x4
+#define RCTX_INPLACE    0x8
 #define RCTX_FINALIZED_MASK (RCTX_AUTO_FINAL | RCTX_FINALIZED)
 #define RHPR_FORMAT (RHPR_RAW | RHPR_HEX | RHPR_BASE32 | RHPR_BASE64)
 #define RHPR_MODIFIER (RHPR_UPPERCASE | RHPR_REVERSE)
 
+/* minimal message size to be split between threads by rhash_update() */
+#define MIN_THREADED_UPDATE_SIZE 4096
+
+/* the default, maximal and the alignment of rhash_fd_update() block size */
+#define DEFAULT_IO_BLOCK_SIZE 65536
+#define MAX_IO_BLOCK_SIZE (64 * 1024 * 1024)
+#define IO_BLOCK_ALIGN 4096
+
+/* the size of the stack buffer for a hash context, used by rhash_msg() */
+#define MSG_CONTEXT_SIZE 2048
+
 void rhash_library_init(void)
 {
 	rhash_init_algorithms(RHASH_ALL_HASHES);
@@ -62,72 +89,95 @@ int RHASH_API rhash_count(void)
 
 /* LOW-LEVEL LIBRHASH INTERFACE */
 
-RHASH_API rhash rhash_init(unsigned hash_id)
+/**
+ * Calculate the layout of a rhash context for the given hash_id.
+ *
+ * @param hash_id union of bit flags, containing ids of hashes to calculate
+ * @param num pointer to receive the number of hash algorithms
+ * @param common_size pointer to receive the aligned size of the common part of the context
+ * @return total size of the context in bytes, 0 on error and errno is set
+ */
+static size_t rhash_ctx_layout(unsigned hash_id, unsigned* num, size_t* common_size)
 {
 	unsigned tail_bit_index; /* index of hash_id trailing bit */
-	unsigned num = 0;        /* number of hashes to compute */
-	rhash_context_ext *rctx = NULL; /* allocated rhash context */
 	size_t hash_size_sum = 0;   /* size of hash contexts to store in rctx */
-
-	unsigned i, bit_index, id;
-	struct rhash_hash_info* info;
+	unsigned bit_index, id;
 	size_t aligned_size;
-	char* phash_ctx;
 
 	hash_id &= RHASH_ALL_HASHES;
 	if (hash_id == 0) {
 		errno = EINVAL;
-		return NULL;
+		return 0;
 	}
 
 	tail_bit_index = rhash_ctz(hash_id); /* get trailing bit index */
 	assert(tail_bit_index < RHASH_HASH_COUNT);
 
-	id = 1 << tail_bit_index;
+	id = 1u << tail_bit_index;
 
 	if (hash_id == id) {
 		/* handle the most common case of only one hash */
-		num = 1;
-		info = &rhash_info_table[tail_bit_index];
-		hash_size_sum = info->context_size;
+		*num = 1;
+		hash_size_sum = rhash_info_table[tail_bit_index].context_size;
 	} else {
 		/* another case: hash_id contains several hashes */
-		for (bit_index = tail_bit_index; id <= hash_id; bit_index++, id = id << 1) {
-			assert(id != 0);
+		*num = 0;
+		for (bit_index = tail_bit_index; id != 0 && id <= hash_id; bit_index++, id = id << 1) {
 			assert(bit_index < RHASH_HASH_COUNT);
-			info = &rhash_info_table[bit_index];
 			if (hash_id & id) {
 				/* align sizes by 8 bytes */
-				aligned_size = (info->context_size + 7) & ~7;
+				aligned_size = (rhash_info_table[bit_index].context_size + 7) & ~7;
 				hash_size_sum += aligned_size;
-				num++;
+				(*num)++;
 			}
 		}
-		assert(num > 1);
+		assert(*num > 1);
 	}
 
 	/* align the size of the rhash context common part */
-	aligned_size = ((offsetof(rhash_context_ext, vector) + sizeof(rhash_vector_item) * num) + 7) & ~7;
+	aligned_size = ((offsetof(rhash_context_ext, vector) + sizeof(rhash_vector_item) * *num) + 7) & ~7;
 	assert(aligned_size >= sizeof(rhash_context_ext));
+	*common_size = aligned_size;
+	return aligned_size + hash_size_sum;
+}
 
-	/* allocate rhash context with enough memory to store contexts of all used hashes */
-	rctx = (rhash_context_ext*)malloc(aligned_size + hash_size_sum);
-	if (rctx == NULL) return NULL;
+/**
+ * Initialize a rhash context in a memory block of the size
+ * returned by rhash_ctx_layout().
+ *
+ * @param rctx the memory block to initialize
+ * @param hash_id union of bit flags, containing ids of hashes to calculate
+ * @param num the number of hash algorithms
+ * @param aligned_size the aligned size of the common part of the context
+ * @param flags initial RCTX_* flags of the context
+ * @param alloc_size the size of the memory block
+ * @return initialized rhash context
+ */
+static rhash rhash_ctx_setup(rhash_context_ext* rctx, unsigned hash_id,
+	unsigned num, size_t aligned_size, unsigned flags, size_t alloc_size)
+{
+	unsigned i, bit_index, id;
+	struct rhash_hash_info* info;
+	char* phash_ctx;
+
+	hash_id &= RHASH_ALL_HASHES;
 
 	/* initialize common fields of the rhash context */
-	memset(rctx, 0, sizeof(rhash_context_ext));
+	memset(rctx, 0, aligned_size);
 	rctx->rc.hash_id = hash_id;
-	rctx->flags = RCTX_AUTO_FINAL; /* turn on auto-final by default */
+	rctx->flags = flags;
 	rctx->state = STATE_ACTIVE;
 	rctx->hash_vector_size = num;
+	rctx->io_block_size = DEFAULT_IO_BLOCK_SIZE;
+	rctx->alloc_size = alloc_size;
 
 	/* aligned hash contexts follows rctx->vector[num] in the same memory block */
 	phash_ctx = (char*)rctx + aligned_size;
 	assert(phash_ctx >= (char*)&rctx->vector[num]);
 
 	/* initialize context for every hash in a loop */
-	for (bit_index = tail_bit_index, id = 1 << tail_bit_index, i = 0;
-		id <= hash_id; bit_index++, id = id << 1)
+	for (bit_index = rhash_ctz(hash_id), id = 1u << bit_index, i = 0;
+		id != 0 && id <= hash_id; bit_index++, id = id << 1)
 	{
 		/* check if a hash function with given id shall be included into rctx */
 		if ((hash_id & id) != 0) {
@@ -149,27 +199,162 @@ RHASH_API rhash rhash_init(unsigned hash_id)
 		}
 	}
 
-	return &rctx->rc; /* return allocated and initialized rhash context */
+	return &rctx->rc; /* return initialized rhash context */
+}
+
+RHASH_API rhash rhash_init(unsigned hash_id)
+{
+	rhash_context_ext *rctx; /* allocated rhash context */
+	unsigned num;
+	size_t aligned_size;
+	size_t size = rhash_ctx_layout(hash_id, &num, &aligned_size);
+	if (size == 0) return NULL;
+
+	/* allocate rhash context with enough memory to store contexts of all used hashes */
+	rctx = (rhash_context_ext*)malloc(size);
+	if (rctx == NULL) return NULL;
+
+	/* turn on auto-final by default */
+	return rhash_ctx_setup(rctx, hash_id, num, aligned_size, RCTX_AUTO_FINAL, size);
+}
+
+RHASH_API size_t rhash_get_context_size(unsigned hash_id)
+{
+	unsigned num;
+	size_t aligned_size;
+	return rhash_ctx_layout(hash_id, &num, &aligned_size);
+}
+
+RHASH_API rhash rhash_init_inplace(unsigned hash_id, void* mem, size_t size)
+{
+	unsigned num;
+	size_t aligned_size;
+	size_t ctx_size = rhash_ctx_layout(hash_id, &num, &aligned_size);
+	if (ctx_size == 0) return NULL;
+	if (!mem || size < ctx_size || (((char*)mem - (char*)0) & 7) != 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return rhash_ctx_setup((rhash_context_ext*)mem, hash_id, num, aligned_size,
+		RCTX_AUTO_FINAL | RCTX_INPLACE, size);
+}
+
+/**
+ * Clean the hash functions of a context, which require additional clean up.
+ *
+ * @param ectx the rhash context
+ */
+static void rhash_ctx_cleanup(rhash_context_ext* ectx)
+{
+	unsigned i;
+	for (i = 0; i < ectx->hash_vector_size; i++) {
+		struct rhash_hash_info* info = ectx->vector[i].hash_info;
+		if (info->cleanup != 0) {
+			info->cleanup(ectx->vector[i].context);
+		}
+	}
 }
 
 void rhash_free(rhash ctx)
 {
 	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
-	unsigned i;
 
 	if (ctx == 0) return;
 	assert(ectx->hash_vector_size <= RHASH_HASH_COUNT);
 	ectx->state = STATE_DELETED; /* mark memory block as being removed */
+	rhash_thread_pool_free((rhash_thread_pool*)ectx->thread_pool);
+	rhash_ctx_cleanup(ectx);
 
-	/* clean the hash functions, which require additional clean up */
-	for (i = 0; i < ectx->hash_vector_size; i++) {
-		struct rhash_hash_info* info = ectx->vector[i].hash_info;
-		if (info->cleanup != 0) {
-			info->cleanup(ectx->vector[i].context);
+	if (!(ectx->flags & RCTX_INPLACE))
+		free(ectx);
+}
+
+/**
+ * Create the thread pool of a context, according to the number of threads
+ * requested by rhash_set_threads() and the hash functions of the context.
+ * The pool is kept, if it already has the needed size.
+ *
+ * @param ectx the rhash context
+ * @return 0 on success, -1 if the thread pool can't be created
+ */
+static int rhash_ctx_setup_threads(rhash_context_ext* ectx)
+{
+	unsigned threads = ectx->threads;
+	/* there is no use in more threads, than algorithms,
+	 * unless a tree hash splits a message between threads */
+	if (threads > ectx->hash_vector_size) {
+		unsigned i;
+		for (i = 0; i < ectx->hash_vector_size; i++) {
+			if (rhash_update_mt_by_id(ectx->vector[i].hash_info->info->hash_id))
+				break;
 		}
+		if (i == ectx->hash_vector_size)
+			threads = ectx->hash_vector_size;
 	}
+	if (threads < 2)
+		threads = 1;
+	if (threads == rhash_thread_pool_size((rhash_thread_pool*)ectx->thread_pool))
+		return 0;
+	rhash_thread_pool_free((rhash_thread_pool*)ectx->thread_pool);
+	ectx->thread_pool = NULL;
+	if (threads > 1) {
+		ectx->thread_pool = rhash_thread_pool_new(threads);
+		if (!ectx->thread_pool) return -1;
+	}
+	return 0;
+}
+
+RHASH_API rhash rhash_reinit(rhash ctx, unsigned hash_id)
+{
+	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
+	rhash_context_ext* rctx = ectx;
+	void *callback, *callback_data, *thread_pool;
+	void *block_callback, *block_callback_data;
+	size_t io_block_size;
+	unsigned flags, threads;
+	unsigned num;
+	size_t aligned_size;
+	size_t size = rhash_ctx_layout(hash_id, &num, &aligned_size);
+	if (size == 0) return NULL;
 
-	free(ectx);
+	assert(ectx->hash_vector_size <= RHASH_HASH_COUNT);
+	if (size > ectx->alloc_size) {
+		/* the memory block is too small, allocate a larger one */
+		rctx = (rhash_context_ext*)malloc(size);
+		if (rctx == NULL) return NULL;
+	}
+
+	/* save the settings of the context */
+	callback = ectx->callback;
+	callback_data = ectx->callback_data;
+	block_callback = ectx->block_callback;
+	block_callback_data = ectx->block_callback_data;
+	thread_pool = ectx->thread_pool;
+	threads = ectx->threads;
+	io_block_size = ectx->io_block_size;
+	flags = ectx->flags & (RCTX_AUTO_FINAL | RCTX_DIRECT_IO);
+
+	rhash_ctx_cleanup(ectx);
+	if (rctx != ectx) {
+		if (!(ectx->flags & RCTX_INPLACE))
+			free(ectx);
+	} else {
+		flags |= (ectx->flags & RCTX_INPLACE);
+		size = ectx->alloc_size;
+	}
+
+	rhash_ctx_setup(rctx, hash_id, num, aligned_size, flags, size);
+	rctx->callback = callback;
+	rctx->callback_data = callback_data;
+	rctx->block_callback = block_callback;
+	rctx->block_callback_data = block_callback_data;
+	rctx->thread_pool = thread_pool;
+	rctx->threads = threads;
+	rctx->io_block_size = io_block_size;
+	/* the new hash functions can need another number of threads;
+	 * on failure the context just hashes messages in the calling thread */
+	rhash_ctx_setup_threads(rctx);
+	return &rctx->rc;
 }
 
 RHASH_API void rhash_reset(rhash ctx)
@@ -194,6 +379,30 @@ RHASH_API void rhash_reset(rhash ctx)
 	ectx->flags &= ~RCTX_FINALIZED; /* clear finalized state */
 }
 
+/**
+ * A message block, shared by the threads updating algorithms of a context.
+ */
+struct update_job
+{
+	rhash_context_ext* ectx;
+	const void* message;
+	size_t length;
+	unsigned char items[RHASH_HASH_COUNT]; /* indexes of the algorithms to update */
+};
+
+/**
+ * Update the index-th algorithm of a context by the message block.
+ *
+ * @param data the update_job structure
+ * @param index index of the algorithm in the items array of the job
+ */
+static void update_job_item(void* data, unsigned index)
+{
+	struct update_job* job = (struct update_job*)data;
+	rhash_vector_item* item = &job->ectx->vector[job->items[index]];
+	item->hash_info->update(item->context, job->message, job->length);
+}
+
 RHASH_API int rhash_update(rhash ctx, const void* message, size_t length)
 {
 	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
@@ -204,6 +413,27 @@ RHASH_API int rhash_update(rhash ctx, const void* message, size_t length)
 
 	ctx->msg_size += length;
 
+	if (ectx->thread_pool && length >= MIN_THREADED_UPDATE_SIZE) {
+		rhash_thread_pool* pool = (rhash_thread_pool*)ectx->thread_pool;
+		struct update_job job;
+		unsigned count = 0;
+		job.ectx = ectx;
+		job.message = message;
+		job.length = length;
+		for (i = 0; i < ectx->hash_vector_size; i++) {
+			struct rhash_hash_info* info = ectx->vector[i].hash_info;
+			pupdate_mt_t update_mt = rhash_update_mt_by_id(info->info->hash_id);
+			/* a tree hash splits the message block between all threads */
+			if (update_mt)
+				update_mt(ectx->vector[i].context, message, length, pool);
+			else
+				job.items[count++] = (unsigned char)i;
+		}
+		/* every other algorithm reads the same message block in its own thread */
+		rhash_thread_pool_run(pool, update_job_item, &job, count);
+		return 0;
+	}
+
 	/* call update method for every algorithm */
 	for (i = 0; i < ectx->hash_vector_size; i++) {
 		struct rhash_hash_info* info = ectx->vector[i].hash_info;
@@ -213,6 +443,39 @@ RHASH_API int rhash_update(rhash ctx, const void* message, size_t length)
 	return 0; /* no error processing at the moment */
 }
 
+RHASH_API int rhash_updatev(rhash ctx, const rhash_iovec* iov, int count)
+{
+	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
+	unsigned i;
+	int j;
+
+	assert(ectx->hash_vector_size <= RHASH_HASH_COUNT);
+	if (ectx->state != STATE_ACTIVE) return 0; /* do nothing if canceled */
+	if (count < 0 || (count > 0 && !iov)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (ectx->thread_pool) {
+		/* large buffers are split between threads by rhash_update() */
+		for (j = 0; j < count; j++)
+			rhash_update(ctx, iov[j].iov_base, iov[j].iov_len);
+		return 0;
+	}
+
+	for (j = 0; j < count; j++)
+		ctx->msg_size += iov[j].iov_len;
+
+	/* feed all buffers to an algorithm, while its context is in the cache */
+	for (i = 0; i < ectx->hash_vector_size; i++) {
+		struct rhash_hash_info* info = ectx->vector[i].hash_info;
+		assert(info->update != 0);
+		for (j = 0; j < count; j++)
+			info->update(ectx->vector[i].context, iov[j].iov_base, iov[j].iov_len);
+	}
+	return 0;
+}
+
 RHASH_API int rhash_final(rhash ctx, unsigned char* first_result)
 {
 	unsigned i = 0;
@@ -293,13 +556,201 @@ RHASH_API void rhash_set_callback(rhash ctx, rhash_callback_t callback, void* ca
 	((rhash_context_ext*)ctx)->callback_data = callback_data;
 }
 
+RHASH_API void rhash_set_block_callback(rhash ctx, rhash_block_callback_t callback, void* callback_data)
+{
+	((rhash_context_ext*)ctx)->block_callback = (void*)callback;
+	((rhash_context_ext*)ctx)->block_callback_data = callback_data;
+}
+
+/* magic number of an exported context, changed on format change */
+#define EXPORT_MAGIC 0xe8b0de01
+
+/**
+ * The header of an exported rhash context.
+ */
+struct rhash_export_header
+{
+	unsigned magic;
+	unsigned hash_id;      /* ids of the hash functions of the context */
+	unsigned openssl_mask; /* ids of the hash functions implemented by OpenSSL */
+	unsigned flags;
+	uint64_t msg_size;
+	uint64_t io_block_size;
+};
+
+/**
+ * Get ids of the hash functions of a context, which are implemented by
+ * OpenSSL. Contexts of such functions are stored in OpenSSL format.
+ * SHA1, used internally by AICH and BTIH, is also taken into account.
+ *
+ * @param ectx the rhash context
+ * @return the bit-mask of hash ids
+ */
+static unsigned rhash_ctx_openssl_mask(rhash_context_ext* ectx)
+{
+	unsigned mask = 0;
+	unsigned i;
+	for (i = 0; i < ectx->hash_vector_size; i++) {
+		struct rhash_hash_info* info = ectx->vector[i].hash_info;
+		unsigned hash_id = info->info->hash_id;
+		if ((hash_id & (RHASH_AICH | RHASH_BTIH)) != 0) {
+			info = &rhash_info_table[3];
+			hash_id = RHASH_SHA1;
+		}
+		if (info->init != rhash_hash_info_default[rhash_ctz(hash_id)].init)
+			mask |= hash_id;
+	}
+	return mask;
+}
+
+/**
+ * Export the context of one hash function.
+ *
+ * @param item the hash function and its context
+ * @param out the buffer to export the context into, can be NULL
+ * @param size size of the buffer
+ * @return the size of exported data, 0 if the buffer is too small
+ */
+static size_t rhash_export_item(rhash_vector_item* item, void* out, size_t size)
+{
+	unsigned hash_id = item->hash_info->info->hash_id;
+	size_t context_size = item->hash_info->context_size;
+	if (hash_id == RHASH_BTIH)
+		return bt_export((torrent_ctx*)item->context, out, size);
+	if (hash_id == RHASH_AICH)
+		return rhash_aich_export((aich_ctx*)item->context, out, size);
+	if (out) {
+		if (size < context_size) return 0;
+		memcpy(out, item->context, context_size);
+	}
+	return context_size;
+}
+
+/**
+ * Import the context of one hash function.
+ *
+ * @param item the hash function and its initialized context
+ * @param in the exported data
+ * @param size size of the exported data
+ * @return the size of imported data, 0 on error
+ */
+static size_t rhash_import_item(rhash_vector_item* item, const void* in, size_t size)
+{
+	unsigned hash_id = item->hash_info->info->hash_id;
+	size_t context_size = item->hash_info->context_size;
+	if (hash_id == RHASH_BTIH)
+		return bt_import((torrent_ctx*)item->context, in, size);
+	if (hash_id == RHASH_AICH)
+		return rhash_aich_import((aich_ctx*)item->context, in, size);
+	if (size < context_size) return 0;
+	memcpy(item->context, in, context_size);
+	return context_size;
+}
+
+RHASH_API size_t rhash_export(rhash ctx, void* out, size_t size)
+{
+	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
+	struct rhash_export_header header;
+	size_t export_size = sizeof(header);
+	char* p = (char*)out;
+	unsigned i;
+
+	/* a canceled context can be exported to continue hashing later */
+	if (ctx == NULL || (ectx->state != STATE_ACTIVE && ectx->state != STATE_STOPED) ||
+			(ectx->flags & RCTX_FINALIZED)) {
+		errno = EINVAL;
+		return 0;
+	}
+	for (i = 0; i < ectx->hash_vector_size; i++)
+		export_size += rhash_export_item(&ectx->vector[i], NULL, 0);
+	if (out == NULL) return export_size;
+	if (size < export_size) {
+		errno = ENOMEM;
+		return 0;
+	}
+
+	header.magic = EXPORT_MAGIC;
+	header.hash_id = ctx->hash_id;
+	header.openssl_mask = rhash_ctx_openssl_mask(ectx);
+	header.flags = ectx->flags;
+	header.msg_size = ctx->msg_size;
+	header.io_block_size = ectx->io_block_size;
+	memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	for (i = 0; i < ectx->hash_vector_size; i++)
+		p += rhash_export_item(&ectx->vector[i], p, export_size - (p - (char*)out));
+	assert((size_t)(p - (char*)out) == export_size);
+	return export_size;
+}
+
+RHASH_API rhash rhash_import(const void* in, size_t size)
+{
+	struct rhash_export_header header;
+	rhash_context_ext* ectx;
+	const char* p = (const char*)in;
+	size_t item_size;
+	unsigned i;
+
+	if (in == NULL || size < sizeof(header)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	memcpy(&header, p, sizeof(header));
+	if (header.magic != EXPORT_MAGIC || header.hash_id == 0 ||
+			(header.hash_id & RHASH_ALL_HASHES) != header.hash_id ||
+			(header.flags & RCTX_FINALIZED) != 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	ectx = (rhash_context_ext*)rhash_init(header.hash_id);
+	if (ectx == NULL) return NULL;
+
+	/* contexts are portable only between the same hash implementations */
+	if (header.openssl_mask != rhash_ctx_openssl_mask(ectx)) {
+		rhash_free(&ectx->rc);
+		errno = EINVAL;
+		return NULL;
+	}
+	p += sizeof(header);
+	size -= sizeof(header);
+	for (i = 0; i < ectx->hash_vector_size; i++) {
+		item_size = rhash_import_item(&ectx->vector[i], p, size);
+		if (item_size == 0) {
+			rhash_free(&ectx->rc);
+			errno = EINVAL;
+			return NULL;
+		}
+		p += item_size;
+		size -= item_size;
+	}
+	ectx->rc.msg_size = header.msg_size;
+	ectx->flags = header.flags & ~RCTX_INPLACE;
+	if (header.io_block_size > 0 && header.io_block_size <= MAX_IO_BLOCK_SIZE)
+		ectx->io_block_size = (size_t)header.io_block_size;
+	return &ectx->rc;
+}
+
 /* HIGH-LEVEL LIBRHASH INTERFACE */
 
 RHASH_API int rhash_msg(unsigned hash_id, const void* message, size_t length, unsigned char* result)
 {
+	uint64_t context[MSG_CONTEXT_SIZE / 8];
 	rhash ctx;
 	hash_id &= RHASH_ALL_HASHES;
-	ctx = rhash_init(hash_id);
+	if (hash_id != 0 && (hash_id & (hash_id - 1)) == 0) {
+		/* fast path for a single algorithm: call its functions directly */
+		struct rhash_hash_info* info = &rhash_info_table[rhash_ctz(hash_id)];
+		if (info->context_size <= sizeof(context) && info->cleanup == 0 && result) {
+			info->init(context);
+			info->update(context, message, length);
+			info->final(context, result);
+			return 0;
+		}
+	}
+	if (rhash_get_context_size(hash_id) <= sizeof(context))
+		ctx = rhash_init_inplace(hash_id, context, sizeof(context));
+	else
+		ctx = rhash_init(hash_id); /* the context is too large for the stack buffer */
 	if (ctx == NULL) return -1;
 	rhash_update(ctx, message, length);
 	rhash_final(ctx, result);
@@ -307,6 +758,106 @@ RHASH_API int rhash_msg(unsigned hash_id, const void* message, size_t length, un
 	return 0;
 }
 
+RHASH_API int rhash_msg_batch(unsigned hash_id, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count)
+{
+	size_t i;
+	hash_id &= RHASH_ALL_HASHES;
+	if (hash_id == 0 || (hash_id & (hash_id - 1)) != 0) {
+		errno = EINVAL;
+		return -1; /* exactly one hash algorithm must be specified */
+	}
+	if (rhash_mb_is_supported(hash_id)) {
+		rhash_mb_hash(hash_id, messages, lengths, results, count);
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		if (rhash_msg(hash_id, messages[i], lengths[i], results[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* the number of messages hashed together by a thread of rhash_msg_batch_mt() */
+#define MT_BATCH_GROUP 4
+
+/**
+ * Messages hashed by threads of rhash_msg_batch_mt().
+ */
+struct msg_batch_job
+{
+	unsigned hash_id;
+	const void** messages;
+	const size_t* lengths;
+	unsigned char** results;
+	size_t count;
+	int error;
+};
+
+/**
+ * Hash a group of messages of a batch job.
+ *
+ * @param data the msg_batch_job structure
+ * @param index index of the group of messages
+ */
+static void msg_batch_job_item(void* data, unsigned index)
+{
+	struct msg_batch_job* job = (struct msg_batch_job*)data;
+	size_t first = (size_t)index * MT_BATCH_GROUP;
+	size_t count = job->count - first;
+	if (count > MT_BATCH_GROUP) count = MT_BATCH_GROUP;
+
+	if (rhash_msg_batch(job->hash_id, job->messages + first, job->lengths + first,
+			job->results + first, count) < 0)
+		job->error = 1;
+}
+
+/**
+ * Compute hashes of several messages by one hash algorithm, splitting
+ * the messages between threads of the given pool. Every thread hashes
+ * a group of messages by rhash_msg_batch().
+ *
+ * @param hash_id id of a single hash sum to compute
+ * @param messages array of messages to process
+ * @param lengths array of message lengths
+ * @param results array of buffers to receive binary hash strings
+ * @param count number of messages
+ * @param pool the thread pool, can be NULL
+ * @return 0 on success, -1 on error
+ */
+int rhash_msg_batch_mt(unsigned hash_id, const void* messages[], const size_t lengths[],
+	unsigned char* results[], size_t count, rhash_thread_pool* pool)
+{
+	struct msg_batch_job job;
+	job.hash_id = hash_id;
+	job.messages = messages;
+	job.lengths = lengths;
+	job.results = results;
+	job.count = count;
+	job.error = 0;
+	rhash_thread_pool_run(pool, msg_batch_job_item, &job,
+		(unsigned)((count + MT_BATCH_GROUP - 1) / MT_BATCH_GROUP));
+	return (job.error ? -1 : 0);
+}
+
+/**
+ * Hash a block of a file, and pass it to the callbacks of the context.
+ *
+ * @param ectx the rhash context
+ * @param block the file block
+ * @param length the size of the block
+ */
+static void rhash_update_block(rhash_context_ext* ectx, const unsigned char* block, size_t length)
+{
+	rhash_update(&ectx->rc, block, length);
+
+	if (ectx->block_callback) {
+		((rhash_block_callback_t)ectx->block_callback)(ectx->block_callback_data, block, length);
+	}
+	if (ectx->callback) {
+		((rhash_callback_t)ectx->callback)(ectx->callback_data, ectx->rc.msg_size);
+	}
+}
+
 RHASH_API int rhash_file_update(rhash ctx, FILE* fd)
 {
 	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
@@ -337,21 +888,89 @@ RHASH_API int rhash_file_update(rhash ctx, FILE* fd)
 			res = -1; /* note: errno contains error code */
 			break;
 		} else if (length) {
-			rhash_update(ctx, buffer, length);
+			rhash_update_block(ectx, buffer, length);
+		}
+	}
+
+	free(pmem);
+	return res;
+}
+
+RHASH_API int rhash_fd_update(rhash ctx, int fd)
+{
+	rhash_context_ext* const ectx = (rhash_context_ext*)ctx;
+	const size_t block_size = ectx->io_block_size;
+	rhash_read_ahead* reader = NULL;
+	rhash_io io;
+	unsigned char *buffer, *pmem;
+	size_t align;
+	long length;
+	int first_block = 1;
+	int save_errno;
+	int res = 0;
+	if (ectx->state != STATE_ACTIVE) return 0; /* do nothing if canceled */
+
+	/* buffer is aligned by a page boundary to speed up kernel copying */
+	pmem = (unsigned char*)malloc(block_size + IO_BLOCK_ALIGN);
+	if (!pmem) return -1; /* errno is set to ENOMEM according to UNIX 98 */
+	align = ((unsigned char*)0 - pmem) & (IO_BLOCK_ALIGN - 1);
+	buffer = pmem + align;
+
+	rhash_io_open(&io, fd, (ectx->flags & RCTX_DIRECT_IO));
+#if defined(POSIX_FADV_SEQUENTIAL)
+	/* ask the kernel for more aggressive read-ahead */
+	if (!(io.flags & RHASH_IO_DIRECT))
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
-			if (ectx->callback) {
-				((rhash_callback_t)ectx->callback)(ectx->callback_data, ectx->rc.msg_size);
+	while (ectx->state == STATE_ACTIVE) {
+		length = rhash_io_read(&io, buffer, block_size);
+		if (length < 0) {
+			res = -1; /* note: errno contains error code */
+			break;
+		} else if (length == 0) {
+			break; /* end of file */
+		}
+		rhash_update_block(ectx, buffer, (size_t)length);
+
+		/* the file is longer than one block, so read the rest of it
+		 * by a background thread, while hashing already loaded blocks */
+		if (first_block) {
+			first_block = 0;
+			if ((size_t)length == block_size &&
+					(reader = rhash_read_ahead_new(&io, block_size)) != NULL)
+				break;
+		}
+	}
+
+	if (reader) {
+		free(pmem);
+		pmem = NULL;
+		while (ectx->state == STATE_ACTIVE) {
+			length = rhash_read_ahead_next(reader, &buffer);
+			if (length <= 0) {
+				if (length < 0) res = -1;
+				break;
 			}
+			rhash_update_block(ectx, buffer, (size_t)length);
 		}
+		save_errno = errno;
+		rhash_read_ahead_free(reader);
+		errno = save_errno;
 	}
 
-	free(buffer);
+	rhash_io_close(&io);
+	free(pmem);
 	return res;
 }
 
+#ifndef O_BINARY
+# define O_BINARY 0
+#endif
+
 RHASH_API int rhash_file(unsigned hash_id, const char* filepath, unsigned char* result)
 {
-	FILE* fd;
+	int fd;
 	rhash ctx;
 	int res;
 
@@ -361,15 +980,15 @@ RHASH_API int rhash_file(unsigned hash_id, const char* filepath, unsigned char*
 		return -1;
 	}
 
-	if ((fd = fopen(filepath, "rb")) == NULL) return -1;
+	if ((fd = rhash_open(filepath, O_RDONLY | O_BINARY)) < 0) return -1;
 
 	if ((ctx = rhash_init(hash_id)) == NULL) {
-		fclose(fd);
+		rhash_close(fd);
 		return -1;
 	}
 
-	res = rhash_file_update(ctx, fd); /* hash the file */
-	fclose(fd);
+	res = rhash_fd_update(ctx, fd); /* hash the file */
+	rhash_close(fd);
 
 	rhash_final(ctx, result);
 	rhash_free(ctx);
@@ -467,7 +1086,7 @@ static size_t rhash_get_magnet_url_size(const char* filepath,
 	}
 
 	/* loop through hash values */
-	for (bit = hash & -(int)hash; bit <= hash; bit <<= 1) {
+	for (bit = hash & (0u - hash); bit != 0 && bit <= hash; bit <<= 1) {
 		const char* name;
 		if ((bit & hash) == 0) continue;
 		if ((name = rhash_get_magnet_name(bit)) == 0) continue;
@@ -518,7 +1137,7 @@ RHASH_API size_t rhash_print_magnet(char* output, const char* filepath,
 		if (!hash) continue;
 
 		/* loop through hash values */
-		for (bit = hash & -(int)hash; bit <= hash; bit <<= 1) {
+		for (bit = hash & (0u - hash); bit != 0 && bit <= hash; bit <<= 1) {
 			const char* name;
 			if ((bit & hash) == 0) continue;
 			if (!(name = rhash_get_magnet_name(bit))) continue;
@@ -713,6 +1332,18 @@ RHASH_API rhash_uptr_t rhash_transmit(unsigned msg_id, void* dst, rhash_uptr_t l
 		ctx->flags &= ~RCTX_AUTO_FINAL;
 		if (ldata) ctx->flags |= RCTX_AUTO_FINAL;
 		break;
+	case RMSG_SET_DIRECT_IO:
+		ctx->flags &= ~RCTX_DIRECT_IO;
+		if (ldata) ctx->flags |= RCTX_DIRECT_IO;
+		break;
+	case RMSG_SET_IO_BLOCK_SIZE:
+		if (ldata == 0 || ldata > MAX_IO_BLOCK_SIZE) return RHASH_ERROR;
+		ctx->io_block_size = ((size_t)ldata + IO_BLOCK_ALIGN - 1) & ~(size_t)(IO_BLOCK_ALIGN - 1);
+		break;
+	case RMSG_SET_THREADS:
+		ctx->threads = (unsigned)ldata;
+		if (rhash_ctx_setup_threads(ctx) < 0) return RHASH_ERROR;
+		break;
 
 	/* OpenSSL related messages */
 #ifdef USE_OPENSSL
@@ -51,27 +51,35 @@ enum rhash_ids
 	RHASH_CRC32C    = 0x4000000,
 	RHASH_SNEFRU128 = 0x8000000,
 	RHASH_SNEFRU256 = 0x10000000,
-
-	/**
-	 * The bit-mask containing all supported hashe functions.
-	 */
-	RHASH_ALL_HASHES = RHASH_CRC32 | RHASH_CRC32C | RHASH_MD4 | RHASH_MD5 |
-		RHASH_ED2K | RHASH_SHA1 |RHASH_TIGER | RHASH_TTH |
-		RHASH_GOST94 | RHASH_GOST94_CRYPTOPRO | RHASH_GOST12_256 | RHASH_GOST12_512 |
-		RHASH_BTIH | RHASH_AICH | RHASH_WHIRLPOOL | RHASH_RIPEMD160 |
-		RHASH_HAS160 | RHASH_SNEFRU128 | RHASH_SNEFRU256 |
-		RHASH_SHA224 | RHASH_SHA256 | RHASH_SHA384 | RHASH_SHA512 |
-		RHASH_SHA3_224 | RHASH_SHA3_256 | RHASH_SHA3_384 | RHASH_SHA3_512 |
-		RHASH_EDONR256 | RHASH_EDONR512,
+	RHASH_BLAKE2S   = 0x20000000,
+	RHASH_BLAKE2B   = 0x40000000,
 
 	RHASH_GOST = RHASH_GOST94, /* deprecated constant name */
 	RHASH_GOST_CRYPTOPRO = RHASH_GOST94_CRYPTOPRO, /* deprecated constant name */
 	/**
 	 * The number of supported hash functions.
 	 */
-	RHASH_HASH_COUNT = 29
+	RHASH_HASH_COUNT = 32
 };
 
+/*
+ * The identifiers below don't fit into the int range of an enum constant
+ * (ISO C), so they are defined as unsigned macros.
+ */
+#define RHASH_BLAKE3 0x80000000u
+
+/**
+ * The bit-mask containing all supported hash functions.
+ */
+#define RHASH_ALL_HASHES (RHASH_CRC32 | RHASH_CRC32C | RHASH_MD4 | RHASH_MD5 | \
+	RHASH_ED2K | RHASH_SHA1 | RHASH_TIGER | RHASH_TTH | \
+	RHASH_GOST94 | RHASH_GOST94_CRYPTOPRO | RHASH_GOST12_256 | RHASH_GOST12_512 | \
+	RHASH_BTIH | RHASH_AICH | RHASH_WHIRLPOOL | RHASH_RIPEMD160 | \
+	RHASH_HAS160 | RHASH_SNEFRU128 | RHASH_SNEFRU256 | \
+	RHASH_SHA224 | RHASH_SHA256 | RHASH_SHA384 | RHASH_SHA512 | \
+	RHASH_SHA3_224 | RHASH_SHA3_256 | RHASH_SHA3_384 | RHASH_SHA3_512 | \
+	RHASH_EDONR256 | RHASH_EDONR512 | RHASH_BLAKE2S | RHASH_BLAKE2B | RHASH_BLAKE3)
+
 /**
  * The rhash context structure contains contexts for several hash functions.
  */
@@ -101,6 +109,11 @@ typedef struct rhash_context* rhash;
  */
 typedef void (*rhash_callback_t)(void* data, unsigned long long offset);
 
+/**
+ * Type of a callback receiving every hashed block of a file.
+ */
+typedef void (*rhash_block_callback_t)(void* data, const void* block, size_t size);
+
 /**
  * Initialize static data of rhash algorithms
  */
@@ -120,6 +133,21 @@ RHASH_API void rhash_library_init(void);
  */
 RHASH_API int rhash_msg(unsigned hash_id, const void* message, size_t length, unsigned char* result);
 
+/**
+ * Compute hashes of several messages by one hash algorithm.
+ * For MD5, SHA1, SHA224, SHA256 and the SHA3 family the messages are
+ * hashed in parallel by SIMD instructions, if supported by the CPU,
+ * which is much faster than hashing many short messages one by one.
+ *
+ * @param hash_id id of a single hash sum to compute
+ * @param messages array of messages to process
+ * @param lengths array of message lengths
+ * @param results array of buffers to receive binary hash strings
+ * @param count number of messages
+ * @return 0 on success, -1 on error
+ */
+RHASH_API int rhash_msg_batch(unsigned hash_id, const void* messages[], const size_t lengths[], unsigned char* results[], size_t count);
+
 /**
  * Compute a single hash for given file.
  *
@@ -155,6 +183,28 @@ RHASH_API int rhash_wfile(unsigned hash_id, const wchar_t* filepath, unsigned ch
  */
 RHASH_API rhash rhash_init(unsigned hash_id);
 
+/**
+ * Get the size of memory needed by rhash_init_inplace() to store
+ * a context for calculating the given hash(es).
+ *
+ * @param hash_id union of bit flags, containing ids of hashes to calculate.
+ * @return the context size in bytes, 0 on error and errno is set
+ */
+RHASH_API size_t rhash_get_context_size(unsigned hash_id);
+
+/**
+ * Initialize RHash context in a memory block provided by the caller,
+ * e.g. in a buffer on the stack, without allocating any memory.
+ * The context is used as the one returned by rhash_init(), and shall be
+ * released by rhash_free(), which doesn't free the memory block itself.
+ *
+ * @param hash_id union of bit flags, containing ids of hashes to calculate.
+ * @param mem the memory block, aligned by 8 bytes
+ * @param size the size of the memory block, see rhash_get_context_size()
+ * @return initialized rhash context, NULL on error and errno is set
+ */
+RHASH_API rhash rhash_init_inplace(unsigned hash_id, void* mem, size_t size);
+
 /**
  * Calculate hashes of message.
  * Can be called repeatedly with chunks of the message to be hashed.
@@ -166,6 +216,29 @@ RHASH_API rhash rhash_init(unsigned hash_id);
  */
 RHASH_API int rhash_update(rhash ctx, const void* message, size_t length);
 
+/**
+ * A message buffer for rhash_updatev().
+ * The structure has the same layout as the POSIX struct iovec.
+ */
+typedef struct rhash_iovec
+{
+	const void* iov_base; /* the start of the buffer */
+	size_t iov_len; /* the length of the buffer */
+} rhash_iovec;
+
+/**
+ * Calculate hashes of several message chunks, stored in separate buffers.
+ * The result is the same as of calling rhash_update() for every buffer,
+ * but each hash function processes all the buffers at once, which is
+ * faster for many small buffers.
+ *
+ * @param ctx the rhash context
+ * @param iov array of the buffers to hash
+ * @param count number of the buffers
+ * @return 0 on success; On fail return -1 and set errno
+ */
+RHASH_API int rhash_updatev(rhash ctx, const rhash_iovec* iov, int count);
+
 /**
  * Hash a file or stream. Multiple hashes can be computed.
  * First, inintialize ctx parameter with rhash_init() before calling
@@ -179,6 +252,18 @@ RHASH_API int rhash_update(rhash ctx, const void* message, size_t length);
  */
 RHASH_API int rhash_file_update(rhash ctx, FILE* fd);
 
+/**
+ * Hash a file, given by an open file descriptor. Unlike rhash_file_update(),
+ * the file is read by large blocks directly into an aligned buffer, without
+ * stdio buffering. The block size can be changed by rhash_set_io_block_size().
+ * The file descriptor is read from its current position till the end of file.
+ *
+ * @param ctx rhash context
+ * @param fd file descriptor opened for reading
+ * @return 0 on success, -1 on error and errno is set
+ */
+RHASH_API int rhash_fd_update(rhash ctx, int fd);
+
 /**
  * Finalize hash calculation and optionally store the first hash.
  *
@@ -196,6 +281,22 @@ RHASH_API int rhash_final(rhash ctx, unsigned char* first_result);
  */
 RHASH_API void rhash_reset(rhash ctx);
 
+/**
+ * Re-initialize RHash context to calculate another set of hashes.
+ * The memory of the context is reused, if it is large enough, otherwise
+ * a new context is allocated and the old one is freed. The callbacks,
+ * I/O settings and the auto-final flag of the context are kept. The number
+ * of threads, set by rhash_set_threads(), is applied to the new hashes.
+ * Useful to speed up processing of many small messages, hashed by
+ * different sets of hash functions.
+ *
+ * @param ctx context to reinitialize
+ * @param hash_id union of bit flags, containing ids of hashes to calculate.
+ * @return the re-initialized context, which can differ from ctx;
+ *         On fail return NULL, set errno and keep ctx unchanged
+ */
+RHASH_API rhash rhash_reinit(rhash ctx, unsigned hash_id);
+
 /**
  * Free RHash context memory.
  *
@@ -203,11 +304,39 @@ RHASH_API void rhash_reset(rhash ctx);
  */
 RHASH_API void rhash_free(rhash ctx);
 
+/**
+ * Export the state of a context into a memory buffer, to continue hashing
+ * later by a context restored with rhash_import(). The state includes the
+ * contexts of all hash functions of the context, the hashed message size,
+ * the torrent files, announce URLs and program name. The callback and
+ * threads of the context are not exported.
+ * Exported data can be imported only by the same build of the library,
+ * using the same OpenSSL algorithms.
+ * If out is NULL, then the function returns the size of the data to export.
+ *
+ * @param ctx the rhash context to export, can be canceled, but must not be finalized
+ * @param out the buffer to store exported data, can be NULL
+ * @param size the size of the buffer
+ * @return the size of exported data on success; On fail return 0 and set errno
+ */
+RHASH_API size_t rhash_export(rhash ctx, void* out, size_t size);
+
+/**
+ * Create a new rhash context, restoring a state saved by rhash_export().
+ * The returned context must be freed by rhash_free().
+ *
+ * @param in the exported data
+ * @param size the size of the exported data
+ * @return the imported context on success; On fail return NULL and set errno
+ */
+RHASH_API rhash rhash_import(const void* in, size_t size);
+
 /**
  * Set the callback function to be called from the
- * rhash_file() and rhash_file_update() functions
- * on processing every file block. The file block
- * size is set internally by rhash and now is 8 KiB.
+ * rhash_file(), rhash_file_update() and rhash_fd_update() functions
+ * on processing every file block. The file block size is 8 KiB for
+ * rhash_file_update(), and is set by rhash_set_io_block_size() for
+ * rhash_fd_update() and rhash_file().
  *
  * @param ctx rhash context
  * @param callback pointer to the callback function
@@ -215,6 +344,18 @@ RHASH_API void rhash_free(rhash ctx);
  */
 RHASH_API void  rhash_set_callback(rhash ctx, rhash_callback_t callback, void* callback_data);
 
+/**
+ * Set the callback function to be called from the rhash_file_update() and
+ * rhash_fd_update() functions with every file block, after the block is
+ * hashed and before the callback set by rhash_set_callback() is called.
+ * It allows to process the file content without reading the file twice.
+ *
+ * @param ctx rhash context
+ * @param callback pointer to the callback function, NULL to remove it
+ * @param callback_data pointer to data passed to the callback
+ */
+RHASH_API void  rhash_set_block_callback(rhash ctx, rhash_block_callback_t callback, void* callback_data);
+
 
 /* INFORMATION FUNCTIONS */
 
@@ -413,6 +554,9 @@ RHASH_API rhash_uptr_t rhash_transmit(
 #define RMSG_IS_CANCELED 3
 #define RMSG_GET_FINALIZED 4
 #define RMSG_SET_AUTOFINAL 5
+#define RMSG_SET_THREADS 6
+#define RMSG_SET_IO_BLOCK_SIZE 7
+#define RMSG_SET_DIRECT_IO 8
 #define RMSG_SET_OPENSSL_MASK 10
 #define RMSG_GET_OPENSSL_MASK 11
 #define RMSG_GET_OPENSSL_SUPPORTED_MASK 12
@@ -462,6 +606,34 @@ RHASH_API rhash_uptr_t rhash_transmit(
  */
 #define rhash_set_autofinal(ctx, on) rhash_transmit(RMSG_SET_AUTOFINAL, ctx, on, 0)
 
+/**
+ * Set the number of threads used by rhash_update() to calculate the hash
+ * functions of the given rhash_context in parallel. Every thread processes
+ * whole message blocks for its own subset of algorithms, so it is useful
+ * for a context containing several hash functions. Tree hashes are
+ * exceptions: TTH leaves, BitTorrent pieces, ED2K chunks and AICH blocks
+ * of large message blocks are split between all threads, giving the same
+ * hash values and torrent files as a single-threaded context. The value 0 or 1 turns
+ * multi-threading off. Return RHASH_ERROR if threads can't be started or
+ * LibRHash is compiled without threads support.
+ */
+#define rhash_set_threads(ctx, count) rhash_transmit(RMSG_SET_THREADS, ctx, count, 0)
+
+/**
+ * Set the size of blocks read from a file by rhash_fd_update().
+ * The size is rounded up to a multiple of 4 KiB, the default is 64 KiB,
+ * the maximum is 64 MiB.
+ */
+#define rhash_set_io_block_size(ctx, size) rhash_transmit(RMSG_SET_IO_BLOCK_SIZE, ctx, size, 0)
+
+/**
+ * Turn on/off reading files by rhash_fd_update() bypassing
+ * the page cache. The file descriptor is switched to the O_DIRECT mode for
+ * the time of reading. If O_DIRECT is not supported, the read pages are
+ * dropped from the page cache by posix_fadvise(POSIX_FADV_DONTNEED).
+ */
+#define rhash_set_direct_io(ctx, on) rhash_transmit(RMSG_SET_DIRECT_IO, ctx, on, 0)
+
 /**
  * Set the bit-mask of hash algorithms to be calculated by OpenSSL library.
  * The call rhash_set_openssl_mask(0) made before rhash_library_init(),
@@ -33,6 +33,12 @@ RHASH_API int rhash_torrent_add_file(rhash ctx, const char* filepath, unsigned l
 	return bt_add_file(BT_CTX(ctx), filepath, filesize);
 }
 
+RHASH_API int rhash_torrent_add_piece_hashes(rhash ctx, const unsigned char* hashes, size_t count)
+{
+	if (!BT_CTX(ctx)) return 0;
+	return bt_add_piece_hashes(BT_CTX(ctx), hashes, count);
+}
+
 RHASH_API void rhash_torrent_set_options(rhash ctx, unsigned options)
 {
 	if (!BT_CTX(ctx)) return;
@@ -65,6 +71,22 @@ RHASH_API size_t rhash_torrent_get_default_piece_length(unsigned long long total
 RHASH_API const rhash_str* rhash_torrent_generate_content(rhash ctx)
 {
 	torrent_ctx *tc = BT_CTX(ctx);
-	if (!tc || tc->error || !tc->content.str) return 0;
+	char* str;
+	if (!tc) return 0;
+	if (tc->options & BT_OPT_STREAM) bt_get_text(tc, &str);
+	if (tc->error || !tc->content.str) return 0;
 	return (rhash_str*)(&tc->content);
 }
+
+RHASH_API int rhash_torrent_check_content(rhash ctx)
+{
+	torrent_ctx *tc = BT_CTX(ctx);
+	return (tc && !tc->error ? 0 : -1);
+}
+
+RHASH_API int rhash_torrent_write_content(rhash ctx, rhash_torrent_write_t write, void* data)
+{
+	torrent_ctx *tc = BT_CTX(ctx);
+	if (!tc) return -1;
+	return bt_write_content(tc, write, data);
+}
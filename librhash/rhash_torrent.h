@@ -38,6 +38,23 @@ typedef struct rhash_str
  * Torrent option: calculate infohash without torrent file body.
  */
 #define RHASH_TORRENT_OPT_INFOHASH_ONLY 2
+/**
+ * Torrent option: keep memory usage bounded for huge torrents. Hashes of
+ * file pieces are moved to a temporary file, and the torrent file content
+ * is not generated by rhash_final(), it should be written by
+ * rhash_torrent_write_content().
+ */
+#define RHASH_TORRENT_OPT_STREAM 4
+
+/**
+ * Callback to write a part of the torrent file content.
+ *
+ * @param data the data passed to rhash_torrent_write_content()
+ * @param buffer the part of the content to write
+ * @param size the size of the part
+ * @return non-negative value on success, negative value on error
+ */
+typedef int (*rhash_torrent_write_t)(void* data, const void* buffer, size_t size);
 
 /* torrent functions */
 
@@ -51,6 +68,19 @@ typedef struct rhash_str
  */
 RHASH_API int  rhash_torrent_add_file(rhash ctx, const char* filepath, unsigned long long filesize);
 
+/**
+ * Add SHA1 hashes of file pieces, calculated before, instead of hashing
+ * the pieces data. E.g. the hashes can be loaded from an existing torrent
+ * file, having the same piece length. Must be called at a piece boundary,
+ * before any data is hashed or after hashing whole pieces.
+ *
+ * @param ctx rhash context
+ * @param hashes the 20-byte SHA1 hashes of consecutive pieces
+ * @param count the number of the hashes
+ * @return non-zero on success, zero on fail
+ */
+RHASH_API int  rhash_torrent_add_piece_hashes(rhash ctx, const unsigned char* hashes, size_t count);
+
 /**
  * Set the torrent algorithm options.
  *
@@ -114,6 +144,28 @@ RHASH_API size_t rhash_torrent_get_default_piece_length(unsigned long long total
  */
 RHASH_API const rhash_str* rhash_torrent_generate_content(rhash ctx);
 
+/**
+ * Check that the torrent file content can be generated, i.e. the context
+ * calculates BTIH and no error occurred while collecting the torrent data.
+ * The check is cheap and allows to fail before creating the torrent file.
+ *
+ * @param ctx rhash context
+ * @return 0 if the content can be generated, -1 otherwise
+ */
+RHASH_API int rhash_torrent_check_content(rhash ctx);
+
+/**
+ * Write the content of the generated torrent file by the given callback,
+ * part by part, without keeping the whole content in memory.
+ * The function should be called after rhash_final().
+ *
+ * @param ctx rhash context
+ * @param write the callback to write the content by
+ * @param data the data to pass to the callback
+ * @return 0 on success, -1 on fail
+ */
+RHASH_API int rhash_torrent_write_content(rhash ctx, rhash_torrent_write_t write, void* data);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
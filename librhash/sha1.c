@@ -43,7 +43,7 @@ void rhash_sha1_init(sha1_ctx *ctx)
  * @param hash algorithm state
  * @param block the message block to process
  */
-static void rhash_sha1_process_block(unsigned* hash, const unsigned* block)
+static void rhash_sha1_process_block_soft(unsigned* hash, const unsigned* block)
 {
 	int           t;                 /* Loop counter */
 	uint32_t      temp;              /* Temporary word value */
@@ -113,6 +113,118 @@ static void rhash_sha1_process_block(unsigned* hash, const unsigned* block)
 	hash[4] += E;
 }
 
+#if defined(HAS_INTEL_SHA_NI)
+#include <immintrin.h>
+
+/* process 4 rounds, and update the message schedule for following rounds */
+#define SHA1_NI_ROUNDS4(g) { \
+	if ((g) < 4) MSG[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)block + (g)), MASK); \
+	if ((g) == 0) E0 = _mm_add_epi32(E0, MSG[0]); \
+	else if ((g) & 1) E1 = _mm_sha1nexte_epu32(E1, MSG[(g) & 3]); \
+	else E0 = _mm_sha1nexte_epu32(E0, MSG[(g) & 3]); \
+	if ((g) & 1) { E0 = ABCD; ABCD = _mm_sha1rnds4_epu32(ABCD, E1, (g) / 5); } \
+	else { E1 = ABCD; ABCD = _mm_sha1rnds4_epu32(ABCD, E0, (g) / 5); } \
+	if ((g) >= 3 && (g) <= 18) MSG[((g) + 1) & 3] = _mm_sha1msg2_epu32(MSG[((g) + 1) & 3], MSG[(g) & 3]); \
+	if ((g) >= 1 && (g) <= 16) MSG[((g) + 3) & 3] = _mm_sha1msg1_epu32(MSG[((g) + 3) & 3], MSG[(g) & 3]); \
+	if ((g) >= 2 && (g) <= 17) MSG[((g) + 2) & 3] = _mm_xor_si128(MSG[((g) + 2) & 3], MSG[(g) & 3]); \
+}
+
+/**
+ * Process a 512-bit block using the Intel SHA extensions.
+ *
+ * @param hash algorithm state
+ * @param block the message block to process
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void rhash_sha1_process_block_accel(unsigned* hash, const unsigned* block)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+	__m128i MSG[4];
+
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)hash), 0x1B);
+	E0 = _mm_set_epi32((int)hash[4], 0, 0, 0);
+	ABCD_SAVE = ABCD;
+	E0_SAVE = E0;
+
+	SHA1_NI_ROUNDS4(0);  SHA1_NI_ROUNDS4(1);  SHA1_NI_ROUNDS4(2);  SHA1_NI_ROUNDS4(3);
+	SHA1_NI_ROUNDS4(4);  SHA1_NI_ROUNDS4(5);  SHA1_NI_ROUNDS4(6);  SHA1_NI_ROUNDS4(7);
+	SHA1_NI_ROUNDS4(8);  SHA1_NI_ROUNDS4(9);  SHA1_NI_ROUNDS4(10); SHA1_NI_ROUNDS4(11);
+	SHA1_NI_ROUNDS4(12); SHA1_NI_ROUNDS4(13); SHA1_NI_ROUNDS4(14); SHA1_NI_ROUNDS4(15);
+	SHA1_NI_ROUNDS4(16); SHA1_NI_ROUNDS4(17); SHA1_NI_ROUNDS4(18); SHA1_NI_ROUNDS4(19);
+
+	E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+	ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+	_mm_storeu_si128((__m128i*)hash, _mm_shuffle_epi32(ABCD, 0x1B));
+	hash[4] = (unsigned)_mm_extract_epi32(E0, 3);
+}
+# define HAS_SHA1_ACCEL() (has_cpu_feature(CPU_FEATURE_SHA) && \
+	has_cpu_feature(CPU_FEATURE_SSSE3) && has_cpu_feature(CPU_FEATURE_SSE4_1))
+
+#elif defined(HAS_ARM_SHA)
+#include <arm_neon.h>
+
+/**
+ * Process a 512-bit block using the ARMv8 cryptography extension.
+ *
+ * @param hash algorithm state
+ * @param block the message block to process
+ */
+# if defined(__clang__)
+__attribute__((target("crypto")))
+# else
+__attribute__((target("+crypto")))
+# endif
+static void rhash_sha1_process_block_accel(unsigned* hash, const unsigned* block)
+{
+	static const uint32_t K[4] = { 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6 };
+	const uint8_t* data = (const uint8_t*)block;
+	uint32x4_t ABCD, ABCD_SAVE, TMP;
+	uint32x4_t MSG[4];
+	uint32_t E0, E1;
+	int g;
+
+	ABCD = ABCD_SAVE = vld1q_u32(hash);
+	E0 = hash[4];
+	for (g = 0; g < 4; g++)
+		MSG[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + g * 16)));
+
+	for (g = 0; g < 20; g++) {
+		TMP = vaddq_u32(MSG[g & 3], vdupq_n_u32(K[g / 5]));
+		E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+		if (g < 5)
+			ABCD = vsha1cq_u32(ABCD, E0, TMP);
+		else if (g >= 10 && g < 15)
+			ABCD = vsha1mq_u32(ABCD, E0, TMP);
+		else
+			ABCD = vsha1pq_u32(ABCD, E0, TMP);
+		E0 = E1;
+		if (g < 16) {
+			/* calculate message words for the rounds 4 * (g + 4) ... 4 * (g + 4) + 3 */
+			MSG[g & 3] = vsha1su1q_u32(vsha1su0q_u32(MSG[g & 3], MSG[(g + 1) & 3], MSG[(g + 2) & 3]), MSG[(g + 3) & 3]);
+		}
+	}
+
+	vst1q_u32(hash, vaddq_u32(ABCD, ABCD_SAVE));
+	hash[4] += E0;
+}
+# define HAS_SHA1_ACCEL() has_cpu_feature(CPU_FEATURE_ARM_SHA1)
+#endif
+
+#ifdef HAS_SHA1_ACCEL
+static void rhash_sha1_process_block_choose_best(unsigned* hash, const unsigned* block);
+static void (*rhash_sha1_process_block)(unsigned* hash, const unsigned* block) = rhash_sha1_process_block_choose_best;
+
+static void rhash_sha1_process_block_choose_best(unsigned* hash, const unsigned* block)
+{
+	rhash_sha1_process_block = (HAS_SHA1_ACCEL() ?
+		rhash_sha1_process_block_accel : rhash_sha1_process_block_soft);
+	rhash_sha1_process_block(hash, block);
+}
+#else
+# define rhash_sha1_process_block rhash_sha1_process_block_soft
+#endif
+
 /**
  * Calculate message hash.
  * Can be called repeatedly with chunks of the message to be hashed.
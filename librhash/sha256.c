@@ -22,7 +22,7 @@
 /* SHA-224 and SHA-256 constants for 64 rounds. These words represent
  * the first 32 bits of the fractional parts of the cube
  * roots of the first 64 prime numbers. */
-static const unsigned rhash_k256[64] = {
+const unsigned rhash_k256[64] = {
 	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
 	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
 	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
@@ -109,7 +109,7 @@ void rhash_sha224_init(struct sha256_ctx *ctx)
  * @param hash algorithm state
  * @param block the message block to process
  */
-static void rhash_sha256_process_block(unsigned hash[8], unsigned block[16])
+static void rhash_sha256_process_block_soft(unsigned hash[8], unsigned block[16])
 {
 	unsigned A, B, C, D, E, F, G, H;
 	unsigned W[16];
@@ -160,6 +160,112 @@ static void rhash_sha256_process_block(unsigned hash[8], unsigned block[16])
 	hash[4] += E, hash[5] += F, hash[6] += G, hash[7] += H;
 }
 
+#if defined(HAS_INTEL_SHA_NI)
+#include <immintrin.h>
+
+/**
+ * Process a 512-bit block using the Intel SHA extensions.
+ *
+ * @param hash algorithm state
+ * @param block the message block to process
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void rhash_sha256_process_block_accel(unsigned hash[8], unsigned block[16])
+{
+	const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i STATE0, STATE1, ABEF_SAVE, CDGH_SAVE, TMP, MSG;
+	__m128i W[4];
+	int g;
+
+	TMP = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[0]), 0xB1); /* CDAB */
+	STATE1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[4]), 0x1B); /* EFGH */
+	STATE0 = _mm_alignr_epi8(TMP, STATE1, 8); /* ABEF */
+	STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0); /* CDGH */
+	ABEF_SAVE = STATE0;
+	CDGH_SAVE = STATE1;
+
+	for (g = 0; g < 16; g++) {
+		if (g < 4)
+			W[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)block + g), MASK);
+		MSG = _mm_add_epi32(W[g & 3], _mm_loadu_si128((const __m128i*)&rhash_k256[g * 4]));
+		STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);
+		if (g >= 3 && g <= 14) {
+			/* finish calculation of message words for the rounds 4 * (g + 1) ... 4 * (g + 1) + 3 */
+			TMP = _mm_alignr_epi8(W[g & 3], W[(g + 3) & 3], 4);
+			W[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(W[(g + 1) & 3], TMP), W[g & 3]);
+		}
+		STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, _mm_shuffle_epi32(MSG, 0x0E));
+		if (g >= 1 && g <= 12)
+			W[(g + 3) & 3] = _mm_sha256msg1_epu32(W[(g + 3) & 3], W[g & 3]);
+	}
+
+	STATE0 = _mm_add_epi32(STATE0, ABEF_SAVE);
+	STATE1 = _mm_add_epi32(STATE1, CDGH_SAVE);
+	TMP = _mm_shuffle_epi32(STATE0, 0x1B); /* FEBA */
+	STATE1 = _mm_shuffle_epi32(STATE1, 0xB1); /* DCHG */
+	_mm_storeu_si128((__m128i*)&hash[0], _mm_blend_epi16(TMP, STATE1, 0xF0)); /* DCBA */
+	_mm_storeu_si128((__m128i*)&hash[4], _mm_alignr_epi8(STATE1, TMP, 8)); /* HGFE */
+}
+# define HAS_SHA256_ACCEL() (has_cpu_feature(CPU_FEATURE_SHA) && \
+	has_cpu_feature(CPU_FEATURE_SSSE3) && has_cpu_feature(CPU_FEATURE_SSE4_1))
+
+#elif defined(HAS_ARM_SHA)
+#include <arm_neon.h>
+
+/**
+ * Process a 512-bit block using the ARMv8 cryptography extension.
+ *
+ * @param hash algorithm state
+ * @param block the message block to process
+ */
+# if defined(__clang__)
+__attribute__((target("crypto")))
+# else
+__attribute__((target("+crypto")))
+# endif
+static void rhash_sha256_process_block_accel(unsigned hash[8], unsigned block[16])
+{
+	const uint8_t* data = (const uint8_t*)block;
+	uint32x4_t STATE0, STATE1, ABCD_SAVE, EFGH_SAVE, TMP, TMP2;
+	uint32x4_t W[4];
+	int g;
+
+	STATE0 = ABCD_SAVE = vld1q_u32(&hash[0]);
+	STATE1 = EFGH_SAVE = vld1q_u32(&hash[4]);
+	for (g = 0; g < 4; g++)
+		W[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + g * 16)));
+
+	for (g = 0; g < 16; g++) {
+		TMP = vaddq_u32(W[g & 3], vld1q_u32(&rhash_k256[g * 4]));
+		TMP2 = STATE0;
+		STATE0 = vsha256hq_u32(STATE0, STATE1, TMP);
+		STATE1 = vsha256h2q_u32(STATE1, TMP2, TMP);
+		if (g < 12) {
+			/* calculate message words for the rounds 4 * (g + 4) ... 4 * (g + 4) + 3 */
+			W[g & 3] = vsha256su1q_u32(vsha256su0q_u32(W[g & 3], W[(g + 1) & 3]), W[(g + 2) & 3], W[(g + 3) & 3]);
+		}
+	}
+
+	vst1q_u32(&hash[0], vaddq_u32(STATE0, ABCD_SAVE));
+	vst1q_u32(&hash[4], vaddq_u32(STATE1, EFGH_SAVE));
+}
+# define HAS_SHA256_ACCEL() has_cpu_feature(CPU_FEATURE_ARM_SHA2)
+#endif
+
+#ifdef HAS_SHA256_ACCEL
+static void rhash_sha256_process_block_choose_best(unsigned hash[8], unsigned block[16]);
+static void (*rhash_sha256_process_block)(unsigned hash[8], unsigned block[16]) = rhash_sha256_process_block_choose_best;
+
+static void rhash_sha256_process_block_choose_best(unsigned hash[8], unsigned block[16])
+{
+	rhash_sha256_process_block = (HAS_SHA256_ACCEL() ?
+		rhash_sha256_process_block_accel : rhash_sha256_process_block_soft);
+	rhash_sha256_process_block(hash, block);
+}
+#else
+# define rhash_sha256_process_block rhash_sha256_process_block_soft
+#endif
+
 /**
  * Calculate message hash.
  * Can be called repeatedly with chunks of the message to be hashed.
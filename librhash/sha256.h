@@ -20,6 +20,8 @@ typedef struct sha256_ctx
 	unsigned digest_length; /* length of the algorithm digest in bytes */
 } sha256_ctx;
 
+extern const unsigned rhash_k256[64];
+
 void rhash_sha224_init(sha256_ctx *ctx);
 void rhash_sha256_init(sha256_ctx *ctx);
 void rhash_sha256_update(sha256_ctx *ctx, const unsigned char* data, size_t length);
@@ -26,7 +26,7 @@
 #define NumberOfRounds 24
 
 /* SHA3 (Keccak) constants for 24 rounds */
-static uint64_t keccak_round_constants[NumberOfRounds] = {
+const uint64_t rhash_keccak_round_constants[NumberOfRounds] = {
 	I64(0x0000000000000001), I64(0x0000000000008082), I64(0x800000000000808A), I64(0x8000000080008000),
 	I64(0x000000000000808B), I64(0x0000000080000001), I64(0x8000000080008081), I64(0x8000000000008009),
 	I64(0x000000000000008A), I64(0x0000000000000088), I64(0x0000000080008009), I64(0x000000008000000A),
@@ -199,7 +199,7 @@ static void rhash_sha3_permutation(uint64_t *state)
 		keccak_chi(state);
 
 		/* apply iota(state, round) */
-		*state ^= keccak_round_constants[round];
+		*state ^= rhash_keccak_round_constants[round];
 	}
 }
 
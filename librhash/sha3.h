@@ -29,6 +29,8 @@ typedef struct sha3_ctx
 	unsigned block_size;
 } sha3_ctx;
 
+extern const uint64_t rhash_keccak_round_constants[24];
+
 /* methods for calculating the hash function */
 
 void rhash_sha3_224_init(sha3_ctx *ctx);
@@ -16,6 +16,7 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
@@ -332,6 +333,42 @@ const char* sha512_tests[] = {
 	0
 };
 
+/* BLAKE2 test vectors were verified by Python hashlib */
+const char* blake2s_tests[] = {
+	"", "69217A3079908094E11121D042354A7C1F55B6482CA1A51E1B250DFD1ED0EEF9",
+	"a", "4A0D129873403037C2CD9B9048203687F6233FB6738956E0349BD4320FEC3E90",
+	"abc", "508C5E8C327C14E2E1A72BA34EEB452F37458B209ED63A294D999B4C86675982",
+	"message digest", "FA10AB775ACF89B7D3C8A6E823D586F6B67BDBAC4CE207FE145B7D3AC25CD28C",
+	"abcdefghijklmnopqrstuvwxyz", "BDF88EB1F86A0CDF0E840BA88FA118508369DF186C7355B4B16CF79FA2710A12",
+	"The quick brown fox jumps over the lazy dog", "606BEEEC743CCBEFF6CBCDF5D5302AA855C256C29B88C8ED331EA1A6BF3C8812",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "C75439EA17E1DE6FA4510C335DC3D3F343E6F9E1CE2773E25B4174F1DF8B119B",
+	"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "FDAEDB290A0D5AF9870864FEC2E090200989DC9CD53A3C092129E8535E8B4F66",
+	0
+};
+const char* blake2b_tests[] = {
+	"", "786A02F742015903C6C6FD852552D272912F4740E15847618A86E217F71F5419D25E1031AFEE585313896444934EB04B903A685B1448B755D56F701AFE9BE2CE",
+	"a", "333FCB4EE1AA7C115355EC66CEAC917C8BFD815BF7587D325AEC1864EDD24E34D5ABE2C6B1B5EE3FACE62FED78DBEF802F2A85CB91D455A8F5249D330853CB3C",
+	"abc", "BA80A53F981C4D0D6A2797B69F12F6E94C212F14685AC4B74B12BB6FDBFFA2D17D87C5392AAB792DC252D5DE4533CC9518D38AA8DBF1925AB92386EDD4009923",
+	"message digest", "3C26CE487B1C0F062363AFA3C675EBDBF5F4EF9BDC022CFBEF91E3111CDC283840D8331FC30A8A0906CFF4BCDBCD230C61AAEC60FDFAD457ED96B709A382359A",
+	"abcdefghijklmnopqrstuvwxyz", "C68EDE143E416EB7B4AAAE0D8E48E55DD529EAFED10B1DF1A61416953A2B0A5666C761E7D412E6709E31FFE221B7A7A73908CB95A4D120B8B090A87D1FBEDB4C",
+	"The quick brown fox jumps over the lazy dog", "A8ADD4BDDDFD93E4877D2746E62817B116364A1FA7BC148D95090BC7333B3673F82401CF7AA2E4CB1ECD90296E3F14CB5413F8ED77BE73045B13914CDCD6A918",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "99964802E5C25E703722905D3FB80046B6BCA698CA9E2CC7E49B4FE1FA087C2EDF0312DFBB275CF250A1E542FD5DC2EDD313F9C491127C2E8C0C9B24168E2D50",
+	"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "686F41EC5AFFF6E87E1F076F542AA466466FF5FBDE162C48481BA48A748D842799F5B30F5B67FC684771B33B994206D05CC310F31914EDD7B97E41860D77D282",
+	0
+};
+/* BLAKE3 test vectors were verified by the reference implementation */
+const char* blake3_tests[] = {
+	"", "AF1349B9F5F9A1A6A0404DEA36DCC9499BCB25C9ADC112B7CC9A93CAE41F3262",
+	"a", "17762FDDD969A453925D65717AC3EEA21320B66B54342FDE15128D6CAF21215F",
+	"abc", "6437B3AC38465133FFB63B75273A8DB548C558465D79DB03FD359C6CD5BD9D85",
+	"message digest", "7BC2A2EEB95DDBF9B7ECF6ADCB76B453091C58DC43955E1D9482B1942F08D19B",
+	"abcdefghijklmnopqrstuvwxyz", "2468EEC8894ACFB4E4DF3A51EA916BA115D48268287754290AAE8E9E6228E85F",
+	"The quick brown fox jumps over the lazy dog", "2F1514181AADCCD913ABD94CFA592701A5686AB23F8DF1DFF1B74710FEBC6D4A",
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "8BEE3200BAA9F3A1ACD279F049F914F110E730555FF15109BD59CDD73895E239",
+	"12345678901234567890123456789012345678901234567890123456789012345678901234567890", "F263ACF51621980B9C8DE5DA4A17D314984E05ABE4A21CC83A07FE3E1E366DD1",
+	0
+};
+
 /* SHA3 test vectors were verified by the reference implementation of Keccak */
 const char* sha3_224_tests[] = {
 	"", "6B4E03423667DBB73B6E15454F0EB1ABD4597F9A1B078E3F5B5A6BC7",
@@ -526,6 +563,9 @@ struct test_vectors_t short_test_vectors[] = {
 	{ RHASH_SHA3_512, sha3_512_tests },
 	{ RHASH_EDONR256, edonr256_tests },
 	{ RHASH_EDONR512, edonr512_tests },
+	{ RHASH_BLAKE2S, blake2s_tests },
+	{ RHASH_BLAKE2B, blake2b_tests },
+	{ RHASH_BLAKE3, blake3_tests },
 	{ 0, 0 }
 };
 
@@ -707,7 +747,7 @@ static void test_all_known_strings(void)
  * A pair <algorithm-id, expected-hash-value>.
  */
 typedef struct id_to_hash_t {
-	int hash_id;
+	unsigned hash_id;
 	const char* expected_hash;
 } id_to_hash_t;
 
@@ -748,6 +788,9 @@ static void test_long_strings(void)
 		{ RHASH_EDONR512, "B4A5A255D67869C990FE79B5FCBDA69958794B8003F01FD11E90FEFEC35F22BD84FFA2E248E8B3C1ACD9B7EFAC5BC66616E234A6E938D3526DEE26BD0DE9C562" }, /* verified by eBASH SUPERCOP implementation */
 		{ RHASH_GOST12_256, "841AF1A0B2F92A800FB1B7E4AABC8E48763153C448A0FC57C90BA830E130F152" },
 		{ RHASH_GOST12_512, "D396A40B126B1F324465BFA7AA159859AB33FAC02DCDD4515AD231206396A266D0102367E4C544EF47D2294064E1A25342D0CD25AE3D904B45ABB1425AE41095" },
+		{ RHASH_BLAKE2S, "BEC0C0E6CDE5B67ACB73B81F79A67A4079AE1C60DAC9D2661AF18E9F8B50DFA5" }, /* verified by Python hashlib */
+		{ RHASH_BLAKE2B, "98FB3EFB7206FD19EBF69B6F312CF7B64E3B94DBE1A17107913975A793F177E1D077609D7FBA363CBBA00D05F7AA4E4FA8715D6428104C0A75643B0FF3FD3EAF" }, /* verified by Python hashlib */
+		{ RHASH_BLAKE3, "616F575A1B58D4C9797D4217B9730AE5E6EB319D76EDEF6549B46F4EFE31FF8B" }, /* verified by the reference implementation */
 #ifdef USE_KECCAK
 		{ RHASH_KECCAK_224, "19F9167BE2A04C43ABD0ED554788101B9C339031ACC8E1468531303F" }, /* verified by reference implementation */
 		{ RHASH_KECCAK_256, "FADAE6B49F129BBB812BE8407B7B2894F34AECF6DBD1F9B0F0C7E9853098FC96" }, /* verified by reference implementation */
@@ -777,6 +820,15 @@ static void test_long_strings(void)
 	assert_rep_hash(RHASH_AICH, 0, 9728000, "5D3N4HQHIUMQ7IU7A5QLPLI6RHSWOR7B", 0);
 	assert_rep_hash(RHASH_AICH, 0, 9728000 - 1, "L6SPMD2CM6PRZBGRQ6UFC4HJFFOATRA4", 0);
 	assert_rep_hash(RHASH_AICH, 0, 9728000 + 1, "HL3TFXORIUEPXUWFPY3JLR7SMKGTO4IH", 0);
+	/* several different EDON-R512 blocks hashed by a single update call */
+	assert_hash(RHASH_EDONR512,
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+		"42521528920F3220CAA72E52389214589D8C11DE6D01E26E579B586E20367C01"
+		"F567936B4B8B1844A1A612DF069FB8EAE173D998B9DDE3E2F279F0153E05FEB8", 0);
 #if 0
 	assert_rep_hash(RHASH_ED2K, 0, 9728000 * 5, "3B613901DABA54F6C0671793E28A1205", 0);
 	assert_rep_hash(RHASH_AICH, 0, 9728000 * 5, "EZCO3XF2RJ4FERRDEXGOSSRGL5NA5BBM", 0);
@@ -821,15 +873,601 @@ static void test_results_consistency(void)
 	}
 }
 
+/**
+ * Verify that a multi-threaded context calculates the same hash values
+ * as a single-threaded one.
+ */
+static void test_threads(void)
+{
+	static char ALIGN_ATTR(64) msg_chunk[65536];
+	const size_t msg_size = 1000000;
+	unsigned hash_id;
+	struct rhash_context *ctx, *mt_ctx;
+	size_t left, size;
+	char res1[130], res2[130];
+
+	memset(msg_chunk, 'a', sizeof(msg_chunk));
+	ctx = rhash_init(RHASH_ALL_HASHES);
+	mt_ctx = rhash_init(RHASH_ALL_HASHES);
+	if (rhash_set_threads(mt_ctx, 4) == RHASH_ERROR) {
+#ifdef USE_PTHREADS
+		log_message("failed: can't start hashing threads\n");
+		g_errors++;
+#endif
+		rhash_free(ctx);
+		rhash_free(mt_ctx);
+		return;
+	}
+
+	for (left = msg_size; left > 0; left -= size) {
+		size = (left > sizeof(msg_chunk) ? sizeof(msg_chunk) : left);
+		rhash_update(ctx, msg_chunk, size);
+		rhash_update(mt_ctx, msg_chunk, size);
+	}
+	rhash_final(ctx, 0);
+	rhash_final(mt_ctx, 0);
+
+	for (hash_id = 1; (hash_id & RHASH_ALL_HASHES); hash_id <<= 1) {
+		rhash_print(res1, ctx, hash_id, RHPR_UPPERCASE);
+		rhash_print(res2, mt_ctx, hash_id, RHPR_UPPERCASE);
+		if (strcmp(res1, res2) != 0) {
+			log_message("failed: multi-threaded %s(\"a\"x%u) = %s, expected %s\n",
+				rhash_get_name(hash_id), (unsigned)msg_size, res2, res1);
+			g_errors++;
+		}
+	}
+	rhash_free(ctx);
+	rhash_free(mt_ctx);
+}
+
+/**
+ * Verify that TTH leaves, BTIH pieces, ED2K chunks, AICH blocks and BLAKE3
+ * chunks split between threads give the same hash values, when message blocks
+ * don't start at their boundaries.
+ */
+static void test_tree_threads(void)
+{
+	static const unsigned hash_ids[] = { RHASH_TTH, RHASH_BTIH, RHASH_ED2K, RHASH_AICH, RHASH_BLAKE3 };
+	static const size_t pieces[] = { 1000, 250000, 7, 30000017, 0 };
+	static unsigned char msg[40000000];
+	unsigned char expected[32], result[32];
+	struct rhash_context *ctx;
+	size_t offset, i;
+	unsigned j;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char)(i % 251);
+
+	for (j = 0; j < sizeof(hash_ids) / sizeof(*hash_ids); j++) {
+		rhash_msg(hash_ids[j], msg, sizeof(msg), expected);
+
+		ctx = rhash_init(hash_ids[j]);
+		if (rhash_set_threads(ctx, 3) == RHASH_ERROR) {
+			rhash_free(ctx);
+			return; /* the error is reported by test_threads() */
+		}
+		for (i = 0, offset = 0; pieces[i]; offset += pieces[i++])
+			rhash_update(ctx, msg + offset, pieces[i]);
+		rhash_update(ctx, msg + offset, sizeof(msg) - offset);
+		rhash_final(ctx, result);
+		rhash_free(ctx);
+
+		if (memcmp(expected, result, rhash_get_digest_size(hash_ids[j])) != 0) {
+			log_message("failed: multi-threaded %s doesn't match rhash_msg()\n",
+				rhash_get_name(hash_ids[j]));
+			g_errors++;
+		}
+	}
+}
+
+/**
+ * Create a context of all hash functions, which is set to create a torrent.
+ *
+ * @return the new context
+ */
+static struct rhash_context* init_all_hashes_ctx(void)
+{
+	struct rhash_context *ctx = rhash_init(RHASH_ALL_HASHES);
+	rhash_torrent_add_file(ctx, "dir/a.bin", 10500000);
+	rhash_torrent_add_file(ctx, "dir/b.bin", 0);
+	rhash_torrent_add_announce(ctx, "http://tracker.org/announce");
+	rhash_torrent_set_program_name(ctx, "test");
+	return ctx;
+}
+
+/**
+ * Verify that a context exported in the middle of a message and imported
+ * by rhash_import() gives the same hashes, as a context hashing the message
+ * at once. The message contains several ed2k chunks and torrent pieces.
+ */
+static void test_export_import(void)
+{
+	static unsigned char msg[10500000];
+	static const size_t split_offsets[] = { 1000, 9999999 };
+	char expected[130], result[130];
+	struct rhash_context *ctx, *imported;
+	unsigned char* data;
+	size_t i, size;
+	unsigned hash_id;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char)(i % 251);
+
+	for (i = 0; i < sizeof(split_offsets) / sizeof(*split_offsets); i++) {
+		ctx = init_all_hashes_ctx();
+		rhash_update(ctx, msg, split_offsets[i]);
+		size = rhash_export(ctx, NULL, 0);
+		data = (unsigned char*)malloc(size);
+		if (!data || rhash_export(ctx, data, size) != size) {
+			log_message("failed: rhash_export() at offset %u\n", (unsigned)split_offsets[i]);
+			g_errors++;
+			rhash_free(ctx);
+			free(data);
+			return;
+		}
+		imported = rhash_import(data, size - 1);
+		if (imported) {
+			log_message("failed: rhash_import() accepted truncated data\n");
+			g_errors++;
+			rhash_free(imported);
+		}
+		imported = rhash_import(data, size);
+		free(data);
+		if (!imported) {
+			log_message("failed: rhash_import() at offset %u\n", (unsigned)split_offsets[i]);
+			g_errors++;
+			rhash_free(ctx);
+			return;
+		}
+		rhash_update(ctx, msg + split_offsets[i], sizeof(msg) - split_offsets[i]);
+		rhash_update(imported, msg + split_offsets[i], sizeof(msg) - split_offsets[i]);
+		rhash_final(ctx, 0);
+		rhash_final(imported, 0);
+
+		for (hash_id = 1; (hash_id & RHASH_ALL_HASHES) != 0; hash_id <<= 1) {
+			rhash_print(expected, ctx, hash_id, RHPR_HEX);
+			rhash_print(result, imported, hash_id, RHPR_HEX);
+			if (strcmp(expected, result) != 0) {
+				log_message("failed: imported %s at offset %u = %s, expected %s\n",
+					rhash_get_name(hash_id), (unsigned)split_offsets[i], result, expected);
+				g_errors++;
+			}
+		}
+		if (ctx->msg_size != imported->msg_size) {
+			log_message("failed: imported message size doesn't match\n");
+			g_errors++;
+		}
+		rhash_free(ctx);
+		rhash_free(imported);
+	}
+}
+
+/**
+ * A memory buffer receiving the content of a torrent file.
+ */
+struct torrent_buffer
+{
+	char str[65536];
+	size_t length;
+};
+
+/**
+ * Callback appending a part of a torrent file to a torrent_buffer.
+ */
+static int append_torrent_content(void* data, const void* buffer, size_t size)
+{
+	struct torrent_buffer* tb = (struct torrent_buffer*)data;
+	if (tb->length + size > sizeof(tb->str))
+		return -1;
+	memcpy(tb->str + tb->length, buffer, size);
+	tb->length += size;
+	return 0;
+}
+
+/**
+ * Verify that a torrent, streamed with the RHASH_TORRENT_OPT_STREAM option,
+ * has the same content and BTIH as a torrent generated in memory.
+ * The message contains enough pieces to spill their hashes to a temporary file,
+ * and the context is exported and imported after spilling.
+ */
+static void test_torrent_stream(void)
+{
+	static unsigned char msg[5000000];
+	static struct torrent_buffer streamed;
+	unsigned char expected[20], result[20];
+	const rhash_str* content;
+	struct rhash_context *ctx, *imported;
+	unsigned char* data;
+	size_t i, size;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char)(i % 253);
+
+	ctx = rhash_init(RHASH_BTIH);
+	rhash_torrent_add_file(ctx, "dir/a.bin", sizeof(msg));
+	rhash_torrent_set_options(ctx, RHASH_TORRENT_OPT_INFOHASH_ONLY);
+	rhash_torrent_set_piece_length(ctx, 16384);
+	rhash_update(ctx, msg, sizeof(msg));
+	rhash_final(ctx, expected);
+	content = rhash_torrent_generate_content(ctx);
+
+	imported = rhash_init(RHASH_BTIH);
+	rhash_torrent_add_file(imported, "dir/a.bin", sizeof(msg));
+	rhash_torrent_set_options(imported, RHASH_TORRENT_OPT_INFOHASH_ONLY | RHASH_TORRENT_OPT_STREAM);
+	rhash_torrent_set_piece_length(imported, 16384);
+	rhash_update(imported, msg, 4500000);
+	size = rhash_export(imported, NULL, 0);
+	data = (unsigned char*)malloc(size);
+	if (data && rhash_export(imported, data, size) == size) {
+		rhash_free(imported);
+		imported = rhash_import(data, size);
+	}
+	free(data);
+	if (!imported || !content) {
+		log_message("failed: torrent streaming, can't create a context\n");
+		g_errors++;
+		rhash_free(ctx);
+		return;
+	}
+	rhash_update(imported, msg + 4500000, sizeof(msg) - 4500000);
+	rhash_final(imported, result);
+	streamed.length = 0;
+	if (memcmp(expected, result, sizeof(result)) != 0 ||
+			rhash_torrent_check_content(imported) < 0 ||
+			rhash_torrent_write_content(imported, append_torrent_content, &streamed) < 0 ||
+			streamed.length != content->length ||
+			memcmp(streamed.str, content->str, content->length) != 0) {
+		log_message("failed: streamed torrent doesn't match generated one\n");
+		g_errors++;
+	}
+	rhash_free(imported);
+	rhash_free(ctx);
+
+	/* a context without BTIH can't generate a torrent file */
+	ctx = rhash_init(RHASH_SHA1);
+	if (ctx && rhash_torrent_check_content(ctx) == 0) {
+		log_message("failed: rhash_torrent_check_content() accepted a context without BTIH\n");
+		g_errors++;
+	}
+	rhash_free(ctx);
+}
+
+/**
+ * Verify that a torrent, with leading piece hashes added by
+ * rhash_torrent_add_piece_hashes(), has the same BTIH as a torrent
+ * calculated by hashing the whole message.
+ */
+static void test_torrent_piece_hashes(void)
+{
+	static unsigned char msg[100000];
+	unsigned char expected[20], result[20];
+	const rhash_str* content;
+	const char* pieces;
+	struct rhash_context *ctx, *ctx2;
+	size_t i;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char)(i % 249);
+	ctx = rhash_init(RHASH_BTIH);
+	rhash_torrent_add_file(ctx, "a.bin", sizeof(msg));
+	rhash_torrent_set_options(ctx, RHASH_TORRENT_OPT_INFOHASH_ONLY);
+	rhash_update(ctx, msg, sizeof(msg));
+	rhash_final(ctx, expected);
+	content = rhash_torrent_generate_content(ctx);
+	/* 100000 bytes are split into 7 pieces of 16384 bytes */
+	pieces = (content ? strstr(content->str, "6:pieces140:") : NULL);
+
+	ctx2 = rhash_init(RHASH_BTIH);
+	rhash_torrent_add_file(ctx2, "a.bin", sizeof(msg));
+	rhash_torrent_set_options(ctx2, RHASH_TORRENT_OPT_INFOHASH_ONLY);
+	if (!pieces || !rhash_torrent_add_piece_hashes(ctx2, (const unsigned char*)pieces + 12, 3)) {
+		log_message("failed: rhash_torrent_add_piece_hashes()\n");
+		g_errors++;
+	} else {
+		rhash_update(ctx2, msg + 3 * 16384, sizeof(msg) - 3 * 16384);
+		rhash_final(ctx2, result);
+		if (memcmp(expected, result, sizeof(result)) != 0) {
+			log_message("failed: BTIH doesn't match after rhash_torrent_add_piece_hashes()\n");
+			g_errors++;
+		}
+	}
+	rhash_free(ctx2);
+	rhash_free(ctx);
+}
+
+/**
+ * Verify that hashing a file by rhash_fd_update() gives the same result
+ * as hashing the same message from memory, with and without direct I/O.
+ */
+static void test_fd_update(void)
+{
+	static char msg[100000];
+	unsigned char expected[64], result[64];
+	struct rhash_context *ctx;
+	FILE* f = tmpfile();
+	int direct, res;
+
+	if (!f) {
+		log_message("failed: can't create a temporary file\n");
+		g_errors++;
+		return;
+	}
+	memset(msg, 'a', sizeof(msg));
+	fwrite(msg, 1, sizeof(msg), f);
+	fflush(f);
+	rhash_msg(RHASH_SHA1, msg, sizeof(msg), expected);
+
+	for (direct = 0; direct < 2; direct++) {
+		lseek(fileno(f), 0, SEEK_SET);
+		ctx = rhash_init(RHASH_SHA1);
+		rhash_set_io_block_size(ctx, 5000); /* rounded to 8 KiB, not a divisor of the file size */
+		rhash_set_direct_io(ctx, direct);
+		res = rhash_fd_update(ctx, fileno(f));
+		rhash_final(ctx, result);
+		rhash_free(ctx);
+
+		if (res < 0 || memcmp(expected, result, 20) != 0) {
+			log_message("failed: rhash_fd_update(\"a\"x%u)%s doesn't match rhash_msg()\n",
+				(unsigned)sizeof(msg), (direct ? " with direct I/O" : ""));
+			g_errors++;
+		}
+	}
+	fclose(f);
+}
+
+/**
+ * Verify BLAKE3 on messages of several chunks, which are combined by a tree.
+ * The message is hashed at once and by 8 KiB pieces.
+ */
+static void test_blake3_tree(void)
+{
+	static const struct {
+		size_t length;
+		const char* expected_hash;
+	} tests[] = {
+		/* test vectors of the reference implementation, bytes of the message are i % 251 */
+		{ 1023, "10108970EEDA3EB932BAAC1428C7A2163B0E924C9A9E25B35BBA72B28F70BD11" },
+		{ 1024, "42214739F095A406F3FC83DEB889744AC00DF831C10DAA55189B5D121C855AF7" },
+		{ 1025, "D00278AE47EB27B34FAECF67B4FE263F82D5412916C1FFD97C8CB7FB814B8444" },
+		{ 2048, "E776B6028C7CD22A4D0BA182A8BF62205D2EF576467E838ED6F2529B85FBA24A" },
+		{ 2049, "5F4D72F40D7A5F82B15CA2B2E44B1DE3C2EF86C426C95C1AF0B6879522563030" },
+		{ 8192, "AAE792484C8EFE4F19E2CA7D371D8C467FFB10748D8A5A1AE579948F718A2A63" },
+		{ 102400, "BC3E3D41A1146B069ABFFAD3C0D44860CF664390AFCE4D9661F7902E7943E085" }
+	};
+	static unsigned char msg[102400];
+	char result[130];
+	unsigned char digest[32];
+	unsigned i;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (unsigned char)(i % 251);
+	for (i = 0; i < sizeof(tests) / sizeof(*tests); i++) {
+		struct rhash_context *ctx = rhash_init(RHASH_BLAKE3);
+		size_t offset, size;
+
+		rhash_msg(RHASH_BLAKE3, msg, tests[i].length, digest);
+		rhash_print_bytes(result, digest, 32, RHPR_HEX | RHPR_UPPERCASE);
+		if (strcmp(result, tests[i].expected_hash) != 0) {
+			log_message("failed: BLAKE3(%u bytes) = %s, expected %s\n",
+				(unsigned)tests[i].length, result, tests[i].expected_hash);
+			g_errors++;
+		}
+
+		for (offset = 0; offset < tests[i].length; offset += size) {
+			size = tests[i].length - offset;
+			if (size > 8192) size = 8192;
+			rhash_update(ctx, msg + offset, size);
+		}
+		rhash_final(ctx, 0);
+		rhash_print(result, ctx, RHASH_BLAKE3, RHPR_UPPERCASE);
+		rhash_free(ctx);
+		if (strcmp(result, tests[i].expected_hash) != 0) {
+			log_message("failed: BLAKE3(%u bytes by 8 KiB) = %s, expected %s\n",
+				(unsigned)tests[i].length, result, tests[i].expected_hash);
+			g_errors++;
+		}
+	}
+}
+
+/**
+ * Verify that rhash_msg_batch() gives the same results as rhash_msg()
+ * for messages of different lengths, including lengths near the padding
+ * boundaries.
+ */
+static void test_msg_batch(void)
+{
+	static const unsigned hash_ids[] = { RHASH_MD5, RHASH_SHA1, RHASH_SHA224, RHASH_SHA256,
+		RHASH_SHA3_224, RHASH_SHA3_256, RHASH_SHA3_384, RHASH_SHA3_512, RHASH_TTH };
+	static const size_t lengths[] = { 0, 1, 3, 55, 56, 63, 64, 65, 71, 72, 119, 120, 128, 135, 136, 144, 200, 1000 };
+	enum { COUNT = sizeof(lengths) / sizeof(*lengths) };
+	static char msg[1100];
+	static unsigned char results[COUNT][64];
+	unsigned char* result_ptrs[COUNT];
+	const void* messages[COUNT];
+	unsigned char expected[64];
+	unsigned i, j;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (char)(i * 7 + 1);
+	for (j = 0; j < COUNT; j++) {
+		messages[j] = msg + j; /* test unaligned messages */
+		result_ptrs[j] = results[j];
+	}
+
+	for (i = 0; i < sizeof(hash_ids) / sizeof(*hash_ids); i++) {
+		size_t size = rhash_get_digest_size(hash_ids[i]);
+		memset(results, 0, sizeof(results));
+		if (rhash_msg_batch(hash_ids[i], messages, lengths, result_ptrs, COUNT) < 0) {
+			log_message("failed: rhash_msg_batch(%s) returned error\n", rhash_get_name(hash_ids[i]));
+			g_errors++;
+			continue;
+		}
+		for (j = 0; j < COUNT; j++) {
+			rhash_msg(hash_ids[i], (const char*)messages[j], lengths[j], expected);
+			if (memcmp(expected, results[j], size) != 0) {
+				log_message("failed: rhash_msg_batch(%s) for message length %u\n",
+					rhash_get_name(hash_ids[i]), (unsigned)lengths[j]);
+				g_errors++;
+			}
+		}
+	}
+}
+
+/**
+ * Verify that rhash_updatev() gives the same hashes, as rhash_update()
+ * called for the whole message.
+ */
+static void test_updatev(void)
+{
+	static const size_t lengths[] = { 0, 1, 63, 64, 65, 1000, 7, 0, 3000, 9216 };
+	enum { COUNT = sizeof(lengths) / sizeof(*lengths) };
+	static char msg[16384];
+	rhash_iovec iov[COUNT];
+	char expected[130], result[130];
+	struct rhash_context *ctx, *ctxv;
+	size_t i, offset = 0;
+	unsigned hash_id;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (char)(i * 13 + 5);
+	for (i = 0; i < COUNT; i++) {
+		iov[i].iov_base = msg + offset;
+		iov[i].iov_len = lengths[i];
+		offset += lengths[i];
+	}
+	ctx = rhash_init(RHASH_ALL_HASHES);
+	ctxv = rhash_init(RHASH_ALL_HASHES);
+	rhash_update(ctx, msg, offset);
+	if (rhash_updatev(ctxv, iov, COUNT) < 0 || ctxv->msg_size != offset) {
+		log_message("failed: rhash_updatev() returned error\n");
+		g_errors++;
+	}
+	rhash_final(ctx, 0);
+	rhash_final(ctxv, 0);
+	for (hash_id = 1; (hash_id & RHASH_ALL_HASHES) != 0; hash_id <<= 1) {
+		rhash_print(expected, ctx, hash_id, RHPR_HEX);
+		rhash_print(result, ctxv, hash_id, RHPR_HEX);
+		if (strcmp(expected, result) != 0) {
+			log_message("failed: rhash_updatev(%s) gives %s, expected %s\n",
+				rhash_get_name(hash_id), result, expected);
+			g_errors++;
+		}
+	}
+	rhash_free(ctx);
+	rhash_free(ctxv);
+}
+
+/**
+ * Verify that a context initialized by rhash_init_inplace() in a caller
+ * provided buffer gives the same hashes, as an allocated context.
+ */
+static void test_init_inplace(void)
+{
+	static const char* msg = "message digest";
+	static uint64_t buffer[16384 / 8];
+	char expected[130], result[130];
+	struct rhash_context *ctx, *inplace;
+	size_t size = rhash_get_context_size(RHASH_ALL_HASHES);
+	unsigned hash_id;
+
+	if (rhash_get_context_size(0) != 0 || size == 0 || size > sizeof(buffer)) {
+		log_message("failed: rhash_get_context_size() returned %u\n", (unsigned)size);
+		g_errors++;
+		return;
+	}
+	if (rhash_init_inplace(RHASH_ALL_HASHES, buffer, size - 1) != NULL) {
+		log_message("failed: rhash_init_inplace() accepted a small buffer\n");
+		g_errors++;
+	}
+	ctx = rhash_init(RHASH_ALL_HASHES);
+	inplace = rhash_init_inplace(RHASH_ALL_HASHES, buffer, size);
+	if (!ctx || !inplace) {
+		log_message("failed: rhash_init_inplace() returned NULL\n");
+		g_errors++;
+		rhash_free(ctx);
+		return;
+	}
+	rhash_update(ctx, msg, strlen(msg));
+	rhash_update(inplace, msg, strlen(msg));
+	rhash_final(ctx, 0);
+	rhash_final(inplace, 0);
+	for (hash_id = 1; (hash_id & RHASH_ALL_HASHES) != 0; hash_id <<= 1) {
+		rhash_print(expected, ctx, hash_id, RHPR_HEX);
+		rhash_print(result, inplace, hash_id, RHPR_HEX);
+		if (strcmp(expected, result) != 0) {
+			log_message("failed: rhash_init_inplace(%s) gives %s, expected %s\n",
+				rhash_get_name(hash_id), result, expected);
+			g_errors++;
+		}
+	}
+	rhash_free(ctx);
+	rhash_free(inplace);
+}
+
+/**
+ * Verify that a context re-initialized by rhash_reinit() for another set
+ * of hash functions gives the same hashes, as a newly allocated context.
+ * The context has threads, which are re-distributed for every hash set.
+ */
+static void test_reinit(void)
+{
+	static const unsigned hash_masks[] = { RHASH_CRC32, RHASH_ALL_HASHES, RHASH_SHA1 | RHASH_MD5, RHASH_TTH };
+	static char msg[100000];
+	char expected[130], result[130];
+	struct rhash_context *ctx, *reused, *allocated;
+	unsigned hash_id;
+	size_t i;
+
+	memset(msg, 'a', sizeof(msg));
+	ctx = rhash_init(RHASH_SHA256);
+	rhash_set_threads(ctx, 4); /* a single algorithm doesn't need threads */
+	rhash_update(ctx, "x", 1);
+	for (i = 0; i < sizeof(hash_masks) / sizeof(*hash_masks); i++) {
+		reused = rhash_reinit(ctx, hash_masks[i]);
+		if (!reused) {
+			log_message("failed: rhash_reinit(%u) returned NULL\n", (unsigned)i);
+			g_errors++;
+			break;
+		}
+		ctx = reused;
+		allocated = rhash_init(hash_masks[i]);
+		rhash_update(ctx, msg, sizeof(msg));
+		rhash_update(allocated, msg, sizeof(msg));
+		rhash_final(ctx, 0);
+		rhash_final(allocated, 0);
+		if (ctx->msg_size != allocated->msg_size) {
+			log_message("failed: rhash_reinit(%u) message size\n", (unsigned)i);
+			g_errors++;
+		}
+		for (hash_id = 1; (hash_id & RHASH_ALL_HASHES) != 0; hash_id <<= 1) {
+			if ((hash_id & hash_masks[i]) == 0) continue;
+			rhash_print(expected, allocated, hash_id, RHPR_HEX);
+			rhash_print(result, ctx, hash_id, RHPR_HEX);
+			if (strcmp(expected, result) != 0) {
+				log_message("failed: rhash_reinit(%s) gives %s, expected %s\n",
+					rhash_get_name(hash_id), result, expected);
+				g_errors++;
+			}
+		}
+		rhash_free(allocated);
+	}
+	if (rhash_reinit(ctx, 0) != NULL) {
+		log_message("failed: rhash_reinit() accepted empty hash mask\n");
+		g_errors++;
+	}
+	rhash_free(ctx);
+}
+
 /**
  * Verify that calculated hash doesn't depend on message alignment.
  */
 static void test_alignment(void)
 {
-	int i, start, hash_id, alignment_size;
+	unsigned hash_id;
+	int start, alignment_size;
 
 	/* loop by sums */
-	for (i = 0, hash_id = 1; (hash_id & RHASH_ALL_HASHES); hash_id <<= 1, i++) {
+	for (hash_id = 1; (hash_id & RHASH_ALL_HASHES); hash_id <<= 1) {
 		char expected_hash[130];
 		assert(rhash_get_digest_size(hash_id) < (int)sizeof(expected_hash));
 
@@ -873,7 +1511,7 @@ static void test_endianness(void)
  */
 static void test_generic_assumptions(void)
 {
-	unsigned mask = (1 << RHASH_HASH_COUNT) - 1;
+	unsigned mask = (unsigned)(((uint64_t)1 << RHASH_HASH_COUNT) - 1);
 	if (mask != RHASH_ALL_HASHES) {
 		log_message("error: wrong algorithms count %d for the mask 0x%x\n", RHASH_HASH_COUNT, RHASH_ALL_HASHES);
 		g_errors++;
@@ -928,7 +1566,7 @@ static void test_magnet(void)
 		ctx, RHASH_ED2K | RHASH_AICH | RHASH_SHA1 | RHASH_BTIH, RHPR_NO_MAGNET);
 
 	/* verify length calculation for all hashes */
-	for (bit = 1; bit < RHASH_ALL_HASHES; bit <<= 1) {
+	for (bit = 1; bit & RHASH_ALL_HASHES; bit <<= 1) {
 		assert_magnet(NULL, ctx, bit, RHPR_FILESIZE | RHPR_NO_MAGNET);
 	}
 
@@ -1024,6 +1662,17 @@ int main(int argc, char *argv[])
 		test_long_strings();
 		test_alignment();
 		test_results_consistency();
+		test_threads();
+		test_tree_threads();
+		test_fd_update();
+		test_export_import();
+		test_torrent_stream();
+		test_torrent_piece_hashes();
+		test_msg_batch();
+		test_updatev();
+		test_init_inplace();
+		test_reinit();
+		test_blake3_tree();
 		test_magnet();
 		if (g_errors == 0) printf("All sums are working properly!\n");
 		fflush(stdout);
@@ -0,0 +1,214 @@
+/* thread_pool.c - a pool of worker threads for parallel hashing
+ *
+ * Copyright: 2026 RHash contributors
+ *
+ * Permission is hereby granted,  free of charge,  to any person  obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction,  including without limitation
+ * the rights to  use, copy, modify,  merge, publish, distribute, sublicense,
+ * and/or sell copies  of  the Software,  and to permit  persons  to whom the
+ * Software is furnished to do so.
+ *
+ * This program  is  distributed  in  the  hope  that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  Use this program  at  your own risk!
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include "thread_pool.h"
+
+#ifdef USE_PTHREADS
+#include <pthread.h>
+
+struct rhash_thread_pool
+{
+	pthread_mutex_t lock;
+	pthread_cond_t job_ready; /* signaled when a new job is posted */
+	pthread_cond_t job_done;  /* signaled when all items of a job are done */
+	pthread_t* threads;
+	unsigned threads_count;   /* number of started worker threads */
+	rhash_job_t job;
+	void* job_data;
+	unsigned job_count;  /* number of items in the current job */
+	unsigned next_index; /* index of the next item to process */
+	unsigned pending;    /* number of not yet finished items */
+	int shutdown;
+};
+
+/**
+ * Process items of the current job, until there are no unclaimed items left.
+ * Must be called with the pool lock being held.
+ *
+ * @param pool the thread pool
+ */
+static void process_job_items(rhash_thread_pool* pool)
+{
+	while (pool->next_index < pool->job_count) {
+		unsigned index = pool->next_index++;
+		rhash_job_t job = pool->job;
+		void* data = pool->job_data;
+
+		pthread_mutex_unlock(&pool->lock);
+		job(data, index);
+		pthread_mutex_lock(&pool->lock);
+
+		if (--pool->pending == 0)
+			pthread_cond_broadcast(&pool->job_done);
+	}
+}
+
+/**
+ * The main loop of a worker thread.
+ *
+ * @param arg the thread pool
+ * @return NULL
+ */
+static void* worker_thread(void* arg)
+{
+	rhash_thread_pool* pool = (rhash_thread_pool*)arg;
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->shutdown && pool->next_index >= pool->job_count)
+			pthread_cond_wait(&pool->job_ready, &pool->lock);
+		if (pool->shutdown) break;
+		process_job_items(pool);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/**
+ * Allocate a thread pool. The calling thread always takes part in running
+ * jobs, so only (threads_count - 1) worker threads are started.
+ *
+ * @param threads_count the total number of threads to process jobs
+ * @return allocated pool on success, NULL on fail with errno set
+ */
+rhash_thread_pool* rhash_thread_pool_new(unsigned threads_count)
+{
+	rhash_thread_pool* pool;
+	unsigned i;
+	if (threads_count < 2) {
+		errno = EINVAL;
+		return NULL;
+	}
+	pool = (rhash_thread_pool*)calloc(1, sizeof(rhash_thread_pool));
+	if (!pool) return NULL;
+	pool->threads = (pthread_t*)malloc(sizeof(pthread_t) * (threads_count - 1));
+	if (!pool->threads) {
+		free(pool);
+		return NULL;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->job_ready, NULL);
+	pthread_cond_init(&pool->job_done, NULL);
+
+	for (i = 0; i < threads_count - 1; i++) {
+		int res = pthread_create(&pool->threads[i], NULL, worker_thread, pool);
+		if (res != 0) {
+			rhash_thread_pool_free(pool);
+			errno = res;
+			return NULL;
+		}
+		pool->threads_count++;
+	}
+	return pool;
+}
+
+/**
+ * Stop worker threads and free the pool.
+ *
+ * @param pool the pool to free
+ */
+void rhash_thread_pool_free(rhash_thread_pool* pool)
+{
+	unsigned i;
+	if (!pool) return;
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->job_ready);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->threads_count; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->job_done);
+	pthread_cond_destroy(&pool->job_ready);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	free(pool);
+}
+
+/**
+ * Return the number of threads processing jobs of the pool.
+ *
+ * @param pool the thread pool, can be NULL
+ * @return the number of threads, including the calling one
+ */
+unsigned rhash_thread_pool_size(rhash_thread_pool* pool)
+{
+	return (pool ? pool->threads_count + 1 : 1);
+}
+
+/**
+ * Call job(data, index) for every index in [0, count) using threads
+ * of the pool. The function returns after all items are processed.
+ *
+ * @param pool the thread pool, can be NULL to run the job serially
+ * @param job the job function
+ * @param data the data passed to the job
+ * @param count the number of items to process
+ */
+void rhash_thread_pool_run(rhash_thread_pool* pool, rhash_job_t job, void* data, unsigned count)
+{
+	unsigned i;
+	if (!pool || count < 2) {
+		for (i = 0; i < count; i++)
+			job(data, i);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->job_data = data;
+	pool->job_count = count;
+	pool->next_index = 0;
+	pool->pending = count;
+	pthread_cond_broadcast(&pool->job_ready);
+
+	process_job_items(pool);
+	while (pool->pending > 0)
+		pthread_cond_wait(&pool->job_done, &pool->lock);
+	pool->job_count = pool->next_index = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+#else /* USE_PTHREADS */
+
+/* without threads support every job runs in the calling thread */
+rhash_thread_pool* rhash_thread_pool_new(unsigned threads_count)
+{
+	(void)threads_count;
+	errno = ENOSYS;
+	return NULL;
+}
+
+void rhash_thread_pool_free(rhash_thread_pool* pool)
+{
+	(void)pool;
+}
+
+unsigned rhash_thread_pool_size(rhash_thread_pool* pool)
+{
+	(void)pool;
+	return 1;
+}
+
+void rhash_thread_pool_run(rhash_thread_pool* pool, rhash_job_t job, void* data, unsigned count)
+{
+	unsigned i;
+	(void)pool;
+	for (i = 0; i < count; i++)
+		job(data, i);
+}
+#endif /* USE_PTHREADS */
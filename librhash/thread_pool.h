@@ -0,0 +1,25 @@
+/* thread_pool.h - a pool of worker threads for parallel hashing */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rhash_thread_pool rhash_thread_pool;
+
+/**
+ * A job, processing the item with the given index.
+ */
+typedef void (*rhash_job_t)(void* data, unsigned index);
+
+rhash_thread_pool* rhash_thread_pool_new(unsigned threads_count);
+void rhash_thread_pool_free(rhash_thread_pool* pool);
+unsigned rhash_thread_pool_size(rhash_thread_pool* pool);
+void rhash_thread_pool_run(rhash_thread_pool* pool, rhash_job_t job, void* data, unsigned count);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* THREAD_POOL_H */
@@ -40,6 +40,13 @@
 #define BT_HASH_SIZE 20
 /** number of SHA1 hashes to store together in one block */
 #define BT_BLOCK_SIZE 256
+/** size of the buffer to collect content, before passing it to the write callback */
+#define BT_WRITE_BUFFER_SIZE 65536
+
+/* flags of the generated content output */
+#define BT_OUTPUT_HASH_INFO 1
+#define BT_OUTPUT_DISCARD 2
+#define BT_OUTPUT_WRITE_ERROR 4
 
 /**
  * Initialize torrent context before calculating hash.
@@ -100,9 +107,14 @@ void bt_cleanup(torrent_ctx *ctx)
 	free(ctx->content.str);
 	ctx->program_name = 0;
 	ctx->content.str = 0;
+	if (ctx->spill_file) {
+		fclose((FILE*)ctx->spill_file);
+		ctx->spill_file = 0;
+	}
 }
 
 static void bt_generate_torrent(torrent_ctx *ctx);
+static void bt_generate_content(torrent_ctx *ctx);
 
 /**
  * Add an item to vector.
@@ -128,32 +140,104 @@ static int bt_vector_add_ptr(torrent_vect* vect, void* item)
 }
 
 /**
- * Store a SHA1 hash of a processed file piece.
+ * Move full blocks of hashes of processed pieces into the temporary
+ * spill file, to keep bounded the memory used by the context.
+ * Blocks are spilled in order, only with the BT_OPT_STREAM option.
  *
  * @param ctx torrent algorithm context
- * @return non-zero on success, zero on fail
  */
-static int bt_store_piece_sha1(torrent_ctx *ctx)
+static void bt_spill_hash_blocks(torrent_ctx *ctx)
+{
+	size_t full_blocks = ctx->piece_count / BT_BLOCK_SIZE;
+	if (!(ctx->options & BT_OPT_STREAM) || full_blocks <= ctx->spilled_blocks)
+		return;
+	if (!ctx->spill_file) {
+		ctx->spill_file = tmpfile();
+		if (!ctx->spill_file)
+			return; /* keep hashes in memory */
+	}
+	/* the file can be read by bt_hash_block(), so reposition it before writing */
+	if (fseek((FILE*)ctx->spill_file, 0, SEEK_END) != 0) {
+		ctx->error = 1;
+		return;
+	}
+	for (; ctx->spilled_blocks < full_blocks; ctx->spilled_blocks++) {
+		void* block = ctx->hash_blocks.array[ctx->spilled_blocks];
+		if (fwrite(block, BT_HASH_SIZE, BT_BLOCK_SIZE, (FILE*)ctx->spill_file) != BT_BLOCK_SIZE) {
+			ctx->error = 1;
+			return;
+		}
+		free(block);
+		ctx->hash_blocks.array[ctx->spilled_blocks] = NULL;
+	}
+}
+
+/**
+ * Get the place to store a SHA1 hash of a file piece. Pieces must be
+ * requested in order, blocks of hashes are allocated on demand.
+ *
+ * @param ctx torrent algorithm context
+ * @param index the index of the piece
+ * @return pointer to the hash on success, NULL on fail
+ */
+static unsigned char* bt_piece_hash_ptr(torrent_ctx *ctx, size_t index)
 {
 	unsigned char* block;
-	unsigned char* hash;
 
-	if ((ctx->piece_count % BT_BLOCK_SIZE) == 0) {
+	if ((index / BT_BLOCK_SIZE) >= ctx->hash_blocks.size) {
+		bt_spill_hash_blocks(ctx);
 		block = (unsigned char*)malloc(BT_HASH_SIZE * BT_BLOCK_SIZE);
 		if (block == NULL || !bt_vector_add_ptr(&ctx->hash_blocks, block)) {
 			if (block) free(block);
-			return 0;
+			return NULL;
 		}
 	} else {
-		block = (unsigned char*)(ctx->hash_blocks.array[ctx->piece_count / BT_BLOCK_SIZE]);
+		block = (unsigned char*)(ctx->hash_blocks.array[index / BT_BLOCK_SIZE]);
 	}
+	return &block[BT_HASH_SIZE * (index % BT_BLOCK_SIZE)];
+}
+
+/**
+ * Store a SHA1 hash of a processed file piece.
+ *
+ * @param ctx torrent algorithm context
+ * @return non-zero on success, zero on fail
+ */
+static int bt_store_piece_sha1(torrent_ctx *ctx)
+{
+	unsigned char* hash = bt_piece_hash_ptr(ctx, ctx->piece_count);
+	if (hash == NULL) return 0;
 
-	hash = &block[BT_HASH_SIZE * (ctx->piece_count % BT_BLOCK_SIZE)];
 	SHA1_FINAL(ctx, hash); /* write the hash */
 	ctx->piece_count++;
 	return 1;
 }
 
+/**
+ * Add hashes of file pieces, calculated before, e.g. loaded from an existing
+ * torrent file. The hashing state must be at a piece boundary.
+ *
+ * @param ctx torrent algorithm context
+ * @param hashes the SHA1 hashes of consecutive pieces
+ * @param count the number of the hashes
+ * @return non-zero on success, zero on fail
+ */
+int bt_add_piece_hashes(torrent_ctx *ctx, const unsigned char* hashes, size_t count)
+{
+	size_t i;
+	if (ctx->index != 0) return 0;
+	for (i = 0; i < count; i++) {
+		unsigned char* hash = bt_piece_hash_ptr(ctx, ctx->piece_count);
+		if (hash == NULL) {
+			ctx->error = 1;
+			return 0;
+		}
+		memcpy(hash, hashes + i * BT_HASH_SIZE, BT_HASH_SIZE);
+		ctx->piece_count++;
+	}
+	return 1;
+}
+
 /**
  * A filepath and filesize information.
  */
@@ -226,6 +310,64 @@ void bt_update(torrent_ctx *ctx, const void* msg, size_t size)
 	}
 }
 
+/* the maximal number of pieces hashed by one call of the thread pool */
+#define BT_MAX_JOB_PIECES 256
+
+/**
+ * Calculate message hash, hashing whole pieces of the message by
+ * threads of the given pool. The pieces hashes are stored by their
+ * indexes, so the result is the same as of bt_update().
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+void bt_update_mt(torrent_ctx *ctx, const void* msg, size_t size, rhash_thread_pool* pool)
+{
+	const unsigned char* pmsg = (const unsigned char*)msg;
+	const void* messages[BT_MAX_JOB_PIECES];
+	size_t lengths[BT_MAX_JOB_PIECES];
+	unsigned char* results[BT_MAX_JOB_PIECES];
+	size_t pieces, count, i;
+
+	/* finish the current piece */
+	if (ctx->index > 0) {
+		size_t rest = ctx->piece_length - ctx->index;
+		if (size < rest) rest = size;
+		bt_update(ctx, pmsg, rest);
+		pmsg += rest;
+		size -= rest;
+	}
+	pieces = size / ctx->piece_length;
+	if (rhash_thread_pool_size(pool) < 2 || pieces < 2) {
+		bt_update(ctx, pmsg, size);
+		return;
+	}
+
+	while (pieces > 0) {
+		count = (pieces < BT_MAX_JOB_PIECES ? pieces : BT_MAX_JOB_PIECES);
+		for (i = 0; i < count; i++) {
+			results[i] = bt_piece_hash_ptr(ctx, ctx->piece_count + i);
+			if (results[i] == NULL) {
+				ctx->error = 1;
+				return;
+			}
+			messages[i] = pmsg;
+			lengths[i] = ctx->piece_length;
+			pmsg += ctx->piece_length;
+		}
+		if (rhash_msg_batch_mt(RHASH_SHA1, messages, lengths, results, count, pool) < 0) {
+			ctx->error = 1;
+			return;
+		}
+		ctx->piece_count += count;
+		pieces -= count;
+		size -= count * ctx->piece_length;
+	}
+	bt_update(ctx, pmsg, size);
+}
+
 /**
  * Finalize hashing and optionally store calculated hash into the given array.
  * If the result parameter is NULL, the hash is not stored, but it is
@@ -240,7 +382,14 @@ void bt_final(torrent_ctx *ctx, unsigned char result[20])
 		bt_store_piece_sha1(ctx); /* flush buffered data */
 	}
 
-	bt_generate_torrent(ctx);
+	if (ctx->options & BT_OPT_STREAM) {
+		/* calculate BTIH only, the content is written by bt_write_content() */
+		ctx->output = BT_OUTPUT_DISCARD;
+		bt_generate_torrent(ctx);
+		ctx->output = 0;
+	} else {
+		bt_generate_content(ctx);
+	}
 	if (result) memcpy(result, ctx->btih, btih_hash_size);
 }
 
@@ -257,7 +406,8 @@ void bt_final(torrent_ctx *ctx, unsigned char result[20])
 static int bt_str_ensure_length(torrent_ctx* ctx, size_t length)
 {
 	char* new_str;
-	if (length >= ctx->content.allocated && !ctx->error) {
+	if (ctx->error) return 0;
+	if (length >= ctx->content.allocated) {
 		length++; /* allocate one character more */
 		if (length < 64) length = 64;
 		else length = (length + 255) & ~255;
@@ -274,22 +424,60 @@ static int bt_str_ensure_length(torrent_ctx* ctx, size_t length)
 }
 
 /**
- * Append a null-terminated string to the string string buffer.
+ * Pass the buffered content to the write callback.
  *
  * @param ctx the torrent algorithm context
- * @param text the null-terminated string to append
  */
-static void bt_str_append(torrent_ctx *ctx, const char* text)
+static void bt_flush_content(torrent_ctx *ctx)
 {
-	size_t length = strlen(text);
+	if (ctx->content.length > 0 && !ctx->error &&
+			ctx->write(ctx->write_data, ctx->content.str, ctx->content.length) < 0)
+		ctx->output |= BT_OUTPUT_WRITE_ERROR;
+	ctx->content.length = 0;
+}
 
+/**
+ * Output a part of the generated torrent file. The part is hashed, if
+ * it belongs to the info dictionary, then it is either appended to the
+ * content buffer, or streamed to the write callback, or discarded.
+ *
+ * @param ctx the torrent algorithm context
+ * @param data the data to output
+ * @param length the length of the data
+ */
+static void bt_output(torrent_ctx *ctx, const void* data, size_t length)
+{
+	if (ctx->output & BT_OUTPUT_HASH_INFO)
+		SHA1_UPDATE(ctx, (const unsigned char*)data, length);
+	if (ctx->output & BT_OUTPUT_DISCARD)
+		return;
+	if (ctx->write) {
+		if (ctx->content.length + length > BT_WRITE_BUFFER_SIZE)
+			bt_flush_content(ctx);
+		if (length >= BT_WRITE_BUFFER_SIZE) {
+			if (!ctx->error && ctx->write(ctx->write_data, data, length) < 0)
+				ctx->output |= BT_OUTPUT_WRITE_ERROR;
+			return;
+		}
+	}
 	if (!bt_str_ensure_length(ctx, ctx->content.length + length)) return;
 	assert(ctx->content.str != 0);
-	memcpy(ctx->content.str + ctx->content.length, text, length);
+	memcpy(ctx->content.str + ctx->content.length, data, length);
 	ctx->content.length += length;
 	ctx->content.str[ctx->content.length] = '\0';
 }
 
+/**
+ * Append a null-terminated string to the generated content.
+ *
+ * @param ctx the torrent algorithm context
+ * @param text the null-terminated string to append
+ */
+static void bt_str_append(torrent_ctx *ctx, const char* text)
+{
+	bt_output(ctx, text, strlen(text));
+}
+
 /**
  * B-encode given integer.
  *
@@ -298,18 +486,28 @@ static void bt_str_append(torrent_ctx *ctx, const char* text)
  */
 static void bt_bencode_int(torrent_ctx* ctx, const char* name, uint64_t number)
 {
-	char* p;
+	char buffer[24]; /* up to 20 digits and 2 letters */
+	char* p = buffer;
 	if (name) bt_str_append(ctx, name);
 
-	/* add up to 20 digits and 2 letters */
-	if (!bt_str_ensure_length(ctx, ctx->content.length + 22)) return;
-	p = ctx->content.str + ctx->content.length;
 	*(p++) = 'i';
 	p += rhash_sprintI64(p, number);
 	*(p++) = 'e';
-	*p = '\0'; /* terminate string with \0 */
+	bt_output(ctx, buffer, p - buffer);
+}
 
-	ctx->content.length = (p - ctx->content.str);
+/**
+ * Output the length prefix of a b-encoded string.
+ *
+ * @param ctx the torrent algorithm context
+ * @param length the length of the string
+ */
+static void bt_bencode_str_length(torrent_ctx* ctx, uint64_t length)
+{
+	char buffer[24];
+	int num_len = rhash_sprintI64(buffer, length);
+	buffer[num_len] = ':';
+	bt_output(ctx, buffer, num_len + 1);
 }
 
 /**
@@ -321,18 +519,29 @@ static void bt_bencode_int(torrent_ctx* ctx, const char* name, uint64_t number)
 static void bt_bencode_str(torrent_ctx* ctx, const char* name, const char* str)
 {
 	size_t len = strlen(str);
-	int num_len;
-	char* p;
-
 	if (name) bt_str_append(ctx, name);
-	if (!bt_str_ensure_length(ctx, ctx->content.length + len + 21)) return;
-
-	p = ctx->content.str + ctx->content.length;
-	p += (num_len = rhash_sprintI64(p, len));
-	ctx->content.length += len + num_len + 1;
+	bt_bencode_str_length(ctx, len);
+	bt_output(ctx, str, len);
+}
 
-	*(p++) = ':';
-	memcpy(p, str, len + 1); /* copy with trailing '\0' */
+/**
+ * Get a block of SHA1 hashes of file pieces. Blocks moved to the spill
+ * file are read from it, so they must be requested in order.
+ *
+ * @param ctx the torrent algorithm context
+ * @param index the index of the block
+ * @param buffer the buffer to read a spilled block into
+ * @return pointer to the block on success, NULL on fail
+ */
+static const unsigned char* bt_hash_block(const torrent_ctx *ctx, size_t index, unsigned char* buffer)
+{
+	FILE* spill_file = (FILE*)ctx->spill_file;
+	if (index >= ctx->spilled_blocks)
+		return (const unsigned char*)ctx->hash_blocks.array[index];
+	if ((index == 0 && fseek(spill_file, 0, SEEK_SET) != 0) ||
+			fread(buffer, BT_HASH_SIZE, BT_BLOCK_SIZE, spill_file) != BT_BLOCK_SIZE)
+		return NULL;
+	return buffer;
 }
 
 /**
@@ -342,27 +551,20 @@ static void bt_bencode_str(torrent_ctx* ctx, const char* name, const char* str)
  */
 static void bt_bencode_pieces(torrent_ctx* ctx)
 {
-	size_t pieces_length = ctx->piece_count * BT_HASH_SIZE;
-	int num_len;
-	int size, i;
-	char* p;
-
-	if (!bt_str_ensure_length(ctx, ctx->content.length + pieces_length + 21))
-		return;
-
-	p = ctx->content.str + ctx->content.length;
-	p += (num_len = rhash_sprintI64(p, pieces_length));
-	ctx->content.length += pieces_length + num_len + 1;
-
-	*(p++) = ':';
-	p[pieces_length] = '\0'; /* terminate with \0 just in case */
-
-	for (size = (int)ctx->piece_count, i = 0; size > 0;
-		size -= BT_BLOCK_SIZE, i++)
-	{
-		memcpy(p, ctx->hash_blocks.array[i],
-			(size < BT_BLOCK_SIZE ? size : BT_BLOCK_SIZE) * BT_HASH_SIZE);
-		p += BT_BLOCK_SIZE * BT_HASH_SIZE;
+	unsigned char buffer[BT_HASH_SIZE * BT_BLOCK_SIZE];
+	const unsigned char* block;
+	size_t size, i;
+
+	bt_bencode_str_length(ctx, (uint64_t)ctx->piece_count * BT_HASH_SIZE);
+	for (size = ctx->piece_count, i = 0; size > 0; i++) {
+		size_t count = (size < BT_BLOCK_SIZE ? size : BT_BLOCK_SIZE);
+		block = bt_hash_block(ctx, i, buffer);
+		if (block == NULL) {
+			ctx->error = 1;
+			return;
+		}
+		bt_output(ctx, block, count * BT_HASH_SIZE);
+		size -= count;
 	}
 }
 
@@ -393,13 +595,21 @@ static const char* bt_get_basename(const char* path)
 	return (p + 1);
 }
 
-/* extract batchname from the path, modifies the path buffer */
-static const char* get_batch_name(char* path)
+/* b-encode the batch name, extracted from the path of the first file */
+static void bt_bencode_batch_name(torrent_ctx *ctx, const char* name, const char* path)
 {
-	char* p = (char*)bt_get_basename(path) - 1;
-	for (; p > path && (*p == '/' || *p == '\\'); p--) *p = 0;
-	if (p <= path) return "BATCH_DIR";
-	return bt_get_basename(path);
+	const char* end = bt_get_basename(path);
+	const char* start;
+	/* skip path separators before the basename */
+	for (; end > path && (end[-1] == '/' || end[-1] == '\\'); end--);
+	if (end <= path + 1) {
+		bt_bencode_str(ctx, name, "BATCH_DIR");
+		return;
+	}
+	for (start = end; start > path && start[-1] != '/' && start[-1] != '\\'; start--);
+	bt_str_append(ctx, name);
+	bt_bencode_str_length(ctx, end - start);
+	bt_output(ctx, start, end - start);
 }
 
 /* write file size and path */
@@ -412,7 +622,8 @@ static void bt_file_info_append(torrent_ctx *ctx, const char* length_name,
 }
 
 /**
- * Generate torrent file content
+ * Generate torrent file content and calculate BTIH.
+ * The content is output by bt_output(), according to ctx->output flags.
  * @see http://wiki.theory.org/BitTorrentSpecification
  *
  * @param ctx the torrent algorithm context
@@ -420,9 +631,6 @@ static void bt_file_info_append(torrent_ctx *ctx, const char* length_name,
 static void bt_generate_torrent(torrent_ctx *ctx)
 {
 	uint64_t total_size = 0;
-	size_t info_start_pos;
-
-	assert(ctx->content.str == NULL);
 
 	if (ctx->piece_length == 0) {
 		if (ctx->files.size == 1) {
@@ -463,8 +671,11 @@ static void bt_generate_torrent(torrent_ctx *ctx)
 
 	/* write the essential for BTIH part of the torrent file */
 
-	bt_str_append(ctx, "4:infod"); /* start the info dictionary */
-	info_start_pos = ctx->content.length - 1;
+	bt_str_append(ctx, "4:info");
+	/* calculate BTIH while writing the info dictionary */
+	SHA1_INIT(ctx);
+	ctx->output |= BT_OUTPUT_HASH_INFO;
+	bt_str_append(ctx, "d"); /* start the info dictionary */
 
 	if (ctx->files.size > 1) {
 		size_t i;
@@ -478,9 +689,8 @@ static void bt_generate_torrent(torrent_ctx *ctx)
 				(bt_file_info*)ctx->files.array[i]);
 			bt_str_append(ctx, "ee");
 		}
-		/* note: get_batch_name modifies path, so should be called here */
-		bt_bencode_str(ctx, "e4:name", get_batch_name(
-			((bt_file_info*)ctx->files.array[0])->path));
+		bt_bencode_batch_name(ctx, "e4:name",
+			((bt_file_info*)ctx->files.array[0])->path);
 	}
 	else if (ctx->files.size > 0) {
 		/* write size and basename of the first file */
@@ -496,13 +706,55 @@ static void bt_generate_torrent(torrent_ctx *ctx)
 	if (ctx->options & BT_OPT_PRIVATE) {
 		bt_str_append(ctx, "7:privatei1e");
 	}
-	bt_str_append(ctx, "ee");
-
-	/* calculate BTIH */
-	SHA1_INIT(ctx);
-	SHA1_UPDATE(ctx, (unsigned char*)ctx->content.str + info_start_pos,
-		ctx->content.length - info_start_pos - 1);
+	bt_str_append(ctx, "e");
+	ctx->output &= ~BT_OUTPUT_HASH_INFO;
 	SHA1_FINAL(ctx, ctx->btih);
+	bt_str_append(ctx, "e");
+}
+
+/**
+ * Generate the content of the torrent file into a memory buffer.
+ *
+ * @param ctx the torrent algorithm context
+ */
+static void bt_generate_content(torrent_ctx *ctx)
+{
+	free(ctx->content.str);
+	memset(&ctx->content, 0, sizeof(ctx->content));
+	ctx->output = 0;
+	bt_generate_torrent(ctx);
+}
+
+/**
+ * Stream the content of the torrent file to the given callback,
+ * without keeping the whole content in memory.
+ * The hashing must be finished by bt_final() before calling this function.
+ *
+ * @param ctx the torrent algorithm context
+ * @param write the callback to write the content by
+ * @param data the data to pass to the callback
+ * @return 0 on success, -1 on fail
+ */
+int bt_write_content(torrent_ctx *ctx, bt_write_t write, void* data)
+{
+	int res;
+	if (ctx->error)
+		return -1;
+	free(ctx->content.str);
+	memset(&ctx->content, 0, sizeof(ctx->content));
+	ctx->write = write;
+	ctx->write_data = data;
+	ctx->output = 0;
+	bt_generate_torrent(ctx);
+	bt_flush_content(ctx);
+	res = (ctx->error || (ctx->output & BT_OUTPUT_WRITE_ERROR) ? -1 : 0);
+
+	free(ctx->content.str);
+	memset(&ctx->content, 0, sizeof(ctx->content));
+	ctx->write = NULL;
+	ctx->write_data = NULL;
+	ctx->output = 0;
+	return res;
 }
 
 /* Getters/Setters */
@@ -586,7 +838,8 @@ int bt_add_announce(torrent_ctx *ctx, const char* announce_url)
 }
 
 /**
- * Get the content of generated torrent file.
+ * Get the content of generated torrent file. With the BT_OPT_STREAM
+ * option the content is generated on the first call.
  *
  * @param ctx the torrent algorithm context
  * @param pstr pointer to pointer receiving the buffer with file content
@@ -594,7 +847,145 @@ int bt_add_announce(torrent_ctx *ctx, const char* announce_url)
  */
 size_t bt_get_text(torrent_ctx *ctx, char** pstr)
 {
-	assert(ctx->content.str);
+	if (!ctx->content.str && (ctx->options & BT_OPT_STREAM))
+		bt_generate_content(ctx);
+	assert(ctx->content.str || ctx->error);
 	*pstr = ctx->content.str;
 	return ctx->content.length;
 }
+
+/* Export/import of the context state */
+
+/**
+ * Export the algorithm context into a memory buffer.
+ * The pieces hashes, files, announce URLs and program name are stored
+ * after the context structure. Exported data can be imported only by
+ * the same build of the library.
+ *
+ * @param ctx the torrent algorithm context
+ * @param out the buffer to export the context into, can be NULL
+ * @param size size of the buffer
+ * @return the size of exported data, or 0 if the buffer is too small or on error
+ */
+size_t bt_export(const torrent_ctx *ctx, void* out, size_t size)
+{
+	size_t export_size = sizeof(torrent_ctx) + ctx->piece_count * BT_HASH_SIZE;
+	unsigned char buffer[BT_HASH_SIZE * BT_BLOCK_SIZE];
+	const unsigned char* block;
+	char* p = (char*)out;
+	size_t i, length;
+
+	for (i = 0; i < ctx->files.size; i++)
+		export_size += sizeof(uint64_t) + strlen(((bt_file_info*)ctx->files.array[i])->path) + 1;
+	for (i = 0; i < ctx->announce.size; i++)
+		export_size += strlen((char*)ctx->announce.array[i]) + 1;
+	if (ctx->program_name)
+		export_size += strlen(ctx->program_name) + 1;
+	if (!out) return export_size;
+	if (size < export_size) return 0;
+
+	memcpy(p, ctx, sizeof(torrent_ctx));
+	p += sizeof(torrent_ctx);
+	for (i = 0; i < ctx->piece_count; i += BT_BLOCK_SIZE) {
+		length = ctx->piece_count - i;
+		if (length > BT_BLOCK_SIZE) length = BT_BLOCK_SIZE;
+		block = bt_hash_block(ctx, i / BT_BLOCK_SIZE, buffer);
+		if (!block) return 0;
+		memcpy(p, block, length * BT_HASH_SIZE);
+		p += length * BT_HASH_SIZE;
+	}
+	for (i = 0; i < ctx->files.size; i++) {
+		bt_file_info* info = (bt_file_info*)ctx->files.array[i];
+		length = strlen(info->path) + 1;
+		memcpy(p, &info->size, sizeof(uint64_t));
+		memcpy(p + sizeof(uint64_t), info->path, length);
+		p += sizeof(uint64_t) + length;
+	}
+	for (i = 0; i < ctx->announce.size; i++) {
+		length = strlen((char*)ctx->announce.array[i]) + 1;
+		memcpy(p, ctx->announce.array[i], length);
+		p += length;
+	}
+	if (ctx->program_name) {
+		length = strlen(ctx->program_name) + 1;
+		memcpy(p, ctx->program_name, length);
+		p += length;
+	}
+	assert((size_t)(p - (char*)out) == export_size);
+	return export_size;
+}
+
+/**
+ * Get the length of a null-terminated string stored in a buffer.
+ *
+ * @param str the string
+ * @param end the end of the buffer
+ * @return the string length including the terminating '\0', 0 if not terminated
+ */
+static size_t bt_imported_str_length(const char* str, const char* end)
+{
+	const char* zero = (const char*)memchr(str, '\0', end - str);
+	return (zero ? (size_t)(zero - str) + 1 : 0);
+}
+
+/**
+ * Import the algorithm context, exported by bt_export().
+ * The context must be freshly initialized by bt_init().
+ *
+ * @param ctx the torrent algorithm context to import data into
+ * @param in the exported data
+ * @param size size of the exported data
+ * @return the size of imported data, 0 on error
+ */
+size_t bt_import(torrent_ctx *ctx, const void* in, size_t size)
+{
+	const char* p = (const char*)in;
+	const char* end = p + size;
+	torrent_ctx saved;
+	unsigned char* hash;
+	uint64_t file_size;
+	size_t i, length;
+
+	if (size < sizeof(torrent_ctx)) return 0;
+	memcpy(&saved, p, sizeof(torrent_ctx));
+	p += sizeof(torrent_ctx);
+	if (saved.error || saved.piece_length == 0 || saved.index >= saved.piece_length ||
+			saved.piece_count > (size_t)(end - p) / BT_HASH_SIZE)
+		return 0;
+
+	for (i = 0; i < saved.piece_count; i++, p += BT_HASH_SIZE) {
+		hash = bt_piece_hash_ptr(ctx, i);
+		if (!hash) return 0;
+		memcpy(hash, p, BT_HASH_SIZE);
+	}
+	for (i = 0; i < saved.files.size; i++) {
+		if ((size_t)(end - p) <= sizeof(uint64_t)) return 0;
+		memcpy(&file_size, p, sizeof(uint64_t));
+		p += sizeof(uint64_t);
+		length = bt_imported_str_length(p, end);
+		if (!length || !bt_add_file(ctx, p, file_size)) return 0;
+		p += length;
+	}
+	for (i = 0; i < saved.announce.size; i++) {
+		length = bt_imported_str_length(p, end);
+		if (!length || !bt_add_announce(ctx, p)) return 0;
+		p += length;
+	}
+	if (saved.program_name) {
+		length = bt_imported_str_length(p, end);
+		if (!length || !bt_set_program_name(ctx, p)) return 0;
+		p += length;
+	}
+
+	/* restore the hashing state, keeping own methods and allocated memory */
+	memcpy(ctx->btih, saved.btih, sizeof(ctx->btih));
+	memcpy(&ctx->sha1_context, &saved.sha1_context, sizeof(ctx->sha1_context));
+#if defined(USE_OPENSSL) || defined(OPENSSL_RUNTIME)
+	memcpy(&ctx->reserved, &saved.reserved, sizeof(ctx->reserved));
+#endif
+	ctx->options = saved.options;
+	ctx->index = saved.index;
+	ctx->piece_length = saved.piece_length;
+	ctx->piece_count = saved.piece_count;
+	return (size_t)(p - (const char*)in);
+}
@@ -3,6 +3,7 @@
 #define TORRENT_H
 #include "ustd.h"
 #include "sha1.h"
+#include "thread_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +27,9 @@ typedef struct torrent_str
 	size_t allocated;
 } torrent_str;
 
+/* callback to write generated torrent file content, returns negative value on error */
+typedef int (*bt_write_t)(void* data, const void* buffer, size_t size);
+
 /* BitTorrent algorithm context */
 typedef struct torrent_ctx
 {
@@ -45,23 +49,34 @@ typedef struct torrent_ctx
 	char* program_name;       /* the name of the program */
 
 	torrent_str content;      /* the content of generated torrent file */
+	void* spill_file;         /* temporary file storing blocks of hashes */
+	size_t spilled_blocks;    /* the number of blocks moved to the spill file */
+	bt_write_t write;         /* callback to stream generated content to */
+	void* write_data;         /* the data passed to the write callback */
+	unsigned output;          /* flags of the content being generated */
 	int error; /* non-zero if error occurred, zero otherwise */
 } torrent_ctx;
 
 void bt_init(torrent_ctx *ctx);
 void bt_update(torrent_ctx *ctx, const void* msg, size_t size);
+void bt_update_mt(torrent_ctx *ctx, const void* msg, size_t size, rhash_thread_pool* pool);
 void bt_final(torrent_ctx *ctx, unsigned char result[20]);
 void bt_cleanup(torrent_ctx *ctx);
 
 unsigned char* bt_get_btih(torrent_ctx *ctx);
 size_t bt_get_text(torrent_ctx *ctx, char** pstr);
+int bt_write_content(torrent_ctx *ctx, bt_write_t write, void* data);
+size_t bt_export(const torrent_ctx *ctx, void* out, size_t size);
+size_t bt_import(torrent_ctx *ctx, const void* in, size_t size);
 
 /* possible options */
 #define BT_OPT_PRIVATE 1
 #define BT_OPT_INFOHASH_ONLY 2
+#define BT_OPT_STREAM 4
 
 void bt_set_options(torrent_ctx *ctx, unsigned options);
 int  bt_add_file(torrent_ctx *ctx, const char* path, uint64_t filesize);
+int  bt_add_piece_hashes(torrent_ctx *ctx, const unsigned char* hashes, size_t count);
 int  bt_add_announce(torrent_ctx *ctx, const char* announce_url);
 int  bt_set_program_name(torrent_ctx *ctx, const char* name);
 void bt_set_piece_length(torrent_ctx *ctx, size_t piece_length);
@@ -31,27 +31,46 @@ void rhash_tth_init(tth_ctx *ctx)
 }
 
 /**
- * The core transformation.
+ * Add the root hash of a complete subtree of 2^level leaves to the tree.
+ * The number of already processed leaves must be a multiple of 2^level.
  *
  * @param ctx algorithm state
+ * @param hash the root hash of the subtree
+ * @param level the height of the subtree
  */
-static void rhash_tth_process_block(tth_ctx *ctx)
+static void rhash_tth_add_subtree(tth_ctx *ctx, const unsigned char hash[24], unsigned level)
 {
 	uint64_t it;
-	unsigned pos = 0;
+	unsigned pos = level * 3;
 	unsigned char msg[24];
 
-	for (it = 1; it & ctx->block_count; it <<= 1) {
-		rhash_tiger_final(&ctx->tiger, msg);
+	memcpy(msg, hash, 24);
+	for (it = (uint64_t)1 << level; it & ctx->block_count; it <<= 1) {
 		rhash_tiger_init(&ctx->tiger);
 		ctx->tiger.message[ctx->tiger.length++] = 0x01;
 		rhash_tiger_update(&ctx->tiger, (unsigned char*)(ctx->stack + pos), 24);
-		/* note: we can cut this step, if the previous rhash_tiger_final saves directly to ctx->tiger.message+25; */
 		rhash_tiger_update(&ctx->tiger, msg, 24);
+		rhash_tiger_final(&ctx->tiger, msg);
 		pos += 3;
 	}
-	rhash_tiger_final(&ctx->tiger, (unsigned char*)(ctx->stack + pos));
-	ctx->block_count++;
+	memcpy(ctx->stack + pos, msg, 24);
+	ctx->block_count += (uint64_t)1 << level;
+
+	/* init hash of the next leaf */
+	rhash_tiger_init(&ctx->tiger);
+	ctx->tiger.message[ ctx->tiger.length++ ] = 0x00;
+}
+
+/**
+ * The core transformation.
+ *
+ * @param ctx algorithm state
+ */
+static void rhash_tth_process_block(tth_ctx *ctx)
+{
+	unsigned char msg[24];
+	rhash_tiger_final(&ctx->tiger, msg);
+	rhash_tth_add_subtree(ctx, msg, 0);
 }
 
 /**
@@ -76,14 +95,97 @@ void rhash_tth_update(tth_ctx *ctx, const unsigned char* msg, size_t size)
 
 		/* process block hash */
 		rhash_tth_process_block(ctx);
-
-		/* init block hash */
-		rhash_tiger_init(&ctx->tiger);
-		ctx->tiger.message[ ctx->tiger.length++ ] = 0x00;
 		rest = 1024;
 	}
 }
 
+/* the maximal number of subtrees hashed by one call of the thread pool */
+#define TTH_MAX_JOBS 64
+/* the minimal number of leaves per thread to start multi-threaded hashing */
+#define TTH_MIN_THREAD_LEAVES 16
+
+/**
+ * A complete subtree of leaves, hashed by a thread.
+ */
+struct tth_job
+{
+	const unsigned char* msg;
+	unsigned level;
+	unsigned char hash[24];
+};
+
+/**
+ * Calculate the root hash of a subtree.
+ *
+ * @param data array of tth_job structures
+ * @param index index of the job to process
+ */
+static void rhash_tth_subtree_job(void* data, unsigned index)
+{
+	struct tth_job* job = (struct tth_job*)data + index;
+	tth_ctx ctx;
+	rhash_tth_init(&ctx);
+	rhash_tth_update(&ctx, job->msg, (size_t)tth_leaf_size << job->level);
+	rhash_tth_final(&ctx, job->hash);
+}
+
+/**
+ * Calculate message hash, splitting the message leaves between threads.
+ * Every thread hashes complete subtrees of leaves, which are merged
+ * into the tree in the message order, so the result is the same as
+ * of rhash_tth_update().
+ *
+ * @param ctx the algorithm context containing current hashing state
+ * @param msg message chunk
+ * @param size length of the message chunk
+ * @param pool the thread pool, can be NULL
+ */
+void rhash_tth_update_mt(tth_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool)
+{
+	struct tth_job jobs[TTH_MAX_JOBS];
+	unsigned threads = rhash_thread_pool_size(pool);
+	size_t rest = 1025 - (size_t)ctx->tiger.length;
+	uint64_t leaves, max_leaves, block_count;
+	unsigned count, i;
+
+	/* finish the current leaf */
+	if (rest < tth_leaf_size) {
+		if (size < rest) rest = size;
+		rhash_tth_update(ctx, msg, rest);
+		msg += rest;
+		size -= rest;
+	}
+	leaves = size / tth_leaf_size;
+	if (threads < 2 || leaves < (uint64_t)threads * TTH_MIN_THREAD_LEAVES) {
+		rhash_tth_update(ctx, msg, size);
+		return;
+	}
+	size -= (size_t)leaves * tth_leaf_size;
+
+	/* give about four subtrees to every thread */
+	for (max_leaves = 1; max_leaves * 2 <= leaves / (threads * 4); max_leaves <<= 1);
+
+	while (leaves > 0) {
+		block_count = ctx->block_count;
+		for (count = 0; count < TTH_MAX_JOBS && leaves > 0; count++) {
+			unsigned level = 0;
+			/* a subtree of 2^level leaves must start at a multiple of 2^level */
+			while (((uint64_t)2 << level) <= max_leaves && ((uint64_t)2 << level) <= leaves &&
+					(block_count & (((uint64_t)2 << level) - 1)) == 0)
+				level++;
+			jobs[count].msg = msg;
+			jobs[count].level = level;
+			msg += (size_t)tth_leaf_size << level;
+			block_count += (uint64_t)1 << level;
+			leaves -= (uint64_t)1 << level;
+		}
+		rhash_thread_pool_run(pool, rhash_tth_subtree_job, jobs, count);
+		for (i = 0; i < count; i++)
+			rhash_tth_add_subtree(ctx, jobs[i].hash, jobs[i].level);
+	}
+	rhash_tth_update(ctx, msg, size);
+}
+
 /**
  * Store calculated hash into the given array.
  *
@@ -3,11 +3,14 @@
 
 #include "ustd.h"
 #include "tiger.h"
+#include "thread_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define tth_leaf_size 1024
+
 /* algorithm context */
 typedef struct tth_ctx
 {
@@ -20,7 +23,8 @@ typedef struct tth_ctx
 
 void rhash_tth_init(tth_ctx *ctx);
 void rhash_tth_update(tth_ctx *ctx, const unsigned char* msg, size_t size);
-void rhash_tth_final(tth_ctx *ctx, unsigned char result[64]);
+void rhash_tth_final(tth_ctx *ctx, unsigned char result[24]);
+void rhash_tth_update_mt(tth_ctx *ctx, const unsigned char* msg, size_t size, rhash_thread_pool* pool);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -1,145 +1,140 @@
 /* line_set.c - functions to manipulate a set of files */
 #include <assert.h>
-#include <ctype.h>  /* isspace */
-#include <stddef.h> /* ptrdiff_t */
-#include <stdlib.h> /* qsort */
+#include <stdlib.h>
 #include <string.h>
 
 #include "line_set.h"
 #include "common_func.h"
-#include "hash_print.h"
-#include "output.h"
-#include "parse_cmdline.h"
-#include "rhash_main.h"
-#include "librhash/rhash.h"
+
+#define LINE_SET_MIN_TABLE_SIZE 64
 
 /**
- * Set line and inode of the given item.
+ * Calculate the hash of a (device, inode) pair.
  *
- * @param item pointer to the item to change
- * @param line the line to set
- * @param inode the inode to set
+ * @param dev the device number
+ * @param inode the inode number
+ * @return the hash of the pair
  */
-static int line_set_item_set_line(line_set_item* item, const char* line)
+static uint64_t line_set_make_hash(uint64_t dev, uint64_t inode)
 {
-	free(item->line);
-	item->line = rsh_strdup(line);
-	if (!item->line) return 0;
-
-	return 1;
+	/* multiply by the 64-bit golden ratio, to spread sequential inodes */
+	uint64_t hash = (inode ^ (dev << 32 | dev >> 32)) * ((((uint64_t)0x9e3779b9) << 32) | 0x7f4a7c15);
+	return hash ^ (hash >> 32);
 }
 
 /**
- * Allocate a inode_line_set_item structure and initialize it with a line and an inode.
+ * Allocate an empty inode_line_set.
  *
- * @param line a line to initialize the inode_line_set_item
- * @param inode an inode to initialize the inode_line_set_item
- * @param path_offset offset of the file path inside the line string
- * @param path_len length of the file path inside the line string
- * @return allocated inode_line_set_item structure
+ * @param arena the arena to allocate items from
+ * @return allocated inode_line_set
  */
-line_set_item *line_set_item_new(const char *line, const ino_t inode, const time_t mtime, const short path_offset, const short path_len)
+inode_line_set* line_set_new(rsh_arena* arena)
 {
-	line_set_item *item = (line_set_item*)rsh_malloc(sizeof(line_set_item));
-	memset(item, 0, sizeof(line_set_item));
-
-	if (line) {
-		if (!line_set_item_set_line(item, line)) {
-			free(item);
-			return NULL;
-		}
-		item->inode = inode;
-		item->mtime = mtime;
-        item->path_offset = path_offset;
-        item->path_len = path_len;
-	}
-	return item;
+	inode_line_set* set = (inode_line_set*)rsh_malloc(sizeof(inode_line_set));
+	memset(set, 0, sizeof(inode_line_set));
+	set->arena = arena;
+	return set;
 }
 
 /**
- * Free memory allocated by inode_line_set_item.
+ * Free memory allocated by inode_line_set. The items are released with the arena.
  *
- * @param item the item to delete
+ * @param set the set to free
  */
-void line_set_item_free(line_set_item *item)
+void line_set_free(inode_line_set* set)
 {
-	free(item->line);
-	free(item);
+	if (!set) return;
+	free(set->table);
+	free(set);
 }
 
 /**
- * Call-back function to compare two items by inode
+ * Find the table slot of a (device, inode) pair, which is either the slot
+ * of the item with this pair or the empty slot to insert the item to.
  *
- * @param pp_rec1 the first item to compare
- * @param pp_rec2 the second item to compare
- * @return 0 if items are equal, -1 if pp_rec1 &lt; pp_rec2, 1 otherwise
+ * @param set the inode_line_set to search
+ * @param dev the device number
+ * @param inode the inode number
+ * @return pointer to the table slot
  */
-static int inode_pp_rec_compare(const void *pp_rec1, const void *pp_rec2)
+static line_set_item** line_set_find_slot(inode_line_set* set, uint64_t dev, uint64_t inode)
 {
-	const line_set_item *rec1 = *(line_set_item *const *)pp_rec1;
-	const line_set_item *rec2 = *(line_set_item *const *)pp_rec2;
-	if (rec1->inode != rec2->inode)
-	    return (rec1->inode < rec2->inode ? -1 : 1);
-	return 0;
+	size_t mask = set->table_size - 1;
+	size_t index = (size_t)line_set_make_hash(dev, inode) & mask;
+	for (; set->table[index]; index = (index + 1) & mask) {
+		if (set->table[index]->inode == inode && set->table[index]->dev == dev)
+			break;
+	}
+	return &set->table[index];
 }
 
 /**
- * Sort given inode_line_set using hashes of search_filepath for fast binary search.
+ * Double the size of the hash table and re-insert all items into it.
  *
- * @param set the inode_line_set to sort
+ * @param set the inode_line_set to resize the table of
  */
-void line_set_sort(inode_line_set *set)
+static void line_set_grow_table(inode_line_set* set)
 {
-	if (set->array) qsort(set->array, set->size, sizeof(line_set_item*), inode_pp_rec_compare);
+	line_set_item** old_table = set->table;
+	size_t old_size = set->table_size;
+	size_t i;
+
+	set->table_size = (old_size ? old_size * 2 : LINE_SET_MIN_TABLE_SIZE);
+	set->table = (line_set_item**)rsh_calloc(set->table_size, sizeof(line_set_item*));
+	for (i = 0; i < old_size; i++) {
+		if (old_table[i])
+			*line_set_find_slot(set, old_table[i]->dev, old_table[i]->inode) = old_table[i];
+	}
+	free(old_table);
 }
 
 /**
- * Create and add a inode_line_set_item with given filepath to given inode_line_set
+ * Create and add a line_set_item with given line to given inode_line_set.
+ * A line is not added, if the set already contains a line with the same inode.
  *
  * @param set the inode_line_set to add the item to
  * @param line a line to initialize the inode_line_set_item
- * @param inode an inode to initialize the inode_line_set_item
  * @param path_offset offset of the file path inside the line string
  * @param path_len length of the file path inside the line string
+ * @param dev the device number of the file
+ * @param inode the inode number of the file
+ * @param mtime the modification time of the file
  */
-void line_set_add_line(inode_line_set *set, const char *line, const short path_offset, const short path_len, const ino_t inode, const time_t mtime)
+void line_set_add_line(inode_line_set *set, const char *line, short path_offset, short path_len,
+	uint64_t dev, uint64_t inode, time_t mtime)
 {
-	line_set_item* item = line_set_item_new(line, inode, mtime, path_offset, path_len);
-	if (item) line_set_add(set, item);
+	line_set_item** slot;
+	line_set_item* item;
+
+	/* keep the table at most half full */
+	if ((set->size + 1) * 2 > set->table_size)
+		line_set_grow_table(set);
+	slot = line_set_find_slot(set, dev, inode);
+	if (*slot)
+		return;
+
+	item = (line_set_item*)rsh_arena_alloc(set->arena, sizeof(line_set_item));
+	item->dev = dev;
+	item->inode = inode;
+	item->mtime = mtime;
+	item->line = rsh_arena_strdup(set->arena, line);
+	item->path_offset = path_offset;
+	item->path_len = path_len;
+	*slot = item;
+	set->size++;
 }
 
 /**
- * Find a file path in the inode_line_set.
+ * Find a line by the device and inode numbers of its file.
  *
  * @param set the inode_line_set to search
- * @param filepath the file path to search for
- * @return file index if filepath is found, -1 otherwise
+ * @param dev the device number to search for
+ * @param inode the inode number to search for
+ * @return the found item, NULL if there is no such item
  */
-int line_set_exist(inode_line_set *set, const ino_t inode)
+line_set_item* line_set_find(inode_line_set *set, uint64_t dev, uint64_t inode)
 {
-	int a, b, c;
-	int cmp, res = -1;
-
-	if (!set->size) return -1; /* not found */
-	assert(set->array != NULL);
-
-	/* fast binary search */
-	for (a = -1, b = (int)set->size; (a + 1) < b;) {
-		line_set_item *item;
-
-		c = (a + b) / 2;
-		assert(0 <= c && c < (int)set->size);
-
-		item = (line_set_item*)set->array[c];
-		if (inode != item->inode) {
-			cmp = (inode < item->inode ? -1 : 1);
-		} else {
-            res = c; /* file path has been found */
-            break;
-		}
-		if (cmp < 0) b = c;
-		else a = c;
-	}
-
-	return res;
+	if (!set->size) return NULL; /* not found */
+	assert(set->table != NULL);
+	return *line_set_find_slot(set, dev, inode);
 }
@@ -9,32 +9,36 @@ extern "C" {
 #endif
 
 /**
- * Entire hash-file line with its inode number (for fast search).
+ * Entire hash-file line with the device and inode numbers of its file (for fast search).
  */
 typedef struct inode_line_set_item
 {
-	ino_t inode;
-    time_t mtime;
+	uint64_t dev;
+	uint64_t inode;
+	time_t mtime;
 	char* line;
 	short path_offset;
 	short path_len;
 } line_set_item;
 
-/* array to store filenames from a parsed hash file */
-struct vector_t;
-typedef struct vector_t inode_line_set;
-
-#define line_set_new() rsh_vector_new((void(*)(void*))line_set_item_free) /* allocate new file set */
-#define line_set_free(set) rsh_vector_free(set) /* free memory */
-#define line_set_get(set, index) ((line_set_item*)((set)->array[index])) /* get i-th element */
-#define line_set_add(set, item) rsh_vector_add_ptr(set, item) /* add a inode_line_set_item to inode_line_set */
-
-void line_set_item_free(line_set_item *item);
-void line_set_add_line(inode_line_set *set, const char *line, const short path_offset, const short path_len, const ino_t inode, const time_t mtime);
-void line_set_sort(inode_line_set *set);
-void inode_line_set_sort_by_path(inode_line_set *set);
-line_set_item *line_set_item_new(const char *line, const ino_t inode, const time_t mtime, const short path_offset, const short path_len);
-int line_set_exist(inode_line_set *set, const ino_t inode);
+/**
+ * A set of hash-file lines, indexed by an open addressing hash table
+ * on the (device, inode) pair. The items and their lines are allocated
+ * from an arena, which must outlive the set.
+ */
+typedef struct inode_line_set
+{
+	line_set_item** table; /* the hash table with linear probing */
+	size_t table_size;     /* the number of table slots, a power of two */
+	size_t size;           /* the number of items */
+	rsh_arena* arena;      /* the memory of the items and their lines */
+} inode_line_set;
+
+inode_line_set* line_set_new(rsh_arena* arena);
+void line_set_free(inode_line_set* set);
+void line_set_add_line(inode_line_set *set, const char *line, short path_offset, short path_len,
+	uint64_t dev, uint64_t inode, time_t mtime);
+line_set_item* line_set_find(inode_line_set *set, uint64_t dev, uint64_t inode);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -153,7 +153,7 @@ static void print_verbose_error(struct file_info *info)
 			char *expected_hash = info->hc.data + hv->offset;
 			unsigned hid = hv->hash_id;
 			int pflags;
-			if ((info->hc.wrong_hashes & (1 << i)) == 0) continue;
+			if ((info->hc.wrong_hashes & (1u << i)) == 0) continue;
 
 			assert(hid != 0);
 
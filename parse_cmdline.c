@@ -1,6 +1,7 @@
 /* parse_cmdline.c - parsing of command line options */
 
 #include <assert.h>
+#include <errno.h>
 #include <locale.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -88,11 +89,18 @@ static void print_help(void)
 	print_help_line("      --has160  ", hash_sum_format, "HAS-160");
 	print_help_line("      --edonr256, --edonr512  ", hash_sum_format, "EDON-R 256/512");
 	print_help_line("      --snefru128, --snefru256  ", hash_sum_format, "SNEFRU-128/256");
+	print_help_line("      --blake2s, --blake2b  ", hash_sum_format, "BLAKE2s/BLAKE2b");
+	print_help_line("      --blake3  ", hash_sum_format, "BLAKE3");
 	print_help_line("  -a, --all     ", _("Calculate all supported hashes.\n"));
 	print_help_line("  -c, --check   ", _("Check hash files specified by command line.\n"));
 	print_help_line("  -u, --update  ", _("Update hash files specified by command line.\n"));
+	print_help_line("      --update-index ", _("Keep a binary .idx index of updated hash files.\n"));
 	print_help_line("  -e, --embed-crc  ", _("Rename files by inserting crc32 sum into name.\n"));
 	print_help_line("  -k, --check-embedded  ", _("Verify files by crc32 sum embedded in their names.\n"));
+	print_help_line("      --block-index ", _("Save hashes of file blocks to a .rhi file beside each file.\n"));
+	print_help_line("      --check-blocks ", _("Verify file blocks by their .rhi index and print corrupted byte ranges.\n"));
+	print_help_line("      --range=<start>[-<end>] ", _("Verify only the given byte range of files.\n"));
+	print_help_line("      --fail-fast ", _("Stop verification at the first corrupted block.\n"));
 	print_help_line("      --list-hashes  ", _("List the names of supported hashes, one per line.\n"));
 	print_help_line("  -B, --benchmark  ", _("Benchmark selected algorithm.\n"));
 	print_help_line("  -v, --verbose ", _("Be verbose.\n"));
@@ -104,6 +112,9 @@ static void print_help(void)
 	print_help_line("      --percents   ", _("Show percents, while calculating or checking hashes.\n"));
 	print_help_line("      --speed   ", _("Output per-file and total processing speed.\n"));
 	print_help_line("      --maxdepth=<n> ", _("Descend at most <n> levels of directories.\n"));
+	print_help_line("      --threads=<n>  ", _("Calculate hash sums of <n> files in parallel.\n"));
+	print_help_line("      --direct-io  ", _("Read files bypassing the system file cache.\n"));
+	print_help_line("      --checkpoint=<file> ", _("Save hashing progress to resume interrupted hashing.\n"));
 	if (rhash_is_openssl_supported())
 		print_help_line("      --openssl=<list> ", _("List hash functions to be calculated using OpenSSL.\n"));
 	print_help_line("  -o, --output=<file> ", _("File to output calculation or checking results.\n"));
@@ -129,8 +140,8 @@ static void print_help(void)
  */
 static void list_hashes(void)
 {
-	int id;
-	for (id = 1; id < RHASH_ALL_HASHES; id <<= 1) {
+	unsigned id;
+	for (id = 1; id & RHASH_ALL_HASHES; id <<= 1) {
 		const char* hash_name = rhash_get_name(id);
 		if (hash_name) rsh_fprintf(rhash_data.out, "%s\n", hash_name);
 	}
@@ -213,7 +224,7 @@ static void openssl_flags(options_t *o, char* openssl_hashes, unsigned type)
 			next = strchr(cur, ',');
 			length = (next != NULL ? (size_t)(next++ - cur) : strlen(cur));
 
-			for (bit = 1; bit <= RHASH_ALL_HASHES; bit = bit << 1, info++) {
+			for (bit = 1; bit & RHASH_ALL_HASHES; bit = bit << 1, info++) {
 				if ( (bit & openssl_supported_hashes) &&
 					memcmp(cur, info->short_name, length) == 0 &&
 					info->short_name[length] == 0) {
@@ -221,7 +232,7 @@ static void openssl_flags(options_t *o, char* openssl_hashes, unsigned type)
 						break;
 				}
 			}
-			if (bit > RHASH_ALL_HASHES) {
+			if ((bit & RHASH_ALL_HASHES) == 0) {
 				cur[length] = '\0'; /* terminate wrong hash name */
 				log_warning(_("openssl option doesn't support '%s' hash\n"), cur);
 			}
@@ -269,6 +280,33 @@ static void set_max_depth(options_t *o, char* number, unsigned param)
 	o->find_max_depth = atoi(number);
 }
 
+/* the maximal number of threads, each thread can allocate a hashing context */
+#define MAX_THREADS 256
+
+/**
+ * Process on --threads option.
+ *
+ * @param o pointer to the processed option
+ * @param number the string containing the number of threads
+ * @param param unused parameter
+ */
+static void set_threads(options_t *o, char* number, unsigned param)
+{
+	unsigned long threads;
+	(void)param;
+	if (strspn(number, "0123456789") < strlen(number) || !*number) {
+		log_error(_("threads parameter is not a number: %s\n"), number);
+		rsh_exit(2);
+	}
+	errno = 0;
+	threads = strtoul(number, NULL, 10);
+	if (errno == ERANGE || threads > MAX_THREADS) {
+		log_warning(_("too many threads, using %u\n"), MAX_THREADS);
+		threads = MAX_THREADS;
+	}
+	o->threads = (unsigned)threads;
+}
+
 /**
  * Set the length of a BitTorrent file piece.
  *
@@ -286,6 +324,56 @@ static void set_bt_piece_length(options_t *o, char* number, unsigned param)
 	o->bt_piece_length = (size_t)atoi(number);
 }
 
+/**
+ * Parse a decimal number, stopping at the first non-digit character.
+ *
+ * @param str the string to parse
+ * @param end pointer to receive the position after the parsed number,
+ *            or the position of the first digit if the number overflows
+ * @return the parsed number
+ */
+static uint64_t parse_uint64(const char* str, const char** end)
+{
+	const char* start = str;
+	uint64_t number = 0;
+	for (; *str >= '0' && *str <= '9'; str++) {
+		unsigned digit = (unsigned)(*str - '0');
+		if (number > (~(uint64_t)0 - digit) / 10) {
+			*end = start;
+			return 0;
+		}
+		number = number * 10 + digit;
+	}
+	*end = str;
+	return number;
+}
+
+/**
+ * Process a --range option, specifying a byte range of files to verify.
+ *
+ * @param o pointer to the processed option
+ * @param range the string containing the start and optionally the end of the range
+ * @param param unused parameter
+ */
+static void set_block_range(options_t *o, char* range, unsigned param)
+{
+	const char* end = range;
+	(void)param;
+	if (*range >= '0' && *range <= '9') {
+		o->block_range_start = parse_uint64(range, &end);
+		o->block_range_end = 0;
+		if (*end == '-' && end[1] >= '0' && end[1] <= '9') {
+			o->block_range_end = parse_uint64(end + 1, &end);
+			if (o->block_range_end <= o->block_range_start)
+				end = range;
+		}
+	}
+	if (end == range || *end != '\0') {
+		log_error(_("invalid byte range: %s\n"), range);
+		rsh_exit(2);
+	}
+}
+
 /**
  * Set the path separator to use when printing paths
  *
@@ -350,6 +438,7 @@ cmdline_opt_t cmdline_opt[] =
 	{ F_UFLG, 'u',   0, "update", &opt.mode, MODE_UPDATE },
 	{ F_UFLG, 'B',   0, "benchmark", &opt.mode, MODE_BENCHMARK },
 	{ F_UFLG,   0,   0, "torrent", &opt.mode, MODE_TORRENT },
+	{ F_UFLG,   0,   0, "check-blocks", &opt.mode, MODE_CHECK_BLOCKS },
 	{ F_VFNC,   0,   0, "list-hashes", list_hashes, 0 },
 	{ F_VFNC, 'h',   0, "help",   print_help, 0 },
 	{ F_VFNC, 'V',   0, "version", print_version, 0 },
@@ -388,7 +477,10 @@ cmdline_opt_t cmdline_opt[] =
 	{ F_UFLG,   0,   0, "snefru256", &opt.sum_flags, RHASH_SNEFRU256 },
 	{ F_UFLG,   0,   0, "edonr256",  &opt.sum_flags, RHASH_EDONR256 },
 	{ F_UFLG,   0,   0, "edonr512",  &opt.sum_flags, RHASH_EDONR512 },
-	{ F_UFLG, 'L',   0, "ed2k-link", &opt.sum_flags, OPT_ED2K_LINK },
+	{ F_UFLG,   0,   0, "blake2s",   &opt.sum_flags, RHASH_BLAKE2S },
+	{ F_UFLG,   0,   0, "blake2b",   &opt.sum_flags, RHASH_BLAKE2B },
+	{ F_UFLG,   0,   0, "blake3",    &opt.sum_flags, RHASH_BLAKE3 },
+	{ F_UFLG, 'L',   0, "ed2k-link", &opt.flags, OPT_ED2K_LINK },
 
 	/* output formats */
 	{ F_UFLG,   0,   0, "sfv",     &opt.fmt, FMT_SFV },
@@ -410,9 +502,15 @@ cmdline_opt_t cmdline_opt[] =
 	{ F_UFLG,   0,   0, "skip-ok", &opt.flags, OPT_SKIP_OK },
     {F_UFLG,    0,   0, "detect-changes", &opt.flags, OPT_DETECT_CHANGES },
     { F_UFLG,   0,   0, "remove-missing", &opt.flags, OPT_REMOVE_MISSING },
+	{ F_UFLG,   0,   0, "update-index", &opt.flags, OPT_UPDATE_INDEX },
 	{ F_UFLG, 'i',   0, "ignore-case", &opt.flags, OPT_IGNORE_CASE },
 	{ F_UENC,   0,   0, "percents", &opt.flags, OPT_PERCENTS },
 	{ F_UFLG,   0,   0, "speed",  &opt.flags, OPT_SPEED },
+	{ F_UFLG,   0,   0, "direct-io", &opt.flags, OPT_DIRECT_IO },
+	{ F_TSTR,   0,   0, "checkpoint", &opt.checkpoint_file, 0 },
+	{ F_UFLG,   0,   0, "block-index", &opt.flags, OPT_BLOCK_INDEX },
+	{ F_UFLG,   0,   0, "fail-fast", &opt.flags, OPT_FAIL_FAST },
+	{ F_PFNC,   0,   0, "range", set_block_range, 0 },
 	{ F_UFLG, 'e',   0, "embed-crc",  &opt.flags, OPT_EMBED_CRC },
 	{ F_CSTR,   0,   0, "embed-crc-delimiter", &opt.embed_crc_delimiter, 0 },
 	{ F_PFNC,   0,   0, "path-separator", set_path_separator, 0 },
@@ -424,10 +522,12 @@ cmdline_opt_t cmdline_opt[] =
 	{ F_VFNC,   0,   0, "video",  accept_video, 0 },
 	{ F_VFNC,   0,   0, "nya",  nya, 0 },
 	{ F_PFNC,   0,   0, "maxdepth", set_max_depth, 0 },
+	{ F_PFNC,   0,   0, "threads", set_threads, 0 },
 	{ F_UFLG,   0,   0, "bt-private", &opt.flags, OPT_BT_PRIVATE },
 	{ F_PFNC,   0,   0, "bt-piece-length", set_bt_piece_length, 0 },
 	{ F_UFNC,   0,   0, "bt-announce", bt_announce, 0 },
 	{ F_TSTR,   0,   0, "bt-batch", &opt.bt_batch_file, 0 },
+	{ F_UFLG,   0,   0, "bt-update", &opt.flags, OPT_BT_UPDATE },
 	{ F_UFLG,   0,   0, "benchmark-raw", &opt.flags, OPT_BENCH_RAW },
 	{ F_PFNC,   0,   0, "openssl", openssl_flags, 0 },
 
@@ -899,7 +999,7 @@ static void apply_cmdline_options(struct parsed_cmd_line_t *cmd_line)
 	}
 
 	/* if no formatting options were specified at the command line */
-	if (!opt.printf_str && !opt.template_file && !opt.sum_flags && !opt.fmt) {
+	if (!opt.printf_str && !opt.template_file && !opt.sum_flags && !opt.fmt && !(opt.flags & OPT_ED2K_LINK)) {
 		/* copy the format from config */
 		opt.printf_str = conf_opt.printf_str;
 		opt.template_file = conf_opt.template_file;
@@ -907,7 +1007,7 @@ static void apply_cmdline_options(struct parsed_cmd_line_t *cmd_line)
 
 	if (!opt.printf_str && !opt.template_file) {
 		if (!opt.fmt) opt.fmt = conf_opt.fmt;
-		if (!opt.sum_flags) opt.sum_flags = conf_opt.sum_flags;
+		if (!opt.sum_flags && !(opt.flags & OPT_ED2K_LINK)) opt.sum_flags = conf_opt.sum_flags;
 	}
 
 	if (!opt.mode)  opt.mode = conf_opt.mode;
@@ -950,7 +1050,8 @@ static void apply_cmdline_options(struct parsed_cmd_line_t *cmd_line)
 static void set_default_sums_flags(const char* progName)
 {
 	char *buf;
-	int res = 0;
+	unsigned res = 0;
+	int ed2k_link = 0;
 
 	/* remove directory name from path */
 	const char* p = strrchr(progName, '/');
@@ -991,7 +1092,10 @@ static void set_default_sums_flags(const char* progName)
 	if (strstr(buf, "edonr512"))   res |= RHASH_EDONR512;
 	if (strstr(buf, "snefru256"))  res |= RHASH_SNEFRU128;
 	if (strstr(buf, "snefru128"))  res |= RHASH_SNEFRU256;
-	if (strstr(buf, "ed2k-link") || strstr(buf, "ed2k-hash")) res |= OPT_ED2K_LINK;
+	if (strstr(buf, "blake2s"))    res |= RHASH_BLAKE2S;
+	if (strstr(buf, "blake2b"))    res |= RHASH_BLAKE2B;
+	if (strstr(buf, "blake3"))     res |= RHASH_BLAKE3;
+	if (strstr(buf, "ed2k-link") || strstr(buf, "ed2k-hash")) ed2k_link = 1;
 	else if (strstr(buf, "ed2k")) res |= RHASH_ED2K;
 
 	if (strstr(buf, "sfv") && opt.fmt == 0) opt.fmt = FMT_SFV;
@@ -1001,7 +1105,11 @@ static void set_default_sums_flags(const char* progName)
 	free(buf);
 
 	/* change program flags only if opt.sum_flags was not set */
-	if (!opt.sum_flags) {
+	if (!opt.sum_flags && !(opt.flags & OPT_ED2K_LINK)) {
+		if (ed2k_link) {
+			opt.flags |= OPT_ED2K_LINK;
+			res |= RHASH_ED2K | RHASH_AICH;
+		}
 		opt.sum_flags = (res ? res : (opt.fmt == FMT_MAGNET ? RHASH_TTH | RHASH_ED2K | RHASH_AICH :
 			(!(opt.mode & MODE_CHECK) ? RHASH_CRC32 : 0)));
 	}
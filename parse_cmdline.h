@@ -22,14 +22,13 @@ typedef char opt_tchar;
  * Options bit flags and constants.
  */
 enum {
-	OPT_ED2K_LINK = 0x80000000,
-
 	/* program modes */
 	MODE_CHECK     = 0x1,
 	MODE_CHECK_EMBEDDED = 0x2,
 	MODE_UPDATE    = 0x4,
 	MODE_BENCHMARK = 0x8,
 	MODE_TORRENT   = 0x10,
+	MODE_CHECK_BLOCKS = 0x20,
 
 	/* misc options */
 	OPT_EMBED_CRC  = 0x20,
@@ -47,6 +46,12 @@ enum {
 	OPT_BENCH_RAW  = 0x20000,
     OPT_DETECT_CHANGES = 0x40000,
     OPT_REMOVE_MISSING = 0x80000,
+	OPT_DIRECT_IO  = 0x100000,
+	OPT_ED2K_LINK  = 0x200000,
+	OPT_BLOCK_INDEX = 0x400000,
+	OPT_FAIL_FAST  = 0x800000,
+	OPT_BT_UPDATE  = 0x1000000,
+	OPT_UPDATE_INDEX = 0x2000000,
 #ifdef _WIN32
 	OPT_UTF8 = 0x10000000,
 	OPT_ANSI = 0x20000000,
@@ -81,12 +86,16 @@ struct options_t
 	char* embed_crc_delimiter;
 	char  path_separator;
 	int   find_max_depth;
+	unsigned threads;    /* number of threads to hash files with */
 	struct vector_t *files_accept; /* suffixes of files to process */
 	struct vector_t *files_exclude; /* suffixes of files to exclude from processing */
 	struct vector_t *crc_accept;   /* suffixes of crc files to verify or update */
 	struct vector_t * bt_announce; /* BitTorrent announce URL */
 	size_t bt_piece_length; /* BitTorrent piece length */
 	opt_tchar*  bt_batch_file;   /* path to save a batch torrent to */
+	opt_tchar*  checkpoint_file; /* path to save hashing progress to */
+	uint64_t block_range_start; /* the first byte of a file to verify by block index */
+	uint64_t block_range_end;   /* the end of the byte range to verify, 0 for the end of file */
 
 	char** argv;
 	int has_files; /* flag: command line contain files */
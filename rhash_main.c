@@ -13,6 +13,7 @@
 #include <assert.h>
 
 #include "rhash_main.h"
+#include "block_index.h"
 #include "calc_sums.h"
 #include "common_func.h"
 #include "file_mask.h"
@@ -21,6 +22,7 @@
 #include "hash_update.h"
 #include "parse_cmdline.h"
 #include "output.h"
+#include "torrent_update.h"
 #include "win_utils.h"
 #include "librhash/rhash.h"
 #include <sys/stat.h>
@@ -30,7 +32,8 @@ struct rhash_t rhash_data;
 
 /**
  * Check if the file must be skipped. Returns 1 if the file path
- * is the same as the output or the log file path.
+ * is the same as the output or the log file path, or if the file
+ * is a block index, while block indexes are created or verified.
  *
  * @param file the file to check
  * @param mask the mask of accepted files
@@ -42,7 +45,9 @@ static int must_skip_file(file_t* file)
 
 	/* check if the file path is the same as the output or the log file path */
 	return (opt.output && are_paths_equal(path, opt.output)) ||
-		(opt.log && are_paths_equal(path, opt.log));
+		(opt.log && are_paths_equal(path, opt.log)) ||
+		(((opt.flags & OPT_BLOCK_INDEX) || (opt.mode & MODE_CHECK_BLOCKS)) &&
+			is_block_index_path(file->path));
 }
 
 /**
@@ -95,7 +100,7 @@ static int find_file_callback(file_t* file, call_back_ctx call_back_data)
 			}
 			if (must_skip_file(file))
 				return 0;
-		} else if (FILE_ISDATA(file) && (opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED | MODE_UPDATE | MODE_TORRENT))) {
+		} else if (FILE_ISDATA(file) && (opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED | MODE_UPDATE | MODE_TORRENT | MODE_CHECK_BLOCKS))) {
 			log_warning(_("skipping: %s\n"), file->path);
 			return 0;
 		}
@@ -104,6 +109,13 @@ static int find_file_callback(file_t* file, call_back_ctx call_back_data)
 			res = check_hash_file(file, not_root);
 		} else if (opt.mode & MODE_UPDATE) {
 			res = update_hash_file(file);
+		} else if (opt.mode & MODE_CHECK_BLOCKS) {
+			const char* print_path = file->path;
+			if (print_path[0] == '.' && IS_PATH_SEPARATOR(print_path[1]))
+				print_path += 2;
+			res = check_file_blocks(file, print_path, !not_root);
+			if (res == -2 && (opt.flags & OPT_FAIL_FAST))
+				opt.search_data->options |= FIND_CANCEL;
 		} else {
 			/* default mode: calculate hash */
 			const char* print_path = file->path;
@@ -205,6 +217,7 @@ static void free_allocated_data(void)
 {
 	options_destroy(&opt);
 	rhash_destroy(&rhash_data);
+	torrent_update_cleanup();
 }
 
 static void i18n_initialize(void)
@@ -291,7 +304,7 @@ int main(int argc, char *argv[])
 
 	if (opt.template_file) {
 		if (!load_printf_template()) rsh_exit(2);
-	} else if (!rhash_data.printf_str && !(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED))) {
+	} else if (!rhash_data.printf_str && !(opt.mode & (MODE_CHECK | MODE_CHECK_EMBEDDED | MODE_CHECK_BLOCKS))) {
 		/* initialize printf output format according to '--<hashname>' options */
 		init_printf_format( (rhash_data.template_text = rsh_str_new()) );
 		rhash_data.printf_str = rhash_data.template_text->str;
@@ -315,6 +328,15 @@ int main(int argc, char *argv[])
 		print_sfv_banner(rhash_data.out);
 	}
 
+	/* load the batch torrent to reuse hashes of its unchanged files */
+	if (opt.bt_batch_file && (opt.flags & OPT_BT_UPDATE)) {
+		file_t batch_torrent_file;
+		file_tinit(&batch_torrent_file, opt.bt_batch_file, FILE_OPT_DONT_FREE_PATH);
+		if (torrent_update_init(&batch_torrent_file) < 0 && errno != ENOENT)
+			log_file_t_error(&batch_torrent_file);
+		file_cleanup(&batch_torrent_file);
+	}
+
 	/* preprocess files */
 	if (sfv || opt.bt_batch_file) {
 		/* note: errors are not reported on preprocessing */
@@ -331,9 +353,11 @@ int main(int argc, char *argv[])
 	/* process files */
 	opt.search_data->options |= FIND_LOG_ERRORS;
 	opt.search_data->call_back_data.ival = 0;
+	start_hash_threads(opt.threads);
 	scan_files(opt.search_data);
+	stop_hash_threads();
 
-	if ((opt.mode & MODE_CHECK_EMBEDDED) && rhash_data.processed > 1) {
+	if ((opt.mode & (MODE_CHECK_EMBEDDED | MODE_CHECK_BLOCKS)) && rhash_data.processed > 1) {
 		print_check_stats();
 	}
 
@@ -342,8 +366,12 @@ int main(int argc, char *argv[])
 			file_t batch_torrent_file;
 			file_tinit(&batch_torrent_file, opt.bt_batch_file, FILE_OPT_DONT_FREE_PATH);
 
-			rhash_final(rhash_data.rctx, 0);
-			save_torrent_to(&batch_torrent_file, rhash_data.rctx);
+			if (torrent_update_finish(rhash_data.rctx) == 0) {
+				rhash_final(rhash_data.rctx, 0);
+				save_torrent_to(&batch_torrent_file, rhash_data.rctx);
+			} else {
+				rhash_data.error_flag = 1;
+			}
 		}
 
 		if ((opt.flags & OPT_SPEED) &&
@@ -326,6 +326,20 @@ check "$?" "2" .
 $rhash -H test1K.data >/dev/null
 check "$?" "0"
 
+new_test "test hashing with threads:  "
+mkdir test_dir
+for i in 1 2 3 4 5 6 7 8 9; do printf "$i" > test_dir/file$i.txt; done
+cp test1K.data test_dir/file5.txt
+TEST_EXPECTED=$( $rhash -r --sfv -a test_dir 2>&1 | grep -v '^;' )
+TEST_RESULT=$( $rhash -r --sfv -a --threads=3 test_dir 2>&1 | grep -v '^;' )
+check "$TEST_RESULT" "$TEST_EXPECTED" .
+TEST_RESULT=$( $rhash -p '%f %c\n' --threads=2 test_dir/file1.txt -m "a" test_dir/file2.txt )
+TEST_EXPECTED="file1.txt 83dcefb7
+(message) e8b7be43
+file2.txt 1ad5be0d"
+check "$TEST_RESULT" "$TEST_EXPECTED"
+rm -rf test_dir
+
 new_test "test update:                "
 $rhash --simple -o test.out test1K.data 2>/dev/null
 TEST_RESULT=$( $rhash --simple -u test.out 2>&1 )
@@ -352,8 +366,37 @@ mv test2K.data test2K_moved.data
 TEST_RESULT=$( $rhash --simple -r -u test.out 2>&1 )
 check "$TEST_RESULT" "Updated: test.out" .
 TEST_RESULT=$( cat test.out | grep -c data )
-check "$TEST_RESULT" "4" 
-rm -rf test.out test2K*.data subdir
+check "$TEST_RESULT" "4" .
+# new hash sums are appended, keeping the existing lines and comments
+echo "; comment" >> test.out
+cp test1K.data test4K.data
+TEST_RESULT=$( $rhash --simple -u test.out 2>&1 )
+check "$TEST_RESULT" "Updated: test.out" .
+TEST_RESULT=$( tail -2 test.out )
+check "$TEST_RESULT" "; comment
+b70b4c26  test4K.data"
+rm -rf test.out test2K*.data test4K.data subdir
+
+new_test "test update index:          "
+$rhash --simple -o test.out test1K.data 2>/dev/null
+TEST_RESULT=$( $rhash --simple --update-index -u test.out 2>&1 )
+check "$TEST_RESULT" "" .
+TEST_RESULT=$( ls test.out.idx 2>&1 )
+check "$TEST_RESULT" "test.out.idx" .
+cp test1K.data test2K.data
+TEST_RESULT=$( $rhash --simple --update-index -u test.out 2>&1 )
+check "$TEST_RESULT" "Updated: test.out" .
+TEST_RESULT=$( cat test.out | grep -c "data\|idx" )
+check "$TEST_RESULT" "2" .
+TEST_RESULT=$( $rhash --simple --update-index -u test.out 2>&1 )
+check "$TEST_RESULT" "" .
+# the index of a modified hash file must be ignored
+grep -v test2K.data test.out > test.tmp && mv test.tmp test.out
+TEST_RESULT=$( $rhash --simple --update-index -u test.out 2>&1 )
+check "$TEST_RESULT" "Updated: test.out" .
+TEST_RESULT=$( cat test.out | grep -c data )
+check "$TEST_RESULT" "2"
+rm -f test.out test.out.idx test2K.data
 
 new_test "test update remove-missing: "
 $rhash --simple -o test.out test1K.data 2>/dev/null
@@ -428,6 +471,47 @@ TEST_RESULT=$( cat test.out | grep test2K_moved.data )
 check "$TEST_RESULT" "9f5edd58  $( stat -c i%it%Y subdir/test2K_moved.data )  subdir/test2K_moved.data"
 rm -rf test.out test2K*.data subdir
 
+new_test "test torrent update:        "
+mkdir batch
+cp test1K.data batch/a.data
+cat test1K.data test1K.data > batch/b.data
+touch -d "2 days ago" batch/a.data batch/b.data
+$rhash --bt-batch=test.torrent --bt-piece-length=1024 batch/a.data batch/b.data 2>/dev/null
+echo "new" > batch/c.data
+$rhash --bt-batch=test.torrent --bt-update batch/a.data batch/b.data batch/c.data 2>/dev/null
+$rhash --bt-batch=full.torrent --bt-piece-length=1024 batch/a.data batch/b.data batch/c.data 2>/dev/null
+TEST_RESULT=$( sed 's/creation datei[0-9]*e//' test.torrent )
+TEST_EXPECTED=$( sed 's/creation datei[0-9]*e//' full.torrent )
+check "$TEST_RESULT" "$TEST_EXPECTED" .
+# the unchanged files end in the middle of a piece, which is hashed again
+cat test1K.data test1K.data | dd of=batch/a.data bs=500 count=3 2>/dev/null
+cat test1K.data test1K.data test1K.data | dd of=batch/b.data bs=500 skip=1 count=5 2>/dev/null
+touch -d "2 days ago" batch/a.data batch/b.data batch/c.data
+$rhash --bt-batch=test.torrent --bt-piece-length=1024 batch/a.data batch/b.data batch/c.data 2>/dev/null
+echo "changed" > batch/c.data
+$rhash --bt-batch=test.torrent --bt-update batch/a.data batch/b.data batch/c.data 2>/dev/null
+$rhash --bt-batch=full.torrent --bt-piece-length=1024 batch/a.data batch/b.data batch/c.data 2>/dev/null
+TEST_RESULT=$( sed 's/creation datei[0-9]*e//' test.torrent )
+TEST_EXPECTED=$( sed 's/creation datei[0-9]*e//' full.torrent )
+check "$TEST_RESULT" "$TEST_EXPECTED"
+rm -rf batch test.torrent test.torrent.bak full.torrent
+
+new_test "test block index:           "
+dd if=/dev/zero of=test3M.data bs=1024 count=3000 2>/dev/null
+$rhash --block-index test3M.data >/dev/null
+TEST_RESULT=$( $rhash --check-blocks test3M.data 2>&1 | tr -s " " )
+check "$TEST_RESULT" "test3M.data OK " .
+printf 'x' | dd of=test3M.data bs=1 seek=1100000 conv=notrunc 2>/dev/null
+TEST_RESULT=$( $rhash --check-blocks test3M.data 2>&1 | tr -s " " | tr "\n" ";" )
+check "$TEST_RESULT" "test3M.data ERR; corrupted bytes 1048576-2097151;" .
+TEST_RESULT=$( $rhash --check-blocks --range=2097152 test3M.data 2>&1 | tr -s " " )
+check "$TEST_RESULT" "test3M.data OK " .
+TEST_RESULT=$( $rhash --check-blocks --range=3072000 test3M.data 2>&1 | tr -s " " | tr "\n" ";" )
+check "$TEST_RESULT" "test3M.data ERR; range is outside of the file;" .
+$rhash --check-blocks --range=3072000 test3M.data >/dev/null 2>&1
+check "$?" "1"
+rm -f test3M.data test3M.data.rhi
+
 if [ $fail_cnt -gt 0 ]; then
   echo "Failed $fail_cnt checks"
   exit 1 # some tests failed
@@ -0,0 +1,453 @@
+/* torrent_update.c - reuse piece hashes of an existing batch torrent */
+
+/* use 64-bit off_t, must be defined before any include file */
+#undef _LARGEFILE64_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include "platform.h" /* read() on unix */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <io.h>
+# define rsh_lseek(fd, offset, origin) _lseeki64(fd, offset, origin)
+#else
+# define rsh_lseek(fd, offset, origin) lseek(fd, (off_t)(offset), origin)
+#endif
+
+#include "torrent_update.h"
+#include "common_func.h"
+#include "file.h"
+#include "output.h"
+#include "parse_cmdline.h"
+#include "librhash/rhash.h"
+#include "librhash/rhash_torrent.h"
+
+#define BT_HASH_SIZE 20
+/* the maximal nesting depth of b-encoded lists and dictionaries */
+#define BT_MAX_DEPTH 64
+
+/**
+ * A file of the existing torrent.
+ */
+struct bt_old_file
+{
+	uint64_t size;
+	const char* name; /* the file name, not null-terminated */
+	size_t name_length;
+};
+
+/**
+ * The state of updating an existing batch torrent.
+ */
+static struct
+{
+	char* data;               /* the content of the existing torrent file */
+	uint64_t mtime;           /* the modification time of the torrent file */
+	size_t piece_length;
+	const unsigned char* pieces; /* hashes of pieces, pointing into the data */
+	size_t piece_count;
+	struct bt_old_file* files;
+	size_t files_count;
+	file_t* matched_files;    /* unchanged leading files of the batch */
+	size_t matched;           /* the number of unchanged leading files */
+	uint64_t pending;         /* the size of unchanged files, which are not hashed yet */
+	int matching;             /* non-zero while the batch files match the torrent */
+	int failed;               /* non-zero if failed to hash unchanged files */
+} bt_update;
+
+/**
+ * Decode a b-encoded string.
+ *
+ * @param p the position of the string
+ * @param end the end of the data
+ * @param str pointer to receive the start of the string
+ * @param length pointer to receive the length of the string
+ * @return the position after the string, NULL on error
+ */
+static const char* bdecode_str(const char* p, const char* end, const char** str, size_t* length)
+{
+	uint64_t number = 0;
+	if (p >= end || *p < '0' || *p > '9')
+		return NULL;
+	for (; p < end && *p >= '0' && *p <= '9'; p++) {
+		number = number * 10 + (unsigned)(*p - '0');
+		if (number > (uint64_t)(end - p))
+			return NULL;
+	}
+	if (p >= end || *p != ':' || number > (uint64_t)(end - p - 1))
+		return NULL;
+	*str = p + 1;
+	*length = (size_t)number;
+	return p + 1 + number;
+}
+
+/**
+ * Decode a b-encoded non-negative integer.
+ *
+ * @param p the position of the integer
+ * @param end the end of the data
+ * @param value pointer to receive the integer
+ * @return the position after the integer, NULL on error
+ */
+static const char* bdecode_int(const char* p, const char* end, uint64_t* value)
+{
+	uint64_t number = 0;
+	if (p >= end || *(p++) != 'i' || p >= end || *p < '0' || *p > '9')
+		return NULL;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		number = number * 10 + (unsigned)(*p - '0');
+	if (p >= end || *p != 'e')
+		return NULL;
+	*value = number;
+	return p + 1;
+}
+
+/**
+ * Skip a b-encoded element of any type.
+ *
+ * @param p the position of the element
+ * @param end the end of the data
+ * @param depth the nesting depth of the element
+ * @return the position after the element, NULL on error
+ */
+static const char* bdecode_skip(const char* p, const char* end, int depth)
+{
+	const char* str;
+	size_t length;
+	if (p >= end || depth > BT_MAX_DEPTH)
+		return NULL;
+	if (*p == 'i') {
+		for (p++; p < end && (*p == '-' || (*p >= '0' && *p <= '9')); p++);
+		return (p < end && *p == 'e' ? p + 1 : NULL);
+	}
+	if (*p == 'l' || *p == 'd') {
+		for (p++; p && p < end && *p != 'e'; )
+			p = bdecode_skip(p, end, depth + 1);
+		return (p && p < end ? p + 1 : NULL);
+	}
+	return bdecode_str(p, end, &str, &length);
+}
+
+/* check if a b-encoded key equals to the given string */
+#define IS_KEY(key, key_length, str) \
+	((key_length) == sizeof(str) - 1 && memcmp((key), (str), sizeof(str) - 1) == 0)
+
+/**
+ * Decode an element of the "files" list of the info dictionary.
+ *
+ * @param p the position of the element
+ * @param end the end of the data
+ * @return the position after the element, NULL on error
+ */
+static const char* bdecode_file(const char* p, const char* end)
+{
+	struct bt_old_file file;
+	const char* key;
+	size_t key_length, components = 0;
+
+	memset(&file, 0, sizeof(file));
+	if (p >= end || *(p++) != 'd')
+		return NULL;
+	while (p && p < end && *p != 'e') {
+		p = bdecode_str(p, end, &key, &key_length);
+		if (!p)
+			return NULL;
+		if (IS_KEY(key, key_length, "length")) {
+			p = bdecode_int(p, end, &file.size);
+		} else if (IS_KEY(key, key_length, "path") && p < end && *p == 'l') {
+			for (p++; p && p < end && *p != 'e'; components++)
+				p = bdecode_str(p, end, &file.name, &file.name_length);
+			if (p) p = (p < end ? p + 1 : NULL);
+		} else {
+			p = bdecode_skip(p, end, 2);
+		}
+	}
+	if (!p || p >= end)
+		return NULL;
+	/* files in subdirectories never match, since only basenames of files are stored */
+	if (components != 1)
+		file.name = NULL;
+	bt_update.files = (struct bt_old_file*)rsh_realloc(bt_update.files,
+		(bt_update.files_count + 1) * sizeof(struct bt_old_file));
+	bt_update.files[bt_update.files_count++] = file;
+	return p + 1;
+}
+
+/**
+ * Decode the info dictionary of a torrent file.
+ *
+ * @param p the position of the dictionary
+ * @param end the end of the data
+ * @return the position after the dictionary, NULL on error
+ */
+static const char* bdecode_info(const char* p, const char* end)
+{
+	struct bt_old_file single;
+	const char* key;
+	const char* pieces = NULL;
+	size_t key_length, pieces_length = 0;
+	uint64_t piece_length = 0;
+
+	memset(&single, 0, sizeof(single));
+	if (p >= end || *(p++) != 'd')
+		return NULL;
+	while (p && p < end && *p != 'e') {
+		p = bdecode_str(p, end, &key, &key_length);
+		if (!p)
+			return NULL;
+		if (IS_KEY(key, key_length, "files") && p < end && *p == 'l') {
+			for (p++; p && p < end && *p != 'e'; )
+				p = bdecode_file(p, end);
+			if (p) p = (p < end ? p + 1 : NULL);
+		} else if (IS_KEY(key, key_length, "length")) {
+			p = bdecode_int(p, end, &single.size);
+		} else if (IS_KEY(key, key_length, "name")) {
+			p = bdecode_str(p, end, &single.name, &single.name_length);
+		} else if (IS_KEY(key, key_length, "piece length")) {
+			p = bdecode_int(p, end, &piece_length);
+		} else if (IS_KEY(key, key_length, "pieces")) {
+			p = bdecode_str(p, end, &pieces, &pieces_length);
+		} else {
+			p = bdecode_skip(p, end, 1);
+		}
+	}
+	if (!p || p >= end || !pieces || piece_length == 0 ||
+			piece_length > (size_t)-1 || (pieces_length % BT_HASH_SIZE) != 0)
+		return NULL;
+	if (bt_update.files_count == 0) {
+		bt_update.files = (struct bt_old_file*)rsh_malloc(sizeof(struct bt_old_file));
+		bt_update.files[bt_update.files_count++] = single;
+	}
+	bt_update.piece_length = (size_t)piece_length;
+	bt_update.pieces = (const unsigned char*)pieces;
+	bt_update.piece_count = pieces_length / BT_HASH_SIZE;
+	return p + 1;
+}
+
+/**
+ * Decode a torrent file, loaded into memory.
+ *
+ * @param p the content of the torrent file
+ * @param end the end of the content
+ * @return 0 on success, -1 on error
+ */
+static int bdecode_torrent(const char* p, const char* end)
+{
+	const char* key;
+	size_t key_length, i;
+	uint64_t total_size = 0;
+
+	if (p >= end || *(p++) != 'd')
+		return -1;
+	while (p && p < end && *p != 'e') {
+		p = bdecode_str(p, end, &key, &key_length);
+		if (!p)
+			return -1;
+		if (IS_KEY(key, key_length, "info") && !bt_update.pieces)
+			p = bdecode_info(p, end);
+		else
+			p = bdecode_skip(p, end, 1);
+	}
+	if (!p || !bt_update.pieces)
+		return -1;
+	/* check that the pieces cover all files */
+	for (i = 0; i < bt_update.files_count; i++)
+		total_size += bt_update.files[i].size;
+	if ((total_size + bt_update.piece_length - 1) / bt_update.piece_length != bt_update.piece_count)
+		return -1;
+	return 0;
+}
+
+/**
+ * Load an existing batch torrent file, to reuse hashes of its pieces,
+ * which cover unchanged leading files of the batch.
+ *
+ * @param torrent_file the torrent file to load
+ * @return 0 on success, -1 on fail with error code stored in errno
+ */
+int torrent_update_init(file_t* torrent_file)
+{
+	FILE* fd;
+	size_t size;
+
+	torrent_update_cleanup();
+	if (file_stat(torrent_file, 0) < 0)
+		return -1;
+	if (!torrent_file->stats || torrent_file->size > (uint64_t)((size_t)-1 - 1)) {
+		errno = EINVAL;
+		return -1;
+	}
+	size = (size_t)torrent_file->size;
+	fd = file_fopen(torrent_file, FOpenRead | FOpenBin);
+	if (!fd)
+		return -1;
+	bt_update.mtime = (uint64_t)torrent_file->stats->st_mtime;
+	bt_update.data = (char*)rsh_malloc(size + 1);
+	if (fread(bt_update.data, 1, size, fd) != size) {
+		fclose(fd);
+		torrent_update_cleanup();
+		errno = EIO;
+		return -1;
+	}
+	fclose(fd);
+	if (bdecode_torrent(bt_update.data, bt_update.data + size) < 0) {
+		torrent_update_cleanup();
+		errno = EINVAL;
+		return -1;
+	}
+	if (opt.bt_piece_length && opt.bt_piece_length != bt_update.piece_length) {
+		log_warning(_("%s: piece length differs, all files will be hashed\n"), file_cpath(torrent_file));
+		torrent_update_cleanup();
+		return 0;
+	}
+	bt_update.matching = 1;
+	return 0;
+}
+
+/**
+ * Get the piece length of the loaded torrent file.
+ *
+ * @return the piece length, 0 if no torrent file is loaded
+ */
+size_t torrent_update_piece_length(void)
+{
+	return (bt_update.data ? bt_update.piece_length : 0);
+}
+
+/**
+ * Hash a file from the given offset up to its end.
+ *
+ * @param file the file to hash
+ * @param offset the offset to start hashing from
+ * @param rctx the context to hash the file by
+ * @return 0 on success, -1 on fail with error code stored in errno
+ */
+static int hash_file_tail(file_t* file, uint64_t offset, struct rhash_context* rctx)
+{
+	unsigned char buffer[65536];
+	int fd = file_open(file, FOpenRead | FOpenBin);
+	int res = 0;
+	if (fd < 0)
+		return -1;
+	if (offset > 0 && rsh_lseek(fd, offset, SEEK_SET) < 0)
+		res = -1;
+	while (res == 0) {
+		int length = (int)read(fd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			if (length < 0) res = -1;
+			break;
+		}
+		rhash_update(rctx, buffer, length);
+	}
+	close(fd);
+	return res;
+}
+
+/**
+ * Stop matching files of the batch. Add to the context the hashes of
+ * whole pieces, covered by the unchanged files, then hash the rest of
+ * the unchanged files.
+ *
+ * @param rctx the context to hash the batch by
+ * @param is_final non-zero if the batch has no more files
+ */
+static void torrent_update_flush(struct rhash_context* rctx, int is_final)
+{
+	size_t count = (size_t)(bt_update.pending / bt_update.piece_length);
+	uint64_t offset, start = 0;
+	size_t i;
+
+	/* the last piece can be reused only if the whole batch is unchanged */
+	if (is_final && bt_update.matched == bt_update.files_count)
+		count = bt_update.piece_count;
+	bt_update.matching = 0;
+	if (count > 0 && !rhash_torrent_add_piece_hashes(rctx, bt_update.pieces, count)) {
+		log_error(_("failed to reuse piece hashes: %s\n"), strerror(ENOMEM));
+		bt_update.failed = 1;
+	}
+	offset = (uint64_t)count * bt_update.piece_length;
+	for (i = 0; i < bt_update.matched; i++) {
+		uint64_t size = bt_update.files[i].size;
+		if (!bt_update.failed && start + size > offset &&
+				hash_file_tail(&bt_update.matched_files[i], (offset > start ? offset - start : 0), rctx) < 0) {
+			log_file_t_error(&bt_update.matched_files[i]);
+			bt_update.failed = 1;
+		}
+		start += size;
+		file_cleanup(&bt_update.matched_files[i]);
+	}
+	free(bt_update.matched_files);
+	bt_update.matched_files = NULL;
+	bt_update.matched = 0;
+}
+
+/**
+ * Check if a file of the batch is the same, as the file of the loaded
+ * torrent at the same position, and all previous files are also the same.
+ * A file is trusted to be the same, if it has the same name and size,
+ * and it was not modified after the torrent file.
+ * Hashing of such files is postponed. For the first changed file
+ * the postponed files are hashed, reusing hashes of their whole pieces.
+ *
+ * @param file the file of the batch
+ * @param bt_path the path of the file stored in the torrent
+ * @param rctx the context to hash the batch by
+ * @return 1 if the file must not be hashed, 0 if the file must be hashed
+ */
+int torrent_update_skip_file(file_t* file, const char* bt_path, struct rhash_context* rctx)
+{
+	struct bt_old_file* old;
+	const char* name = bt_path + strlen(bt_path);
+	size_t name_length;
+
+	if (!bt_update.matching)
+		return 0;
+	for (; name > bt_path && name[-1] != '/' && name[-1] != '\\'; name--);
+	name_length = strlen(name);
+	old = (bt_update.matched < bt_update.files_count ? &bt_update.files[bt_update.matched] : NULL);
+	if (old && old->name && old->name_length == name_length &&
+			memcmp(old->name, name, name_length) == 0 && old->size == file->size &&
+			file->stats && (uint64_t)file->stats->st_mtime < bt_update.mtime) {
+		bt_update.matched_files = (file_t*)rsh_realloc(bt_update.matched_files,
+			(bt_update.matched + 1) * sizeof(file_t));
+		file_tinit(&bt_update.matched_files[bt_update.matched], FILE_TPATH(file), 0);
+		bt_update.matched++;
+		bt_update.pending += file->size;
+		return 1;
+	}
+	/* the file is new or changed, so it and the next files are hashed */
+	torrent_update_flush(rctx, 0);
+	return 0;
+}
+
+/**
+ * Finish hashing of the batch, hashing postponed unchanged files.
+ *
+ * @param rctx the context to hash the batch by
+ * @return 0 on success, -1 if failed to hash the batch
+ */
+int torrent_update_finish(struct rhash_context* rctx)
+{
+	if (bt_update.matching)
+		torrent_update_flush(rctx, 1);
+	return (bt_update.failed ? -1 : 0);
+}
+
+/**
+ * Free memory allocated to update a torrent.
+ */
+void torrent_update_cleanup(void)
+{
+	size_t i;
+	for (i = 0; i < bt_update.matched; i++)
+		file_cleanup(&bt_update.matched_files[i]);
+	free(bt_update.matched_files);
+	free(bt_update.files);
+	free(bt_update.data);
+	memset(&bt_update, 0, sizeof(bt_update));
+}
@@ -0,0 +1,24 @@
+/* torrent_update.h - reuse piece hashes of an existing batch torrent */
+#ifndef TORRENT_UPDATE_H
+#define TORRENT_UPDATE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct file_t;
+struct rhash_context;
+
+int torrent_update_init(struct file_t* torrent_file);
+size_t torrent_update_piece_length(void);
+int torrent_update_skip_file(struct file_t* file, const char* bt_path, struct rhash_context* rctx);
+int torrent_update_finish(struct rhash_context* rctx);
+void torrent_update_cleanup(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* TORRENT_UPDATE_H */
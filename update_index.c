@@ -0,0 +1,394 @@
+/* update_index.c - binary index of a hash file, used by the update mode */
+
+/* use 64-bit off_t, must be defined before any include file */
+#undef _LARGEFILE64_SOURCE
+#undef _FILE_OFFSET_BITS
+#define _LARGEFILE64_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include "platform.h" /* read() on unix */
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <sys/mman.h>
+#endif
+
+#include "update_index.h"
+#include "common_func.h"
+#include "file.h"
+
+/*
+ * Format of an index file, all numbers are 64-bit little-endian:
+ *   header: magic, size and mtime in nanoseconds of the hash file, entries count,
+ *   names size;
+ *   entries: inode, mtime, size, line offset, name offset, sorted by name;
+ *   names: NUL-terminated file paths.
+ * The format has no pointers, so an index file can be used mapped into memory.
+ */
+#define UPDATE_INDEX_MAGIC "RHUPIDX1"
+#define UPDATE_INDEX_HEADER_SIZE 40
+#define UPDATE_INDEX_ENTRY_SIZE 40
+
+/* little-endian serialization of index entries */
+static void put_le64(unsigned char* p, uint64_t value)
+{
+	int i;
+	for (i = 0; i < 8; i++, value >>= 8)
+		p[i] = (unsigned char)value;
+}
+
+static uint64_t get_le64(const unsigned char* p)
+{
+	uint64_t value = 0;
+	int i;
+	for (i = 7; i >= 0; i--)
+		value = (value << 8) | p[i];
+	return value;
+}
+
+/**
+ * Get the modification time of a file in nanoseconds, to detect
+ * changes of a hash file made within a second after saving its index.
+ *
+ * @param file the file with retrieved stats
+ * @return the modification time
+ */
+static uint64_t get_mtime_ns(file_t* file)
+{
+	return (uint64_t)file->stats->st_mtim.tv_sec * 1000000000 + file->stats->st_mtim.tv_nsec;
+}
+
+/**
+ * Initialize an empty index.
+ *
+ * @param index the index to initialize
+ */
+void update_index_init(update_index* index)
+{
+	memset(index, 0, sizeof(*index));
+	rsh_arena_init(&index->arena);
+}
+
+/**
+ * Release the memory image of a loaded index file.
+ *
+ * @param index the index
+ */
+static void update_index_unload(update_index* index)
+{
+#ifndef _WIN32
+	if (index->is_mapped)
+		munmap(index->data, index->data_size);
+	else
+#endif
+		free(index->data);
+	index->data = NULL;
+	index->data_size = 0;
+	index->is_mapped = 0;
+	index->entries = NULL;
+	index->names = NULL;
+	index->count = index->names_size = 0;
+}
+
+/**
+ * Free memory allocated by an index.
+ *
+ * @param index the index to clean up
+ */
+void update_index_cleanup(update_index* index)
+{
+	update_index_unload(index);
+	rsh_arena_destroy(&index->arena);
+	free(index->items);
+	index->items = NULL;
+	index->items_count = index->items_allocated = 0;
+}
+
+/**
+ * Get the path of the index file of the given hash file.
+ *
+ * @param index_file the file_t structure to initialize with the path
+ * @param hash_file the hash file
+ */
+static void get_index_file(file_t* index_file, file_t* hash_file)
+{
+	file_path_append(index_file, hash_file, UPDATE_INDEX_SUFFIX);
+}
+
+/**
+ * Read the whole index file into the memory image of an index.
+ *
+ * @param index the index to load into
+ * @param fd the descriptor of the opened index file
+ * @return 0 on success, -1 on error with error code in errno
+ */
+static int read_index_data(update_index* index, int fd)
+{
+	struct stat st;
+	size_t done = 0;
+	if (fstat(fd, &st) < 0)
+		return -1;
+	if (st.st_size < UPDATE_INDEX_HEADER_SIZE || (uint64_t)st.st_size > (size_t)-1) {
+		errno = EINVAL;
+		return -1;
+	}
+	index->data_size = (size_t)st.st_size;
+#ifndef _WIN32
+	index->data = (unsigned char*)mmap(NULL, index->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (index->data != (unsigned char*)MAP_FAILED) {
+		index->is_mapped = 1;
+		return 0;
+	}
+#endif
+	index->data = (unsigned char*)rsh_malloc(index->data_size);
+	while (done < index->data_size) {
+		int res = read(fd, index->data + done, (unsigned)(index->data_size - done));
+		if (res <= 0) {
+			if (res == 0)
+				errno = EINVAL;
+			return -1;
+		}
+		done += res;
+	}
+	return 0;
+}
+
+/**
+ * Load the index of a hash file. The index is loaded only if it was saved
+ * for the current size and modification time of the hash file.
+ * The entries of the index file are not read until they are looked up.
+ *
+ * @param index the index to load into
+ * @param hash_file the hash file
+ * @return 0 on success, -1 on error with error code in errno
+ */
+int update_index_load(update_index* index, file_t* hash_file)
+{
+	file_t index_file;
+	const unsigned char* header;
+	uint64_t count, names_size;
+	int fd;
+	int res;
+
+	update_index_unload(index);
+	if (file_stat(hash_file, 0) < 0 || !hash_file->stats)
+		return -1;
+	get_index_file(&index_file, hash_file);
+	fd = file_open(&index_file, FOpenRead | FOpenBin);
+	file_cleanup(&index_file);
+	if (fd < 0)
+		return -1;
+	res = read_index_data(index, fd);
+	close(fd);
+	if (res < 0) {
+		update_index_unload(index);
+		return -1;
+	}
+
+	header = index->data;
+	count = get_le64(header + 24);
+	names_size = get_le64(header + 32);
+	if (memcmp(header, UPDATE_INDEX_MAGIC, 8) != 0 ||
+			get_le64(header + 8) != hash_file->size ||
+			get_le64(header + 16) != get_mtime_ns(hash_file) ||
+			count > (index->data_size - UPDATE_INDEX_HEADER_SIZE) / UPDATE_INDEX_ENTRY_SIZE ||
+			names_size != index->data_size - UPDATE_INDEX_HEADER_SIZE - count * UPDATE_INDEX_ENTRY_SIZE ||
+			(names_size > 0 && index->data[index->data_size - 1] != 0)) {
+		update_index_unload(index);
+		errno = EINVAL;
+		return -1;
+	}
+	index->count = (size_t)count;
+	index->entries = index->data + UPDATE_INDEX_HEADER_SIZE;
+	index->names = (const char*)index->entries + index->count * UPDATE_INDEX_ENTRY_SIZE;
+	index->names_size = (size_t)names_size;
+	return 0;
+}
+
+/**
+ * Get the path of a loaded entry.
+ *
+ * @param index the index
+ * @param i the number of the entry
+ * @return the path, or NULL if the entry is corrupted
+ */
+static const char* get_entry_path(update_index* index, size_t i)
+{
+	uint64_t name_offset = get_le64(index->entries + i * UPDATE_INDEX_ENTRY_SIZE + 32);
+	return (name_offset < index->names_size ? index->names + name_offset : NULL);
+}
+
+/**
+ * Check if the loaded index contains the given path.
+ * Only the entries on the way of the binary search are read.
+ *
+ * @param index the index
+ * @param path the file path to search for
+ * @return 1 if the path is found, 0 otherwise
+ */
+int update_index_find(update_index* index, const char* path)
+{
+	size_t a = 0, b = index->count;
+	while (a < b) {
+		size_t c = a + (b - a) / 2;
+		const char* name = get_entry_path(index, c);
+		int cmp;
+		if (!name)
+			return 0;
+		cmp = strcmp(path, name);
+		if (cmp == 0)
+			return 1;
+		if (cmp < 0)
+			b = c;
+		else
+			a = c + 1;
+	}
+	return 0;
+}
+
+/**
+ * Add an entry to the index.
+ *
+ * @param index the index
+ * @param path the file path, as written in the hash file
+ * @param inode the inode of the file, 0 if unknown
+ * @param mtime the modification time of the file, 0 if unknown
+ * @param size the size of the file
+ * @param offset the offset of the file line in the hash file
+ */
+void update_index_add(update_index* index, const char* path,
+	uint64_t inode, uint64_t mtime, uint64_t size, uint64_t offset)
+{
+	update_index_item* item;
+	if (index->items_count >= index->items_allocated) {
+		index->items_allocated = (index->items_allocated ? index->items_allocated * 2 : 64);
+		index->items = (update_index_item*)rsh_realloc(index->items,
+			index->items_allocated * sizeof(update_index_item));
+	}
+	item = &index->items[index->items_count++];
+	item->path = rsh_arena_strdup(&index->arena, path);
+	item->inode = inode;
+	item->mtime = mtime;
+	item->size = size;
+	item->offset = offset;
+}
+
+/* compare added items by path */
+static int compare_items(const void* a, const void* b)
+{
+	return strcmp(((const update_index_item*)a)->path, ((const update_index_item*)b)->path);
+}
+
+/**
+ * Merge the loaded and the added entries into an index file.
+ *
+ * @param index the index
+ * @param fd the index file to write
+ * @param hash_file the hash file, with its size and mtime already retrieved
+ * @return 0 on success, -1 on error
+ */
+static int write_index(update_index* index, FILE* fd, file_t* hash_file)
+{
+	unsigned char buffer[UPDATE_INDEX_ENTRY_SIZE];
+	const char** names;
+	size_t* sources; /* numbers of the merged loaded entries and added items */
+	uint64_t names_size = 0;
+	size_t count = 0;
+	size_t i = 0, j = 0, k;
+	int res = 0;
+
+	names = (const char**)rsh_malloc((index->count + index->items_count + 1) * sizeof(char*));
+	sources = (size_t*)rsh_malloc((index->count + index->items_count + 1) * sizeof(size_t));
+
+	/* merge two sequences of entries, sorted by path */
+	while (i < index->count || j < index->items_count) {
+		const char* name = (i < index->count ? get_entry_path(index, i) : NULL);
+		if (i < index->count && !name) {
+			i++; /* skip a corrupted entry */
+			continue;
+		}
+		if (name && (j >= index->items_count || strcmp(name, index->items[j].path) < 0)) {
+			sources[count] = i++;
+		} else {
+			name = index->items[j].path;
+			sources[count] = index->count + j++;
+		}
+		names[count++] = name;
+		names_size += strlen(name) + 1;
+	}
+
+	memcpy(buffer, UPDATE_INDEX_MAGIC, 8);
+	put_le64(buffer + 8, hash_file->size);
+	put_le64(buffer + 16, get_mtime_ns(hash_file));
+	put_le64(buffer + 24, count);
+	put_le64(buffer + 32, names_size);
+	if (fwrite(buffer, 1, UPDATE_INDEX_HEADER_SIZE, fd) != UPDATE_INDEX_HEADER_SIZE)
+		res = -1;
+
+	for (k = 0, names_size = 0; res == 0 && k < count; k++) {
+		if (sources[k] < index->count) {
+			memcpy(buffer, index->entries + sources[k] * UPDATE_INDEX_ENTRY_SIZE, UPDATE_INDEX_ENTRY_SIZE);
+		} else {
+			update_index_item* item = &index->items[sources[k] - index->count];
+			put_le64(buffer, item->inode);
+			put_le64(buffer + 8, item->mtime);
+			put_le64(buffer + 16, item->size);
+			put_le64(buffer + 24, item->offset);
+		}
+		put_le64(buffer + 32, names_size);
+		names_size += strlen(names[k]) + 1;
+		if (fwrite(buffer, 1, UPDATE_INDEX_ENTRY_SIZE, fd) != UPDATE_INDEX_ENTRY_SIZE)
+			res = -1;
+	}
+	for (k = 0; res == 0 && k < count; k++) {
+		size_t length = strlen(names[k]) + 1;
+		if (fwrite(names[k], 1, length, fd) != length)
+			res = -1;
+	}
+	free(names);
+	free(sources);
+	return res;
+}
+
+/**
+ * Save the index of a hash file. The index is merged from the loaded
+ * and the added entries, and is written for the current size and
+ * modification time of the hash file.
+ *
+ * @param index the index to save
+ * @param hash_file the hash file
+ * @return 0 on success, -1 on error with error code in errno
+ */
+int update_index_save(update_index* index, file_t* hash_file)
+{
+	file_t index_file;
+	file_t new_file;
+	FILE* fd;
+	int res = -1;
+
+	if (file_stat(hash_file, 0) < 0 || !hash_file->stats)
+		return -1;
+	qsort(index->items, index->items_count, sizeof(update_index_item), compare_items);
+
+	/* the loaded index can be mapped, so write a new file and replace it */
+	get_index_file(&index_file, hash_file);
+	file_path_append(&new_file, &index_file, ".new");
+	fd = file_fopen(&new_file, FOpenWrite | FOpenBin);
+	if (fd) {
+		res = write_index(index, fd, hash_file);
+		if (fclose(fd) != 0)
+			res = -1;
+		update_index_unload(index);
+		if (res == 0)
+			res = file_rename(&new_file, &index_file);
+		if (res < 0)
+			file_remove(&new_file);
+	}
+	file_cleanup(&new_file);
+	file_cleanup(&index_file);
+	return res;
+}
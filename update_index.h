@@ -0,0 +1,62 @@
+/* update_index.h - binary index of a hash file, used by the update mode */
+#ifndef UPDATE_INDEX_H
+#define UPDATE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "common_func.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the suffix appended to a hash file path to get the path of its index */
+#define UPDATE_INDEX_SUFFIX ".idx"
+
+struct file_t;
+
+/**
+ * An entry of a hash file, added to the index.
+ */
+typedef struct update_index_item
+{
+	char* path;      /* the file path, as written in the hash file */
+	uint64_t inode;  /* inode of the file, 0 if unknown */
+	uint64_t mtime;  /* modification time of the file, 0 if unknown */
+	uint64_t size;   /* size of the file */
+	uint64_t offset; /* offset of the file line in the hash file */
+} update_index_item;
+
+/**
+ * Index of the file paths of a hash file, sorted by path.
+ * The entries loaded from an index file are kept in its memory image,
+ * the entries added later are stored in the items array.
+ */
+typedef struct update_index
+{
+	unsigned char* data;   /* the memory image of the loaded index file */
+	size_t data_size;      /* the size of the index file */
+	int is_mapped;         /* non-zero if data is mapped into memory */
+	size_t count;          /* the number of loaded entries */
+	const unsigned char* entries; /* the loaded entries, sorted by path */
+	const char* names;     /* the paths of the loaded entries */
+	size_t names_size;     /* the size of the names pool */
+	update_index_item* items; /* the entries added since loading */
+	size_t items_count;    /* the number of added entries */
+	size_t items_allocated; /* the number of allocated items */
+	rsh_arena arena;       /* the memory of the added paths */
+} update_index;
+
+void update_index_init(update_index* index);
+void update_index_cleanup(update_index* index);
+int update_index_load(update_index* index, struct file_t* hash_file);
+int update_index_find(update_index* index, const char* path);
+void update_index_add(update_index* index, const char* path,
+	uint64_t inode, uint64_t mtime, uint64_t size, uint64_t offset);
+int update_index_save(update_index* index, struct file_t* hash_file);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* UPDATE_INDEX_H */